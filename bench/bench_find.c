@@ -0,0 +1,221 @@
+/**
+ * @file   bench_find.c
+ *
+ * @brief  Benchmark Slinky substring search against memmem, compiled
+ *         needle against one-shot search, and reverse search against
+ *         forward search.
+ *
+ * Build and run from repository root:
+ *
+ *     gcc -O2 -Isrc src/slinky.c bench/bench_find.c -o bench_find
+ *     ./bench_find [haystack size]
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "slinky.h"
+
+
+/* ------------------------------------------------------------
+ * Naive search (previous sl_find_index, reference).
+ * ------------------------------------------------------------ */
+
+static sl_pos_t naive_find( const char* s1, const char* s2 )
+{
+    for ( sl_pos_t i1 = 0; s1[ i1 ]; i1++ ) {
+        sl_pos_t i = i1;
+        sl_pos_t i2 = 0;
+        while ( s1[ i ] == s2[ i2 ] && s2[ i2 ] ) {
+            i++;
+            i2++;
+        }
+        if ( s2[ i2 ] == 0 )
+            return i1;
+    }
+
+    return -1;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Benchmark.
+ * ------------------------------------------------------------ */
+
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * Run searches for needle and print throughput (GB/s) for each
+ * method.
+ */
+static void bench( const char* name, sl_t hay, const char* ndl, int naive )
+{
+    size_t   nlen = strlen( ndl );
+    int      rounds = 20;
+    sl_pos_t r1 = -1, r2 = -1, r3 = -1;
+    double   t, gb = (double)sllen( hay ) * rounds / 1e9;
+    char*    m;
+
+    printf( "%-14s %4zu", name, nlen );
+
+    t = now();
+    for ( int i = 0; i < rounds; i++ )
+        r1 = slidx( hay, ndl );
+    printf( "  slidx %6.2f", gb / ( now() - t ) );
+
+    t = now();
+    for ( int i = 0; i < rounds; i++ ) {
+        m = memmem( hay, sllen( hay ), ndl, nlen );
+        r2 = m ? m - hay : -1;
+    }
+    printf( "  memmem %6.2f", gb / ( now() - t ) );
+
+    if ( naive ) {
+        t = now();
+        for ( int i = 0; i < rounds; i++ )
+            r3 = naive_find( hay, ndl );
+        printf( "  naive %6.2f", gb / ( now() - t ) );
+    } else {
+        r3 = r1;
+    }
+
+    printf( "%s\n", ( r1 == r2 && r1 == r3 ) ? "" : "  MISMATCH" );
+}
+
+
+/**
+ * Search needle from each short line, and print lines per second
+ * (millions) for one-shot and compiled needle search.
+ */
+static void bench_lines( sl_t text, const char* ndl )
+{
+    sl_size_t   line = 80;
+    sl_size_t   cnt = sllen( text ) / line;
+    sl_t*       lines = malloc( cnt * sizeof( sl_t ) );
+    sl_needle_t nd = sl_needle_new( ndl );
+    sl_size_t   r1 = 0, r2 = 0;
+    double      t;
+
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        lines[ i ] = sl_from_len_c( text + i * line, line );
+
+    printf( "%-14s %4zu", "lines", strlen( ndl ) );
+
+    t = now();
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        r1 += ( slidx( lines[ i ], ndl ) >= 0 );
+    printf( "  slidx %6.2f", cnt / 1e6 / ( now() - t ) );
+
+    t = now();
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        r2 += ( slfnd( lines[ i ], nd, 0 ) >= 0 );
+    printf( "  needle %6.2f", cnt / 1e6 / ( now() - t ) );
+
+    printf( "  (Mlines/s)%s\n", ( r1 == r2 ) ? "" : "  MISMATCH" );
+
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        sldel( &lines[ i ] );
+    free( lines );
+    sl_needle_del( nd );
+}
+
+
+/**
+ * Find last needle, and print throughput (GB/s) for one-shot and
+ * compiled reverse search, and forward search through all matches.
+ */
+static void bench_right( const char* name, sl_t hay, const char* ndl )
+{
+    sl_needle_t nd = sl_needle_new( ndl );
+    int         rounds = 20;
+    sl_pos_t    r1 = -1, r2 = -1, r3 = -1, idx;
+    double      t, gb = (double)sllen( hay ) * rounds / 1e9;
+
+    printf( "%-14s %4zu", name, strlen( ndl ) );
+
+    t = now();
+    for ( int i = 0; i < rounds; i++ )
+        r1 = slidr( hay, ndl );
+    printf( "  slidr %6.2f", gb / ( now() - t ) );
+
+    t = now();
+    for ( int i = 0; i < rounds; i++ )
+        r3 = slfnr( hay, nd, sllen( hay ) );
+    printf( "  needle %6.2f", gb / ( now() - t ) );
+
+    t = now();
+    for ( int i = 0; i < rounds; i++ ) {
+        r2 = -1;
+        while ( ( idx = slfnd( hay, nd, r2 + 1 ) ) >= 0 )
+            r2 = idx;
+    }
+    printf( "  forward %6.2f", gb / ( now() - t ) );
+
+    printf( "%s\n", ( r1 == r2 && r1 == r3 ) ? "" : "  MISMATCH" );
+
+    sl_needle_del( nd );
+}
+
+
+int main( int argc, char** argv )
+{
+    size_t size = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 16 * 1024 * 1024;
+    sl_t   text;
+    sl_t   same;
+    char   ndl[ 512 ];
+
+    /* Text over small alphabet, needles are not found. */
+    text = slnew( size + 1 );
+    srand( 1 );
+    for ( size_t i = 0; i < size; i++ )
+        slach( &text, "etaoin shrdlu"[ rand() % 13 ] );
+
+    /* Repetitive text, with match at end. */
+    same = slnew( size + 1 );
+    slacn( &same, 'a', size - 1 );
+    slach( &same, 'b' );
+
+    printf( "%-14s %4s  (GB/s)\n", "case", "len" );
+
+    bench( "text", text, "xy", 1 );
+    bench( "text", text, "xyzw", 1 );
+    bench( "text", text, "the quick fox", 1 );
+    bench( "text", text, "the quick brown fox jumps over", 1 );
+    for ( int n = 0; n < 8; n++ )
+        memcpy( &ndl[ n * 32 ], "the quick brown fox jumps over. ", 32 );
+    ndl[ 256 ] = 0;
+    bench( "text", text, ndl, 1 );
+
+    memset( ndl, 'a', 16 );
+    strcpy( &ndl[ 16 ], "b" );
+    bench( "periodic", same, ndl, 0 );
+    memset( ndl, 'a', 255 );
+    strcpy( &ndl[ 255 ], "b" );
+    bench( "periodic", same, ndl, 0 );
+
+    bench_lines( text, "xy" );
+    bench_lines( text, "the quick fox" );
+    bench_lines( text, ndl );
+
+    bench_right( "right", text, "xyzw" );
+    bench_right( "right", text, "the quick fox" );
+    slast( &text, "/path/to/file.tar.gz" );
+    bench_right( "right suffix", text, ".tar.gz" );
+
+    sldel( &text );
+    sldel( &same );
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file   bench_glob.c
+ *
+ * @brief  Benchmark Slinky compiled glob against fnmatch (one call per
+ *         pattern).
+ *
+ * Build and run from repository root:
+ *
+ *     gcc -O2 -Isrc src/slinky.c bench/bench_glob.c -o bench_glob
+ *     ./bench_glob [paths]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fnmatch.h>
+
+#include "slinky.h"
+
+
+/* ------------------------------------------------------------
+ * Benchmark.
+ * ------------------------------------------------------------ */
+
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/** Random lowercase word. */
+static void word( char* buf, int len )
+{
+    for ( int i = 0; i < len; i++ )
+        buf[ i ] = 'a' + rand() % 26;
+    buf[ len ] = 0;
+}
+
+
+/**
+ * Count paths matching any of "cnt" patterns, and print paths per
+ * second (millions) for fnmatch per pattern and compiled glob.
+ */
+static void bench( const char* name, sl_t* paths, size_t pcnt, const char** pats, size_t cnt )
+{
+    sl_glob_t gp = sl_glob_new_many( pats, cnt );
+    size_t    r1 = 0, r2 = 0;
+    double    t;
+
+    printf( "%-10s %4zu", name, cnt );
+
+    t = now();
+    for ( size_t i = 0; i < pcnt; i++ ) {
+        for ( size_t k = 0; k < cnt; k++ ) {
+            if ( fnmatch( pats[ k ], paths[ i ], FNM_PATHNAME ) == 0 ) {
+                r1++;
+                break;
+            }
+        }
+    }
+    printf( "  fnmatch %7.3f", pcnt / 1e6 / ( now() - t ) );
+
+    t = now();
+    for ( size_t i = 0; i < pcnt; i++ )
+        r2 += ( slgbm( paths[ i ], gp ) >= 0 );
+    printf( "  glob %7.3f", pcnt / 1e6 / ( now() - t ) );
+
+    printf( "  (Mpaths/s)%s\n", ( r1 == r2 ) ? "" : "  MISMATCH" );
+
+    sl_glob_del( gp );
+}
+
+
+int main( int argc, char** argv )
+{
+    size_t       pcnt = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 200000;
+    sl_t*        paths = malloc( pcnt * sizeof( sl_t ) );
+    const char*  exts[] = { "c", "h", "log", "txt", "o", "md" };
+    const char** pats = malloc( 64 * sizeof( char* ) );
+    char         buf[ 64 ];
+
+    /* File paths of 1-5 directories. */
+    srand( 1 );
+    for ( size_t i = 0; i < pcnt; i++ ) {
+        int depth = 1 + rand() % 5;
+        paths[ i ] = slnew( 64 );
+        for ( int d = 0; d < depth; d++ ) {
+            word( buf, 2 + rand() % 6 );
+            slast( &paths[ i ], buf );
+            slach( &paths[ i ], '/' );
+        }
+        word( buf, 3 + rand() % 8 );
+        slast( &paths[ i ], buf );
+        slach( &paths[ i ], '.' );
+        slast( &paths[ i ], exts[ rand() % 6 ] );
+    }
+
+    /* Patterns without "**", since fnmatch does not support it. */
+    for ( size_t k = 0; k < 64; k++ ) {
+        word( buf, 2 );
+        snprintf( buf + 2, sizeof( buf ) - 2, "*/*/[a-m]*.%s", exts[ k % 6 ] );
+        pats[ k ] = strdup( buf );
+    }
+
+    printf( "%-10s %4s  (Mpaths/s)\n", "case", "pats" );
+
+    {
+        const char* one[] = { "*/*/*.log" };
+        const char* set[] = { "*/*.c", "*/*/[a-m]*.h", "*/*/*/?????.txt" };
+        bench( "single", paths, pcnt, one, 1 );
+        bench( "set", paths, pcnt, set, 3 );
+    }
+    bench( "many", paths, pcnt, pats, 16 );
+    bench( "many", paths, pcnt, pats, 64 );
+
+    for ( size_t i = 0; i < pcnt; i++ )
+        sldel( &paths[ i ] );
+    for ( size_t k = 0; k < 64; k++ )
+        free( (char*)pats[ k ] );
+    free( pats );
+    free( paths );
+
+    return 0;
+}
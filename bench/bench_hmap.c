@@ -0,0 +1,185 @@
+/**
+ * @file   bench_hmap.c
+ *
+ * @brief  Benchmark Slinky hash map against a chained hash map.
+ *
+ * Build and run from repository root:
+ *
+ *     gcc -O2 -Isrc src/slinky.c bench/bench_hmap.c -o bench_hmap
+ *     ./bench_hmap [keys]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "slinky.h"
+
+
+/* ------------------------------------------------------------
+ * Chained map (reference).
+ * ------------------------------------------------------------ */
+
+typedef struct chain_node_s chain_node_s;
+
+struct chain_node_s
+{
+    chain_node_s* next;
+    sl_t          key;
+    void*         value;
+};
+
+typedef struct
+{
+    chain_node_s** bucket;
+    size_t         size;
+    size_t         count;
+} chain_map_s;
+
+
+static uint64_t chain_hash( const char* str, size_t len )
+{
+    return sl_hash_sr( sr_new( str, len ) );
+}
+
+
+static void chain_grow( chain_map_s* map )
+{
+    size_t         size = map->size * 2;
+    chain_node_s** bucket = calloc( size, sizeof( chain_node_s* ) );
+
+    for ( size_t i = 0; i < map->size; i++ ) {
+        chain_node_s* n = map->bucket[ i ];
+        while ( n ) {
+            chain_node_s* next = n->next;
+            size_t        b = chain_hash( n->key, sllen( n->key ) ) & ( size - 1 );
+            n->next = bucket[ b ];
+            bucket[ b ] = n;
+            n = next;
+        }
+    }
+    free( map->bucket );
+    map->bucket = bucket;
+    map->size = size;
+}
+
+
+static void chain_put( chain_map_s* map, sl_t key, void* value )
+{
+    size_t        b = chain_hash( key, sllen( key ) ) & ( map->size - 1 );
+    chain_node_s* n;
+
+    for ( n = map->bucket[ b ]; n; n = n->next ) {
+        if ( sllen( n->key ) == sllen( key ) && !memcmp( n->key, key, sllen( key ) ) ) {
+            n->value = value;
+            return;
+        }
+    }
+
+    n = malloc( sizeof( chain_node_s ) );
+    n->key = slrep( key );
+    n->value = value;
+    n->next = map->bucket[ b ];
+    map->bucket[ b ] = n;
+    if ( ++map->count > map->size )
+        chain_grow( map );
+}
+
+
+static void** chain_find( chain_map_s* map, sr_s key )
+{
+    size_t b = chain_hash( key.str, key.len ) & ( map->size - 1 );
+
+    for ( chain_node_s* n = map->bucket[ b ]; n; n = n->next ) {
+        if ( sllen( n->key ) == key.len && !memcmp( n->key, key.str, key.len ) )
+            return &n->value;
+    }
+
+    return NULL;
+}
+
+
+static void chain_del( chain_map_s* map )
+{
+    for ( size_t i = 0; i < map->size; i++ ) {
+        chain_node_s* n = map->bucket[ i ];
+        while ( n ) {
+            chain_node_s* next = n->next;
+            sldel( &n->key );
+            free( n );
+            n = next;
+        }
+    }
+    free( map->bucket );
+}
+
+
+
+/* ------------------------------------------------------------
+ * Benchmark.
+ * ------------------------------------------------------------ */
+
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main( int argc, char** argv )
+{
+    size_t      cnt = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 1000000;
+    sl_t*       keys = malloc( cnt * sizeof( sl_t ) );
+    sl_hmap_t   hmap;
+    chain_map_s cmap;
+    size_t      found;
+    double      t;
+
+    for ( size_t i = 0; i < cnt; i++ ) {
+        keys[ i ] = slnew( 32 );
+        slfmq( &keys[ i ], "metric.host%u.value", (unsigned)( i * 2654435761u ) );
+    }
+
+    /* Slinky hash map. */
+    hmap = sl_hmap_new( 0 );
+    t = now();
+    for ( size_t i = 0; i < cnt; i++ )
+        sl_hmap_put( hmap, keys[ i ], keys[ i ] );
+    printf( "hmap  insert: %8.2f ns/op\n", ( now() - t ) * 1e9 / cnt );
+
+    t = now();
+    found = 0;
+    for ( int r = 0; r < 4; r++ ) {
+        for ( size_t i = 0; i < cnt; i++ )
+            found += sl_hmap_find( hmap, sr_new( keys[ i ], sllen( keys[ i ] ) ) ) != NULL;
+    }
+    printf( "hmap  find:   %8.2f ns/op (%zu)\n", ( now() - t ) * 1e9 / ( 4 * cnt ), found );
+
+    /* Chained map. */
+    cmap.size = 16;
+    cmap.count = 0;
+    cmap.bucket = calloc( cmap.size, sizeof( chain_node_s* ) );
+    t = now();
+    for ( size_t i = 0; i < cnt; i++ )
+        chain_put( &cmap, keys[ i ], keys[ i ] );
+    printf( "chain insert: %8.2f ns/op\n", ( now() - t ) * 1e9 / cnt );
+
+    t = now();
+    found = 0;
+    for ( int r = 0; r < 4; r++ ) {
+        for ( size_t i = 0; i < cnt; i++ )
+            found += chain_find( &cmap, sr_new( keys[ i ], sllen( keys[ i ] ) ) ) != NULL;
+    }
+    printf( "chain find:   %8.2f ns/op (%zu)\n", ( now() - t ) * 1e9 / ( 4 * cnt ), found );
+
+    sl_hmap_del( hmap );
+    chain_del( &cmap );
+    for ( size_t i = 0; i < cnt; i++ )
+        sldel( &keys[ i ] );
+    free( keys );
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file   bench_multi.c
+ *
+ * @brief  Benchmark Slinky multi-pattern search and replace against one
+ *         search (replace) per pattern.
+ *
+ * Build and run from repository root:
+ *
+ *     gcc -O2 -Isrc src/slinky.c bench/bench_multi.c -o bench_multi
+ *     ./bench_multi [lines]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "slinky.h"
+
+
+/* ------------------------------------------------------------
+ * Benchmark.
+ * ------------------------------------------------------------ */
+
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/** Random lowercase word. */
+static void word( char* buf, int len )
+{
+    for ( int i = 0; i < len; i++ )
+        buf[ i ] = 'a' + rand() % 26;
+    buf[ len ] = 0;
+}
+
+
+/**
+ * Count lines with any of "cnt" keywords, and print lines per second
+ * (millions) for per-keyword search and multi-pattern search.
+ */
+static void bench( sl_t* lines, size_t lcnt, const char** keys, size_t cnt )
+{
+    sl_multi_t mp = sl_multi_new( keys, cnt );
+    size_t     r1 = 0, r2 = 0;
+    double     t;
+
+    printf( "%6zu", cnt );
+
+    t = now();
+    for ( size_t i = 0; i < lcnt; i++ ) {
+        for ( size_t k = 0; k < cnt; k++ ) {
+            if ( slidx( lines[ i ], keys[ k ] ) >= 0 ) {
+                r1++;
+                break;
+            }
+        }
+    }
+    printf( "  slidx %8.3f", lcnt / 1e6 / ( now() - t ) );
+
+    t = now();
+    for ( size_t i = 0; i < lcnt; i++ )
+        r2 += ( sl_find_multi( lines[ i ], mp, 0, NULL ) >= 0 );
+    printf( "  multi %8.3f", lcnt / 1e6 / ( now() - t ) );
+
+    printf( "  (Mlines/s)%s\n", ( r1 == r2 ) ? "" : "  MISMATCH" );
+
+    sl_multi_del( mp );
+}
+
+
+/**
+ * Substitute "cnt" template variables, and print templates per second
+ * (thousands) for sl_map_str per variable and sl_map_many.
+ */
+static void bench_map( size_t cnt )
+{
+    const char** pairs = malloc( 2 * cnt * sizeof( char* ) );
+    sl_t         tmpl = slnew( 64 );
+    sl_t         s = slnew( 64 );
+    sl_t         ref;
+    int          rounds = 2000;
+    char         buf[ 32 ];
+    double       t;
+
+    for ( size_t k = 0; k < cnt; k++ ) {
+        snprintf( buf, sizeof( buf ), "{var%zu}", k );
+        pairs[ 2 * k ] = strdup( buf );
+        snprintf( buf, sizeof( buf ), "value-%zu", k * 7 );
+        pairs[ 2 * k + 1 ] = strdup( buf );
+    }
+    for ( int i = 0; i < 200; i++ ) {
+        slast( &tmpl, "text " );
+        slast( &tmpl, pairs[ 2 * ( i % cnt ) ] );
+        slast( &tmpl, " more text, " );
+    }
+
+    printf( "%6zu", cnt );
+
+    t = now();
+    for ( int r = 0; r < rounds; r++ ) {
+        slcpy( &s, tmpl );
+        for ( size_t k = 0; k < cnt; k++ )
+            slmap( &s, pairs[ 2 * k ], pairs[ 2 * k + 1 ] );
+    }
+    printf( "  slmap %8.3f", rounds / 1e3 / ( now() - t ) );
+
+    ref = sldup( s );
+
+    t = now();
+    for ( int r = 0; r < rounds; r++ ) {
+        slcpy( &s, tmpl );
+        sl_map_many( &s, pairs, cnt );
+    }
+    printf( "  many %8.3f", rounds / 1e3 / ( now() - t ) );
+
+    printf( "  (Ktemplates/s)%s\n", !strcmp( ref, s ) ? "" : "  MISMATCH" );
+
+    for ( size_t k = 0; k < 2 * cnt; k++ )
+        free( (char*)pairs[ k ] );
+    free( pairs );
+    sldel( &ref );
+    sldel( &tmpl );
+    sldel( &s );
+}
+
+
+int main( int argc, char** argv )
+{
+    size_t       lcnt = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 100000;
+    sl_t*        lines = malloc( lcnt * sizeof( sl_t ) );
+    const char** keys = malloc( 1000 * sizeof( char* ) );
+    char         buf[ 32 ];
+
+    /* Log lines of random words, some lines have a keyword. */
+    srand( 1 );
+    for ( size_t k = 0; k < 1000; k++ ) {
+        word( buf, 6 + rand() % 6 );
+        keys[ k ] = strdup( buf );
+    }
+    for ( size_t i = 0; i < lcnt; i++ ) {
+        lines[ i ] = slnew( 128 );
+        while ( sllen( lines[ i ] ) < 100 ) {
+            if ( rand() % 64 == 0 )
+                slast( &lines[ i ], keys[ rand() % 1000 ] );
+            else {
+                word( buf, 2 + rand() % 8 );
+                slast( &lines[ i ], buf );
+            }
+            slach( &lines[ i ], ' ' );
+        }
+    }
+
+    printf( "%6s  (Mlines/s)\n", "keys" );
+
+    bench( lines, lcnt, keys, 4 );
+    bench( lines, lcnt, keys, 8 );
+    bench( lines, lcnt, keys, 32 );
+    bench( lines, lcnt, keys, 200 );
+    bench( lines, lcnt, keys, 1000 );
+
+    printf( "\n%6s  (Ktemplates/s)\n", "vars" );
+
+    bench_map( 4 );
+    bench_map( 32 );
+
+    for ( size_t i = 0; i < lcnt; i++ )
+        sldel( &lines[ i ] );
+    for ( size_t k = 0; k < 1000; k++ )
+        free( (char*)keys[ k ] );
+    free( keys );
+    free( lines );
+
+    return 0;
+}
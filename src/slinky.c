@@ -7,6 +7,11 @@
  *
  */
 
+#if defined( SLINKY_USE_MMAP ) && !defined( _GNU_SOURCE )
+/* For mremap. */
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -18,6 +23,33 @@
 
 #include <memtun.h>
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef SLINKY_USE_MMAP
+#include <sys/mman.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined( __ARM_NEON )
+#include <arm_neon.h>
+#endif
+
+#if defined( SLINKY_USE_POOL ) || defined( SLINKY_USE_STATS )
+#include <stdatomic.h>
+#endif
+
+#if defined( SLINKY_USE_POOL ) || defined( SLINKY_USE_INTERN ) || defined( SLINKY_USE_STATS ) \
+    || defined( SLINKY_USE_TRACE )
+#include <pthread.h>
+#endif
+
 #include "slinky.h"
 
 
@@ -31,24 +63,129 @@ const char* slinky_version = "0.0.1";
 /* clang-format off */
 
 /** @cond slinky_none */
-#define sl_malsize(s)  (sizeof(sl_s) + (s))
+#define sl_malsize(c,s) (sl_dsize(c) + (s))
 
-#define sl_smsk        0xFFFFFFFE
+#define sl_smsk        (~(sl_size_t)1)
 
-#define sl_str(s)      ((char*)&((s)->str[0]))
-#define sl_base(s)     ((sl_base_p)((s)-(sizeof(sl_s))))
-#define sl_len(s)      (((sl_base_p)((s)-(sizeof(sl_s))))->len)
-#define sl_len1(s)     ((((sl_base_p)((s)-(sizeof(sl_s))))->len)+1)
-#define sl_res(s)      (((sl_base_p)((s)-(sizeof(sl_s))))->res & sl_smsk)
+#ifndef SLINKY_GROWTH_LIMIT
+#define SLINKY_GROWTH_LIMIT (16*1024*1024)
+#endif
+#define SLINKY_GROWTH_MIN   16
+
+#define sl_cls(s)      (((const uint8_t*)(s))[-1] >> 6)
+#define sl_dsize(c)    ((size_t)2 << (c))
+#define sl_base(s)     ((sl_base_p)((s)-sl_dsize(sl_cls(s))))
+#define sl_len(s)      sl_get_len(s)
+#define sl_len1(s)     (sl_get_len(s)+1)
+#define sl_res(s)      (sl_ext(s) ? sl_xptr(s)->res : (sl_get_res(s) & sl_smsk))
 #define sl_end(s)      ((char*)((s)+sl_len(s)))
+#define sl_add_len(s,n) sl_set_len((s), sl_len(s) + (n))
 
 #define sl_snor(size)  (((size) & 0x1) ? (size) + 1 : (size))
-#define sl_local(s)    (((sl_base_p)((s)-(sizeof(sl_s))))->res&0x1)
+#define sl_local(s)    (sl_get_res(s)&0x1)
+
+#define sl_ext(s)      (sl_get_res(s)==0)
+#define sl_xptr(s)     (((sl_x_p)sl_base(s))-1)
+#define sl_block(s)    (sl_ext(s) ? (void*)sl_xptr(s) : (void*)sl_base(s))
+#define sl_blksize(s)  ((sl_ext(s) ? sizeof(sl_x_s) : 0) + sl_malsize(sl_cls(s), sl_vsize(sl_res(s))))
+#ifdef SLINKY_USE_MMAP
+#define sl_mapped(s)   (sl_blksize(s) + SL_BLK_PAD >= SLINKY_MMAP_MIN)
+#else
+#define sl_mapped(s)   0
+#endif
+#define sl_shared(s)   (sl_ext(s) && sl_x_count(sl_xptr(s)) > 1)
+#define sl_mutate(s)   do { if (!sl_mutable(s)) sl_fatal("in-place modification of shared Slinky"); } while (0)
+#define sl_check(size) do { if ((uint64_t)(size) > SL_STORAGE_MAX) sl_fatal("storage size overflow"); } while (0)
+#define sl_interned(s) (sl_ext(s) && (__atomic_load_n(&sl_xptr(s)->flags, __ATOMIC_RELAXED) & SL_X_INTERN))
+#define sl_hashed(s)   (sl_ext(s) && (__atomic_load_n(&sl_xptr(s)->flags, __ATOMIC_ACQUIRE) & SL_X_HASH))
+#define sl_xhash(s)    __atomic_load_n(&sl_xptr(s)->hash, __ATOMIC_RELAXED)
+
+#ifdef SLINKY_USE_STATS
+#define sl_stat_add(f,n) do { sl_stats_t* st_ = sl_stats_get(); __atomic_store_n(&st_->f, st_->f + (n), __ATOMIC_RELAXED); } while (0)
+#define sl_stat_alloc(n) do { sl_stat_add(allocs, 1); sl_stat_add(hist[sl_stats_bin(n)], 1); } while (0)
+#else
+#define sl_stat_add(f,n) do { (void)(n); } while (0)
+#define sl_stat_alloc(n)
+#endif
+
+#ifdef SLINKY_ALIGN
+#if SLINKY_ALIGN < 16 || SLINKY_ALIGN > 128 || ( SLINKY_ALIGN & ( SLINKY_ALIGN - 1 ) )
+#error "SLINKY_ALIGN must be power of two from 16 to 128."
+#endif
+#define SL_BLK_PAD     SLINKY_ALIGN
+#define sl_vsize(n)    (((size_t)(n) + SLINKY_ALIGN - 1) & ~(size_t)(SLINKY_ALIGN - 1))
+#define sl_apad(p,h)   ((size_t)(-(uintptr_t)((char*)(p) + (h))) & (SLINKY_ALIGN - 1))
+#else
+#define SL_BLK_PAD     0
+#define sl_vsize(n)    (n)
+#define sl_apad(p,h)   ((void)(p), (void)(h), (size_t)0)
+#endif
+
+#define sl_many_align(n) (((n) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1))
+#define sl_many_size(c,s) (sl_many_align(sl_dsize(c) + sl_vsize(s)) + SL_BLK_PAD)
+
+/*
+ * Vector primitives for byte scan kernels. Match mask has SL_VBITS
+ * bits per byte, and SL_VFULL is the mask of all bytes
+ * matching. sl_vlower() is ASCII lowercase.
+ */
+#if defined( __AVX2__ )
+#define SL_VEC         32
+#define SL_VBITS       1
+typedef __m256i        sl_vec_t;
+#define sl_vload(p)    _mm256_loadu_si256((const __m256i*)(p))
+#define sl_vsplat(c)   _mm256_set1_epi8(c)
+#define sl_veq(a,b)    _mm256_cmpeq_epi8(a,b)
+#define sl_vor(a,b)    _mm256_or_si256(a,b)
+#define sl_vand(a,b)   _mm256_and_si256(a,b)
+#define sl_vmask(a)    ((uint64_t)(uint32_t)_mm256_movemask_epi8(a))
+#define sl_vlower(a)   _mm256_or_si256(a, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8((char)0x9a), _mm256_add_epi8(a, _mm256_set1_epi8(0x3f))), _mm256_set1_epi8(0x20)))
+#define SL_VFULL       0xffffffffULL
+#elif defined( __SSE2__ )
+#define SL_VEC         16
+#define SL_VBITS       1
+typedef __m128i        sl_vec_t;
+#define sl_vload(p)    _mm_loadu_si128((const __m128i*)(p))
+#define sl_vsplat(c)   _mm_set1_epi8(c)
+#define sl_veq(a,b)    _mm_cmpeq_epi8(a,b)
+#define sl_vor(a,b)    _mm_or_si128(a,b)
+#define sl_vand(a,b)   _mm_and_si128(a,b)
+#define sl_vmask(a)    ((uint64_t)(uint32_t)_mm_movemask_epi8(a))
+#define sl_vlower(a)   _mm_or_si128(a, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8((char)0x9a), _mm_add_epi8(a, _mm_set1_epi8(0x3f))), _mm_set1_epi8(0x20)))
+#define SL_VFULL       0xffffULL
+#elif defined( __ARM_NEON )
+#define SL_VEC         16
+#define SL_VBITS       4
+typedef uint8x16_t     sl_vec_t;
+#define sl_vload(p)    vld1q_u8((const uint8_t*)(p))
+#define sl_vsplat(c)   vdupq_n_u8((uint8_t)(c))
+#define sl_veq(a,b)    vceqq_u8(a,b)
+#define sl_vor(a,b)    vorrq_u8(a,b)
+#define sl_vand(a,b)   vandq_u8(a,b)
+#define sl_vmask(a)    vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(a), 4)), 0)
+#define sl_vlower(a)   vorrq_u8(a, vandq_u8(vcltq_u8(vsubq_u8(a, vdupq_n_u8('A')), vdupq_n_u8(26)), vdupq_n_u8(0x20)))
+#define SL_VFULL       0xffffffffffffffffULL
+#endif
+
+/** Max set size for vector scan of any char. */
+#define SL_ANY_VEC     8
+
+/**
+ * Max needle length for unbounded first/last byte filter search.
+ * Longer needles switch to Two-Way, if filter verifies too much.
+ */
+#define SL_SEARCH_SHORT 32
+
+/** ASCII lowercase of byte. */
+#define sl_lower(c)    ((uint8_t)((uint8_t)(c) - 'A') < 26 ? (uint8_t)(c) | 0x20 : (uint8_t)(c))
+
+/** ASCII case fold of byte for needle. */
+#define sl_nfold(nd,c) ((nd)->icase ? sl_lower(c) : (uint8_t)(c))
 
 #define sc_len(s)      strlen(s)
 #define sc_len1(s)     (strlen(s)+1)
 
-#define sc_mp(s)       (((sl_base_p)((s)-(sizeof(sl_s))))->mp)
+#define sl_pool_next(b) (*((sl_pool_blk_p*)((b)+1)))
 
 /** @endcond slinky_none */
 
@@ -56,19 +193,234 @@ const char* slinky_version = "0.0.1";
 
 
 
+/**
+ * Extended descriptor, located before the descriptor. Descriptor
+ * storage size is zero for extended Slinky, and the actual storage
+ * size is in extended descriptor.
+ */
+typedef struct
+{
+    uint64_t  hash;  /**< Cached hash (see SL_X_HASH). */
+    sl_size_t res;   /**< Storage size. */
+    uint32_t  ref;   /**< Reference count. */
+    uint32_t  flags; /**< Extension flags. */
+#ifdef SLINKY_ALIGN
+    /** Pad to alignment, i.e. content is aligned also when extended. */
+    char pad[ ( SLINKY_ALIGN - ( 16 + sizeof( sl_size_t ) ) % SLINKY_ALIGN ) % SLINKY_ALIGN ];
+#endif
+} sl_x_s;
+
+/** Pointer to extended descriptor. */
+typedef sl_x_s* sl_x_p;
+
+/** Slinky is shared (duplication shares). */
+#define SL_X_SHARED 0x1
+
+/** Reference count is atomic. */
+#define SL_X_ATOMIC 0x2
+
+/** Slinky is interned. */
+#define SL_X_INTERN 0x4
+
+/** Cached hash is valid. */
+#define SL_X_HASH   0x8
+
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Descriptor class is stored to the most significant byte, little endian only."
+#endif
+
+/** Class bits of descriptor field of class "c". */
+#define SL_CLASS_SHIFT(c) ((8 << (c)) - 2)
+
+/** Largest storage size of descriptor class "c". */
+#define SL_CLASS_MAX(c)   ((((uint64_t)1) << SL_CLASS_SHIFT(c)) - 2)
+
+#ifdef SLINKY_ALIGN
+/** Smallest class with aligned content, i.e. extended descriptor is
+    aligned. Storage is padded anyway. */
+#define SL_CLASS_MIN      2
+#else
+/** Smallest class. */
+#define SL_CLASS_MIN      0
+#endif
+
+
+/**
+ * Return descriptor class for storage size, i.e. the smallest class
+ * with room for "size".
+ *
+ * @param size Storage size.
+ *
+ * @return Class.
+ */
+static inline int sl_class( uint64_t size )
+{
+    if ( SL_CLASS_MIN == 0 && size <= SL_CLASS_MAX( 0 ) )
+        return 0;
+    else if ( SL_CLASS_MIN <= 1 && size <= SL_CLASS_MAX( 1 ) )
+        return 1;
+    else if ( size <= SL_CLASS_MAX( 2 ) )
+        return 2;
+    else
+        return 3;
+}
+
+
+/**
+ * Read descriptor field.
+ *
+ * @param p Field.
+ * @param c Class.
+ *
+ * @return Value.
+ */
+static inline __attribute__( ( always_inline ) ) uint64_t sl_field_get( const char* p, int c )
+{
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+
+    switch ( c ) {
+        case 0:
+            return *(const uint8_t*)p;
+        case 1:
+            memcpy( &v16, p, 2 );
+            return v16;
+        case 2:
+            memcpy( &v32, p, 4 );
+            return v32;
+        default:
+            memcpy( &v64, p, 8 );
+            return v64;
+    }
+}
+
+
+/**
+ * Write descriptor field.
+ *
+ * @param p Field.
+ * @param c Class.
+ * @param v Value.
+ */
+static inline __attribute__( ( always_inline ) ) void sl_field_put( char* p, int c, uint64_t v )
+{
+    uint16_t v16 = v;
+    uint32_t v32 = v;
+
+    switch ( c ) {
+        case 0:
+            *(uint8_t*)p = v;
+            break;
+        case 1:
+            memcpy( p, &v16, 2 );
+            break;
+        case 2:
+            memcpy( p, &v32, 4 );
+            break;
+        default:
+            memcpy( p, &v, 8 );
+            break;
+    }
+}
+
+
+/**
+ * Return length of Slinky.
+ *
+ * @param s Slinky.
+ *
+ * @return Length.
+ */
+static inline __attribute__( ( always_inline ) ) sl_size_t sl_get_len( const char* s )
+{
+    int c = sl_cls( s );
+    return sl_field_get( s - sl_dsize( c ), c );
+}
+
+
+/**
+ * Set length of Slinky.
+ *
+ * @param s   Slinky.
+ * @param len Length.
+ */
+static inline __attribute__( ( always_inline ) ) void sl_set_len( char* s, sl_size_t len )
+{
+    int c = sl_cls( s );
+    sl_field_put( s - sl_dsize( c ), c, len );
+}
+
+
+/**
+ * Return storage field of Slinky, i.e. storage size and local flag (0
+ * for extended).
+ *
+ * @param s Slinky.
+ *
+ * @return Storage field.
+ */
+static inline __attribute__( ( always_inline ) ) sl_size_t sl_get_res( const char* s )
+{
+    int c = sl_cls( s );
+    return sl_field_get( s - sl_dsize( c ) / 2, c ) & ( ( (uint64_t)1 << SL_CLASS_SHIFT( c ) ) - 1 );
+}
+
+
+/**
+ * Set storage field of Slinky, class is kept.
+ *
+ * @param s   Slinky.
+ * @param res Storage field.
+ */
+static inline __attribute__( ( always_inline ) ) void sl_set_res( char* s, sl_size_t res )
+{
+    int c = sl_cls( s );
+    sl_field_put( s - sl_dsize( c ) / 2, c, res | ( (uint64_t)c << SL_CLASS_SHIFT( c ) ) );
+}
+
+
+/**
+ * Setup descriptor of class "c" to start of "mem".
+ *
+ * @param mem Memory for descriptor and content.
+ * @param c   Class.
+ * @param res Storage field (storage size, local flag or 0).
+ * @param len Length.
+ *
+ * @return Slinky.
+ */
+static inline sl_t sl_setup( void* mem, int c, sl_size_t res, sl_size_t len )
+{
+    char* s = (char*)mem + sl_dsize( c );
+
+    sl_field_put( s - sl_dsize( c ) / 2, c, res | ( (uint64_t)c << SL_CLASS_SHIFT( c ) ) );
+    sl_field_put( s - sl_dsize( c ), c, len );
+
+    return s;
+}
+
+
+
 /* ------------------------------------------------------------
  * Utility functions.
  * ------------------------------------------------------------ */
 
 static char*     sl_copy_setup( char* dst, const char* src );
 static off_t     sl_file_size( const char* filename );
-static sl_size_t sl_norm_idx( sl_t ss, int idx );
+static int       sl_read_fd( int fd, char* buf, size_t size );
+static int       sl_write_fd( int fd, const char* buf, size_t size );
+static sl_size_t sl_norm_idx( sl_t ss, sl_pos_t idx );
+static sl_size_t sl_growth_size( sl_size_t res, sl_size_t size );
+static sl_size_t sl_growth_exact( sl_size_t res, sl_size_t size );
+static sl_size_t sl_growth_geometric( sl_size_t res, sl_size_t size );
 static sl_t      sl_copy_base( sl_p s1, const char* s2, sl_size_t len1 );
 static int       sl_compare_base( const void* s1, const void* s2 );
 static sl_t      sl_concatenate_base( sl_p s1, const char* s2, sl_size_t len1 );
-static sl_t      sl_insert_base( sl_p s1, int pos, const char* s2, sl_size_t len1 );
-static int       sl_divide_base( sl_t ss, char c, int size, char** div );
-static int       sl_segment_base( sl_t ss, const char* sc, int size, char** div );
+static sl_t      sl_insert_base( sl_p s1, sl_pos_t pos, const char* s2, sl_size_t len1 );
+static sl_pos_t  sl_divide_base( sl_t ss, char c, sl_pos_t size, char** div );
+static sl_pos_t  sl_segment_base( sl_t ss, sl_needle_t nd, sl_pos_t size, char** div );
 
 static sl_size_t sl_u64_str_len( uint64_t u64 );
 static char*     sl_u64_to_str( uint64_t u64, char* str );
@@ -82,785 +434,1806 @@ static int       sl_str_to_number( const char** str_p );
 static sl_size_t sl_va_format_quick_size( const char* fmt, va_list ap );
 static void      sl_va_format_quick_append( char** wpp, char ch, va_list ap );
 
+static size_t    sl_scan_char( const char* cs, size_t len, char c );
+static size_t    sl_scan_char_rev( const char* cs, size_t len, char c );
+static size_t    sl_scan_count( const char* cs, size_t len, char c );
+static size_t    sl_scan_any( const char* cs, size_t len, const char* set );
+static sl_needle_t sl_needle_create( sr_s sr, int icase );
+
+static int       sl_byte_rank( uint8_t c );
+static void      sl_needle_setup( sl_needle_t nd, const char* str, size_t len );
+static void      sl_needle_rare( sl_needle_t nd );
+static void      sl_needle_twoway( sl_needle_t nd );
+static size_t    sl_search( const char* hay, size_t hlen, const char* ndl, size_t nlen );
+static size_t    sl_needle_find( sl_needle_t nd, const char* hay, size_t hlen, size_t pos );
+static size_t    sl_search_filter( sl_needle_t nd, const char* hay, size_t hlen, size_t pos );
+static size_t    sl_search_filter_icase( sl_needle_t nd, const char* hay, size_t hlen, size_t pos );
+static int       sl_mem_icase( const char* s1, const char* s2, size_t len );
+static size_t    sl_search_twoway( sl_needle_t nd, const char* hay, size_t hlen, size_t pos, int last );
+static size_t    sl_search_twoway_rev( sl_needle_t nd, const char* hay, size_t hlen );
+static size_t    sl_needle_find_rev( sl_needle_t nd, const char* hay, size_t hlen );
+static void      sl_multi_build( sl_multi_t mp );
+static size_t    sl_multi_find( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id );
+static size_t    sl_multi_scan( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id );
+static size_t    sl_multi_small( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id );
+static int       sl_multi_verify( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id );
+static sl_size_t sl_multi_all( sl_multi_t mp, sr_s sr, sl_match_s* match, sl_size_t size );
+static size_t    sl_glob_parse( const char* pat, size_t len, uint64_t ( *set )[ 4 ], uint8_t* flag );
+static size_t    sl_glob_class( const char* pat, size_t len, size_t i, uint64_t* set );
+static void      sl_glob_build( sl_glob_t gp, const sr_s* pats );
+static void      sl_glob_dfa( sl_glob_t gp );
+static uint64_t  sl_glob_close( sl_glob_t gp, uint64_t* st );
+static size_t    sl_glob_run( sl_glob_t gp, const char* str, size_t len );
+
+static uint64_t  sl_hash_base( const char* cs, sl_size_t len );
+static uint64_t  sl_hash_icase_base( const char* cs, sl_size_t len );
+static sl_t      sl_new_ext( sl_size_t size, uint32_t flags );
+static sl_t      sl_resize( sl_t ss, sl_size_t size );
+static sl_v      sl_many_alloc( sl_size_t cnt, size_t size );
+static sl_t      sl_many_setup( char** mem, int cls, sl_size_t res, sl_size_t len );
+static sl_x_p    sl_extend( sl_p sp, uint32_t flags );
+static void      sl_x_retain( sl_x_p x );
+static uint32_t  sl_x_release( sl_x_p x );
+static uint32_t  sl_x_count( sl_x_p x );
+static int       sl_mutable( sl_t ss );
+static void      sl_fatal( const char* msg ) __attribute__( ( noreturn, cold ) );
+
+static uint32_t  sl_hmap_match( const int8_t* ctrl, int8_t c );
+static uint32_t  sl_hmap_match_free( const int8_t* ctrl );
+static size_t    sl_hmap_lookup( sl_hmap_t map, const char* key, sl_size_t len, uint64_t hash );
+static size_t    sl_hmap_insert( sl_hmap_t map, uint64_t hash );
+static void      sl_hmap_rehash( sl_hmap_t map, size_t cap );
+static void      sl_hmap_alloc( sl_hmap_t map, size_t cap );
+
+static void*     sl_arena_alloc( sl_arena_t arena, size_t size, size_t head );
+static int       sl_arena_extend( sl_arena_t arena, void* ptr, size_t size );
+
+static void*     sl_mem_alloc( size_t size );
+static void*     sl_mem_realloc( void* ptr, size_t old, size_t size );
+static void      sl_mem_free( void* ptr, size_t size );
+static size_t    sl_mem_usable( void* ptr, size_t size );
+static size_t    sl_mem_usable_base( void* ptr, size_t size );
+static void*     sl_blk_alloc( size_t size, size_t head );
+static void*     sl_blk_realloc( void* blk, size_t old, size_t size, size_t head );
+static void      sl_blk_free( void* blk, size_t size );
+static size_t    sl_blk_usable( void* blk, size_t size );
+#ifdef SLINKY_USE_MMAP
+static size_t    sl_map_size( size_t size );
+static void*     sl_map_alloc( size_t size );
+static void*     sl_map_realloc( void* ptr, size_t old, size_t size );
+static void      sl_map_free( void* ptr, size_t size );
+#endif
+static sl_size_t sl_harvest( void* ptr, size_t head, sl_size_t size, int cls );
+
 
 #ifdef SLINKY_USE_MEMTUN
-static mt_t slinky_mt = NULL;
+
+/** Max depth of per-thread memtun context stack. */
+#define SL_MT_DEPTH 16
+
+/**
+ * Memtun block header. Allocator is stored to block, since block may
+ * be resized and freed in other context.
+ */
+typedef struct
+{
+    mt_t     mt;  /**< Allocator of block. */
+    uint64_t pad; /**< Padding for alignment. */
+} sl_mt_blk_s;
+
+typedef sl_mt_blk_s* sl_mt_blk_p;
+
+static mt_t                slinky_mt = NULL;
+static _Thread_local mt_t  sl_mt_stack[ SL_MT_DEPTH ];
+static _Thread_local int   sl_mt_depth = 0;
 
 void sl_set_memtun( mt_t mt )
 {
-    slinky_mt = mt;
+    __atomic_store_n( &slinky_mt, mt, __ATOMIC_RELEASE );
 }
 
 mt_t sl_get_memtun( void )
 {
-    return slinky_mt;
+    if ( sl_mt_depth > 0 )
+        return sl_mt_stack[ sl_mt_depth - 1 ];
+    return __atomic_load_n( &slinky_mt, __ATOMIC_ACQUIRE );
+}
+
+void sl_push_memtun( mt_t mt )
+{
+    if ( sl_mt_depth >= SL_MT_DEPTH )
+        sl_fatal( "memtun context stack overflow" );
+    sl_mt_stack[ sl_mt_depth++ ] = mt;
 }
+
+mt_t sl_pop_memtun( void )
+{
+    if ( sl_mt_depth <= 0 )
+        sl_fatal( "memtun context stack underflow" );
+    return sl_mt_stack[ --sl_mt_depth ];
+}
+
 #endif
 
 
+/* Growth policy is a single function, hence it is set atomically. */
+static sl_growth_fn_t slinky_growth_fn = sl_growth_exact;
+static int            slinky_harvest = 0;
 
 
-/* ------------------------------------------------------------
- * Library
- * ------------------------------------------------------------ */
+/** Arena chunk. */
+typedef struct sl_arena_chunk_s
+{
+    struct sl_arena_chunk_s* next; /**< Next chunk. */
+    size_t                   size; /**< Chunk storage size. */
+    char                     mem[ 0 ] __attribute__( ( aligned( 8 ) ) ); /**< Storage. */
+} sl_arena_chunk_s;
 
-sl_t sl_new( sl_size_t size )
+typedef sl_arena_chunk_s* sl_arena_chunk_p;
+
+/** Arena. */
+struct sl_arena_s
 {
-    sl_base_p s;
+    sl_arena_chunk_p first; /**< First chunk. */
+    sl_arena_chunk_p cur;   /**< Current chunk. */
+    size_t           used;  /**< Used bytes in current chunk. */
+    char*            last;  /**< Last allocation. */
+    size_t           size;  /**< Chunk size. */
+};
+
+static _Thread_local sl_arena_t slinky_arena = NULL;
 
-    size = sl_snor( size );
-#ifdef SLINKY_USE_MEMTUN
-    s = (sl_base_p)mt_alloc( slinky_mt, sl_malsize( size ) );
-#else
-    s = (sl_base_p)sl_malloc( sl_malsize( size ) );
-    // memset( s, 0, sl_malsize( size ) );
-#endif
-    s->res = size;
-    s->len = 0;
-    s->str[ 0 ] = 0;
-    return sl_str( s );
-}
 
+/** Hash map group size (control bytes). */
+#define SL_HMAP_GROUP   16
 
-sl_t sl_use( void* mem, sl_size_t size )
+/** Control byte for empty slot. */
+#define SL_HMAP_EMPTY   ( (int8_t)-128 )
+
+/** Control byte for deleted slot. */
+#define SL_HMAP_DELETED ( (int8_t)-2 )
+
+/** Hash map slot. */
+typedef struct
 {
-    assert( ( size & 0x1 ) == 0 );
+    sl_t  key;   /**< Key. */
+    void* value; /**< Value. */
+} sl_hmap_slot_s;
 
-    sl_base_p s = mem;
-    s->res = size - sizeof( sl_s );
-    /* Mark allocation as static. */
-    s->res = s->res | 0x1;
-    s->len = 0;
-    s->str[ 0 ] = 0;
-    return sl_str( s );
-}
+/**
+ * Hash map. Control byte is negative for free slot, and 7 bits of
+ * hash for used slot.
+ */
+struct sl_hmap_s
+{
+    int8_t*         ctrl;  /**< Control bytes. */
+    sl_hmap_slot_s* slot;  /**< Slots. */
+    size_t          cap;   /**< Slot count (power of two, at least group). */
+    size_t          count; /**< Entry count. */
+    size_t          left;  /**< Empty slots usable before rehash. */
+};
 
 
-sl_t sl_del( sl_p sp )
+/**
+ * Needle for search. Filter offsets are the first and the last byte,
+ * or the two rarest bytes for compiled needle. Two-Way tables are
+ * valid when period "p" is non-zero.
+ */
+struct sl_needle_s
 {
-    sl_del2( *sp );
-    *sp = 0;
-    return NULL;
-}
+    char*    str;          /**< Needle string. */
+    size_t   len;          /**< Needle length. */
+    size_t   off0;         /**< Rarest byte offset. */
+    size_t   off1;         /**< Second rarest byte offset. */
+    int      icase;        /**< ASCII case-insensitive. */
+    size_t   ms;           /**< Critical factorization position. */
+    size_t   p;            /**< Needle period (or shift for non-periodic). */
+    size_t   mem0;         /**< Memory after period shift. */
+    uint64_t set[ 4 ];     /**< Needle byte set. */
+    size_t   shift[ 256 ]; /**< Last position (+1) of byte in needle. */
+};
 
 
-void sl_del2( sl_t ss )
+/** Maximum pattern count for fingerprint search. */
+#define SL_MULTI_SMALL 8
+
+/** No pattern for automaton state. */
+#define SL_MULTI_NONE UINT32_MAX
+
+/**
+ * Multi-pattern search. Automaton transition table "next" has
+ * "ncls" columns (byte classes) per state, and failure transitions
+ * are resolved in the table. Small pattern set uses fingerprint
+ * search instead (when "fcnt" is non-zero).
+ */
+struct sl_multi_s
 {
-#ifdef SLINKY_USE_MEMTUN
-    if ( !sl_get_local( ss ) )
-        mt_free( slinky_mt, sl_base( ss ) );
-#else
-    if ( !sl_get_local( ss ) )
-        sl_free( sl_base( ss ) );
-#endif
-}
+    sr_s*     pat;                       /**< Patterns (copies). */
+    size_t    cnt;                       /**< Pattern count. */
+    uint16_t  cls[ 256 ];                /**< Byte class. */
+    size_t    ncls;                      /**< Byte class count. */
+    uint32_t* next;                      /**< Transitions. */
+    uint32_t* out;                       /**< Longest pattern ending at state. */
+    uint32_t* depth;                     /**< State depth. */
+    size_t    fcnt;                      /**< Fingerprint pattern count. */
+    size_t    flen;                      /**< Fingerprint length (1 or 2). */
+    uint32_t  ford[ SL_MULTI_SMALL ];    /**< Patterns, longest first. */
+    char      fp[ 2 ][ SL_MULTI_SMALL ]; /**< Fingerprint bytes. */
+};
 
 
-sl_t sl_reserve( sl_p sp, sl_size_t size )
+/** Glob token has self loop ("*"). */
+#define SL_GLOB_STAR 1
+
+/** Glob token is entry to optional directories ("**" and "/"). */
+#define SL_GLOB_OPT 2
+
+/** Max state words on stack for glob match. */
+#define SL_GLOB_STACK 16
+
+/** Max DFA state count for glob. */
+#define SL_GLOB_DFA 256
+
+/**
+ * Compiled glob patterns, i.e. bit-parallel NFA. State bit is a
+ * position in pattern tokens. Patterns are laid out consecutively, and
+ * each pattern has an accept bit after its last token. "mask" has
+ * "words" per byte class, and it marks the positions consuming the
+ * byte.
+ *
+ * Single word NFA is converted to DFA, if it has at most SL_GLOB_DFA
+ * states. DFA transition is the offset of the next state row in
+ * "dfa", and state 0 is dead.
+ */
+struct sl_glob_s
 {
-    if ( sl_res( *sp ) < size ) {
-        sl_base_p s;
-        size = sl_snor( size );
-        s = sl_base( *sp );
-        if ( sl_get_local( *sp ) ) {
-            sl_t sn;
-            sn = sl_new( size );
-            sl_len( sn ) = sl_len( *sp );
-            memcpy( sn, *sp, sl_len1( sn ) );
-            s = sl_base( sn );
-        } else {
+    size_t    cnt;        /**< Pattern count. */
+    size_t    words;      /**< State words. */
+    uint16_t  cls[ 256 ]; /**< Byte class. */
+    size_t    ncls;       /**< Byte class count. */
+    uint64_t* mask;       /**< Consuming positions per class. */
+    uint64_t* star;       /**< Positions with self loop. */
+    uint64_t* opt;        /**< Optional directory entry positions. */
+    uint64_t* init;       /**< Initial state. */
+    uint64_t* acc;        /**< Accept positions. */
+    uint32_t* pid;        /**< Pattern of position. */
+    uint32_t* dfa;        /**< DFA transitions (or NULL). */
+    uint32_t* dacc;       /**< DFA state pattern (or SL_MULTI_NONE). */
+};
+
+
+#ifdef SLINKY_USE_POOL
+
 #ifdef SLINKY_USE_MEMTUN
-            s = (sl_base_p)mt_realloc( slinky_mt, s, sl_malsize( size ) );
-#else
-            s = (sl_base_p)sl_realloc( s, sl_malsize( size ) );
+#error "SLINKY_USE_POOL and SLINKY_USE_MEMTUN are exclusive."
 #endif
-            s->res = size;
-        }
-        *sp = sl_str( s );
-    }
 
-    return *sp;
-}
+/*
+ * Pool allocator.
+ *
+ * Slinky allocations are served from per-thread free lists of
+ * power-of-two size classes. Each block has a header with the owning
+ * pool and size class. Block freed by the owner thread is pushed to
+ * the owner's free list. Block freed by other thread is pushed to the
+ * owner's "remote" stack (lock-free), and the owner collects the
+ * remote blocks when its free list runs empty.
+ *
+ * Allocations bigger than the largest size class are passed to the
+ * system allocator (with block header).
+ */
 
+/** Smallest size class (log2). */
+#define SL_POOL_MIN_SHIFT 4
 
-sl_t sl_compact( sl_p sp )
+/** Number of size classes (16 B ... 64 KiB). */
+#define SL_POOL_CLASSES   13
+
+typedef struct sl_pool_s     sl_pool_s;
+typedef sl_pool_s*           sl_pool_p;
+typedef struct sl_pool_blk_s sl_pool_blk_s;
+typedef sl_pool_blk_s*       sl_pool_blk_p;
+
+/** Pool block header. */
+struct sl_pool_blk_s
 {
-    sl_size_t len = sl_len1( *sp );
+    sl_pool_p owner; /**< Owning pool (NULL for system blocks). */
+    uint32_t  cls;   /**< Size class. */
+    uint32_t  pad;   /**< Padding for alignment. */
+};
 
-    len = sl_snor( len );
-    if ( sl_res( *sp ) > len ) {
-        sl_base_p s;
-        s = sl_base( *sp );
-        if ( !sl_get_local( *sp ) ) {
-#ifdef SLINKY_USE_MEMTUN
-            s = (sl_base_p)mt_realloc( slinky_mt, s, sl_malsize( len ) );
-#else
-            s = (sl_base_p)sl_realloc( s, sl_malsize( len ) );
-#endif
-            s->res = len;
-            *sp = sl_str( s );
-        }
-    }
+/** Per-thread pool. */
+struct sl_pool_s
+{
+    sl_pool_blk_p            free[ SL_POOL_CLASSES ]; /**< Free lists. */
+    _Atomic( sl_pool_blk_p ) remote;                  /**< Blocks freed by others. */
+    atomic_int               orphan;                  /**< Owner has exited. */
+    atomic_size_t            live;                    /**< Blocks and owner, see sl_pool_unref(). */
+};
 
-    return *sp;
-}
+static _Thread_local sl_pool_p sl_pool_local = NULL;
+static pthread_key_t           sl_pool_key;
+static pthread_once_t          sl_pool_once = PTHREAD_ONCE_INIT;
 
+static uint32_t  sl_pool_class( size_t size );
+static size_t    sl_pool_size( uint32_t cls );
+static void      sl_pool_drain( sl_pool_p pool );
+static void      sl_pool_release( sl_pool_p pool );
+static void      sl_pool_unref( sl_pool_p pool );
+static sl_pool_p sl_pool_get( void );
 
-sl_t sl_copy( sl_p s1, sl_t s2 )
+
+void sl_pool_trim( void )
 {
-    return sl_copy_base( s1, s2, sl_len1( s2 ) );
+    if ( sl_pool_local )
+        sl_pool_release( sl_pool_local );
 }
 
+#endif
+
 
-sl_t sl_copy_c( sl_p s1, const char* s2 )
+#ifdef SLINKY_USE_STATS
+
+/*
+ * Statistics.
+ *
+ * Each thread updates its own counter block without locks. Blocks are
+ * linked to a global list and snapshot sums all blocks. Block of an
+ * exited thread is reused by a new thread, hence counts are never
+ * lost.
+ */
+
+typedef struct sl_stats_blk_s sl_stats_blk_s;
+typedef sl_stats_blk_s*       sl_stats_blk_p;
+
+/** Per-thread counter block. */
+struct sl_stats_blk_s
 {
-    return sl_copy_base( s1, s2, sc_len1( s2 ) );
-}
+    sl_stats_t     st;   /**< Counters. */
+    sl_stats_blk_p next; /**< Next block in list. */
+    atomic_int     used; /**< Block is used by a thread. */
+};
 
+static _Thread_local sl_stats_blk_p sl_stats_local = NULL;
+static _Atomic( sl_stats_blk_p )    sl_stats_list = NULL;
+static pthread_key_t                sl_stats_key;
+static pthread_once_t               sl_stats_once = PTHREAD_ONCE_INIT;
 
-sl_t sl_append_char( sl_p sp, char c )
+static sl_stats_t* sl_stats_get( void );
+static int         sl_stats_bin( uint64_t size );
+
+
+void sl_stats_snapshot( sl_stats_t* stats )
 {
-    sl_size_t len = sl_len( *sp );
-    sl_reserve( sp, len + 1 + 1 );
-    char* p = &( ( *sp )[ len ] );
-    *p++ = c;
-    *p = 0;
-    sl_len( *sp ) += 1;
-    return *sp;
+    memset( stats, 0, sizeof( sl_stats_t ) );
+
+    for ( sl_stats_blk_p b = atomic_load( &sl_stats_list ); b; b = b->next ) {
+        stats->allocs += __atomic_load_n( &b->st.allocs, __ATOMIC_RELAXED );
+        stats->frees += __atomic_load_n( &b->st.frees, __ATOMIC_RELAXED );
+        stats->reallocs += __atomic_load_n( &b->st.reallocs, __ATOMIC_RELAXED );
+        stats->promotions += __atomic_load_n( &b->st.promotions, __ATOMIC_RELAXED );
+        stats->compacts += __atomic_load_n( &b->st.compacts, __ATOMIC_RELAXED );
+        stats->compact_bytes += __atomic_load_n( &b->st.compact_bytes, __ATOMIC_RELAXED );
+        stats->res_live += __atomic_load_n( &b->st.res_live, __ATOMIC_RELAXED );
+        stats->res_freed += __atomic_load_n( &b->st.res_freed, __ATOMIC_RELAXED );
+        stats->len_freed += __atomic_load_n( &b->st.len_freed, __ATOMIC_RELAXED );
+        for ( int i = 0; i < SL_STATS_HIST; i++ )
+            stats->hist[ i ] += __atomic_load_n( &b->st.hist[ i ], __ATOMIC_RELAXED );
+    }
 }
 
 
-sl_t sl_append_n_char( sl_p sp, char c, sl_size_t n )
+void sl_stats_dump( const sl_stats_t* stats )
 {
-    sl_size_t len = sl_len( *sp );
-    sl_reserve( sp, len + n + 1 );
-    char* p = &( ( *sp )[ len ] );
-    for ( sl_size_t i = 0; i < n; i++, p++ )
-        *p = c;
-    *p = 0;
-    sl_len( *sp ) += n;
-    return *sp;
+    printf( "allocs:        %llu\n", (unsigned long long)stats->allocs );
+    printf( "frees:         %llu\n", (unsigned long long)stats->frees );
+    printf( "reallocs:      %llu\n", (unsigned long long)stats->reallocs );
+    printf( "promotions:    %llu\n", (unsigned long long)stats->promotions );
+    printf( "compacts:      %llu\n", (unsigned long long)stats->compacts );
+    printf( "compact bytes: %llu\n", (unsigned long long)stats->compact_bytes );
+    printf( "live storage:  %lld\n", (long long)stats->res_live );
+    printf( "freed storage: %llu\n", (unsigned long long)stats->res_freed );
+    printf( "freed length:  %llu\n", (unsigned long long)stats->len_freed );
+    if ( stats->res_freed > 0 )
+        printf( "freed slack:   %.1f%%\n",
+                100.0 * ( stats->res_freed - stats->len_freed ) / stats->res_freed );
+    printf( "allocation sizes:\n" );
+    for ( int i = 0; i < SL_STATS_HIST; i++ ) {
+        if ( stats->hist[ i ] > 0 )
+            printf( "  >= %-12llu %llu\n", ( i > 0 ) ? 1ULL << i : 0ULL,
+                    (unsigned long long)stats->hist[ i ] );
+    }
 }
 
+#endif
 
-sl_t sl_append_substr( sl_p sp, const char* cs, sl_size_t clen )
-{
-    sl_size_t len = sl_len( *sp );
-    sl_reserve( sp, len + clen + 1 );
-    char* p = &( ( *sp )[ len ] );
-    memcpy( p, cs, clen );
-    p += clen;
-    *p = 0;
-    sl_len( *sp ) += clen;
-    return *sp;
-}
 
+#ifdef SLINKY_USE_TRACE
 
-sl_t sl_append_str( sl_p sp, const char* cs )
+/*
+ * Promotion tracing.
+ *
+ * sl_use_at() registers the callsite of local Slinky to a per-thread
+ * table, indexed by Slinky address. Promotion (sl_reserve()) finds
+ * the callsite and updates the global callsite records. Promotions of
+ * unregistered local Slinky strings (arena) are recorded with
+ * unknown callsite.
+ */
+
+/** Per-thread callsite registrations (power of two). */
+#define SL_TRACE_LOCALS 64
+
+/** Maximum number of recorded callsites. */
+#define SL_TRACE_SITES  256
+
+/** Callsite registration of local Slinky. */
+typedef struct
 {
-    sl_size_t len = sl_len( *sp );
-    sl_size_t clen = sc_len( cs );
-    sl_reserve( sp, len + clen + 1 );
-    char* p = &( ( *sp )[ len ] );
-    memcpy( p, cs, clen );
-    p += clen;
-    *p = 0;
-    sl_len( *sp ) += clen;
-    return *sp;
-}
+    const void* ss;   /**< Slinky. */
+    const char* file; /**< Callsite file. */
+    int         line; /**< Callsite line. */
+} sl_trace_local_s;
 
+static _Thread_local sl_trace_local_s sl_trace_local[ SL_TRACE_LOCALS ];
+static sl_trace_t                     sl_trace_site[ SL_TRACE_SITES ];
+static int                            sl_trace_sites = 0;
+static pthread_mutex_t                sl_trace_lock = PTHREAD_MUTEX_INITIALIZER;
 
-sl_t sl_append_n_str( sl_p sp, const char* cs, sl_size_t n )
+static void sl_trace_promotion( sl_t ss, sl_size_t size );
+static int  sl_trace_compare( const void* t1, const void* t2 );
+
+
+sl_t sl_use_at( void* mem, sl_size_t size, const char* file, int line )
 {
-    sl_size_t len = sl_len( *sp );
-    sl_size_t clen = sc_len( cs );
+    sl_t              ss = ( sl_use )( mem, size );
+    sl_trace_local_s* r = &sl_trace_local[ ( (uintptr_t)ss >> 3 ) & ( SL_TRACE_LOCALS - 1 ) ];
 
-    sl_reserve( sp, len + n * clen + 1 );
-    char* p = &( ( *sp )[ len ] );
-    for ( sl_size_t i = 0; i < n; i++, p += clen )
-        memcpy( p, cs, clen );
-    *p = 0;
-    sl_len( *sp ) += n * clen;
-    return *sp;
+    r->ss = ss;
+    r->file = file;
+    r->line = line;
+
+    return ss;
 }
 
 
-sl_t sl_append_sr( sl_p sp, sr_s sr )
+int sl_trace_worst( sl_trace_t* trace, int cnt )
 {
-    return sl_append_substr( sp, sr.str, sr.len );
+    pthread_mutex_lock( &sl_trace_lock );
+    qsort( sl_trace_site, sl_trace_sites, sizeof( sl_trace_t ), sl_trace_compare );
+    if ( cnt > sl_trace_sites )
+        cnt = sl_trace_sites;
+    memcpy( trace, sl_trace_site, cnt * sizeof( sl_trace_t ) );
+    pthread_mutex_unlock( &sl_trace_lock );
+
+    return cnt;
 }
 
 
-sl_t sl_append_va_str( sl_p sp, const char* cs, ... )
+void sl_trace_report( int cnt )
 {
-    if ( cs == NULL )
-        return *sp;
+    sl_trace_t trace[ SL_TRACE_SITES ];
+
+    if ( cnt > SL_TRACE_SITES )
+        cnt = SL_TRACE_SITES;
+    cnt = sl_trace_worst( trace, cnt );
+
+    printf( "%-40s %10s %10s %10s\n", "callsite", "promotions", "size", "needed" );
+    for ( int i = 0; i < cnt; i++ ) {
+        char site[ 64 ];
+        snprintf( site, 64, "%s:%d", trace[ i ].file, trace[ i ].line );
+        printf( "%-40s %10llu %10llu %10llu\n",
+                site,
+                (unsigned long long)trace[ i ].count,
+                (unsigned long long)trace[ i ].size,
+                (unsigned long long)trace[ i ].needed );
+    }
+}
 
-    sl_size_t len = sl_len( *sp );
-    sl_size_t clen = sc_len( cs );
 
-    va_list   va;
-    sl_size_t va_len;
+void sl_trace_reset( void )
+{
+    pthread_mutex_lock( &sl_trace_lock );
+    sl_trace_sites = 0;
+    pthread_mutex_unlock( &sl_trace_lock );
+}
 
-    va_start( va, cs );
-    va_len = clen + sl_va_str_len( va );
-    va_end( va );
+#endif
 
-    sl_reserve( sp, len + va_len + 1 );
 
-    char*       p = &( ( *sp )[ len ] );
-    const char* p2;
-    memcpy( p, cs, clen );
-    p += clen;
+#ifdef SLINKY_USE_INTERN
 
-    va_start( va, cs );
-    while ( ( cs = va_arg( va, char* ) ) != NULL ) {
-        p2 = cs;
-        while ( *p2 )
-            *p++ = *p2++;
-    }
-    va_end( va );
+/*
+ * Intern table.
+ *
+ * Interned Slinky is shared with atomic reference count, and the
+ * table holds one reference. Table is split to shards by hash. Each
+ * shard has its own lock and open addressing (linear probing) slot
+ * array.
+ */
 
-    *p = 0;
-    sl_len( *sp ) += va_len;
+/** Number of shards (log2). */
+#define SL_INTERN_SHIFT 6
 
-    return *sp;
-}
+/** Number of shards. */
+#define SL_INTERN_SHARDS ( 1 << SL_INTERN_SHIFT )
 
+/** Initial slot count of shard. */
+#define SL_INTERN_MIN 16
 
-sl_t sl_duplicate( sl_t ss )
+/** Intern table slot. */
+typedef struct
 {
-    sl_t sn;
-    sn = sl_new( sl_res( ss ) );
-    sl_copy( &sn, ss );
-    return sn;
-}
-
+    uint64_t hash; /**< Content hash. */
+    sl_t     str;  /**< Interned Slinky (NULL for free slot). */
+} sl_intern_slot_s;
 
-char* sl_duplicate_c( sl_t ss )
+/** Intern table shard. */
+typedef struct
 {
-    sl_size_t len1 = sl_len1( ss );
-#ifdef SLINKY_USE_MEMTUN
-    char* dup = mt_alloc( slinky_mt, len1 );
-#else
-    char* dup = sl_malloc( len1 );
-#endif
-    memcpy( dup, ss, len1 );
-    return dup;
-}
+    pthread_mutex_t   lock;    /**< Shard lock. */
+    sl_intern_slot_s* slot;    /**< Slots. */
+    size_t            size;    /**< Slot count (power of two). */
+    size_t            count;   /**< Used slots. */
+    size_t            bytes;   /**< String memory. */
+    size_t            lookups; /**< Intern requests. */
+    size_t            hits;    /**< Requests with existing string. */
+} sl_intern_shard_s;
 
+static sl_intern_shard_s sl_intern_shard[ SL_INTERN_SHARDS ];
+static pthread_once_t    sl_intern_once = PTHREAD_ONCE_INIT;
 
-sl_t sl_replicate( sl_t ss )
+static void     sl_intern_init( void );
+static void     sl_intern_rehash( sl_intern_shard_s* sh, size_t size );
+static sl_t     sl_intern_base( const char* cs, sl_size_t len );
+
+
+sl_t sl_intern( sl_t ss )
 {
-    sl_t sn;
-    sn = sl_new( sl_len1( ss ) );
-    sl_copy( &sn, ss );
-    return sn;
+    if ( sl_interned( ss ) ) {
+        sl_x_retain( sl_xptr( ss ) );
+        return ss;
+    }
+
+    return sl_intern_base( ss, sl_len( ss ) );
 }
 
 
-char* sl_drop( sl_t ss )
+sl_t sl_intern_c( const char* cs )
 {
-    char* ret = (char*)sl_base( ss );
-    memmove( ret, (void*)ss, sl_len1( ss ) );
-    return ret;
+    return sl_intern_base( cs, sc_len( cs ) );
 }
 
 
-sl_t sl_clear( sl_t ss )
+sl_t sl_intern_sr( sr_s sr )
 {
-    sl_len( ss ) = 0;
-    *ss = 0;
-    return ss;
+    return sl_intern_base( sr.str, sr.len );
 }
 
 
-sl_t sl_from_str_c( const char* cs )
+int sl_is_interned( sl_t ss )
 {
-    sl_size_t len = sc_len1( cs );
-    sl_t      ss = sl_new( len );
-    memcpy( ss, cs, len );
-    sl_len( ss ) = len - 1;
-    return ss;
+    if ( sl_interned( ss ) )
+        return 1;
+    else
+        return 0;
 }
 
 
-sl_t sl_from_len_c( const char* cs, sl_size_t clen )
+size_t sl_intern_sweep( void )
 {
-    sl_size_t len = clen + 1;
-    sl_t      ss = sl_new( len );
-    memcpy( ss, cs, len );
-    sl_len( ss ) = len - 1;
-    return ss;
+    size_t cnt = 0;
+
+    pthread_once( &sl_intern_once, sl_intern_init );
+
+    for ( int i = 0; i < SL_INTERN_SHARDS; i++ ) {
+        sl_intern_shard_s* sh = &sl_intern_shard[ i ];
+        size_t             evicted = 0;
+        pthread_mutex_lock( &sh->lock );
+        for ( size_t j = 0; j < sh->size; j++ ) {
+            sl_t s = sh->slot[ j ].str;
+            /* Only the table references, and new references are
+               created only while shard is locked. */
+            if ( s && sl_x_count( sl_xptr( s ) ) == 1 ) {
+                sh->bytes -= sizeof( sl_x_s ) + sl_malsize( sl_cls( s ), sl_res( s ) );
+                sl_blk_free( sl_xptr( s ), sl_blksize( s ) );
+                sh->slot[ j ].str = NULL;
+                evicted++;
+            }
+        }
+        if ( evicted > 0 ) {
+            sh->count -= evicted;
+            cnt += evicted;
+            /* Rebuild probe sequences. */
+            sl_intern_rehash( sh, sh->size );
+        }
+        pthread_mutex_unlock( &sh->lock );
+    }
+
+    return cnt;
 }
 
 
-sl_t sl_from_va_str_c( const char* cs, ... )
+void sl_intern_stats( sl_intern_stats_t* stats )
 {
-    if ( cs == NULL )
-        return NULL;
+    memset( stats, 0, sizeof( sl_intern_stats_t ) );
+
+    pthread_once( &sl_intern_once, sl_intern_init );
+
+    for ( int i = 0; i < SL_INTERN_SHARDS; i++ ) {
+        sl_intern_shard_s* sh = &sl_intern_shard[ i ];
+        pthread_mutex_lock( &sh->lock );
+        stats->count += sh->count;
+        stats->bytes += sh->bytes;
+        stats->table += sh->size * sizeof( sl_intern_slot_s );
+        stats->lookups += sh->lookups;
+        stats->hits += sh->hits;
+        pthread_mutex_unlock( &sh->lock );
+    }
+}
 
-    sl_size_t clen = sc_len( cs );
+#endif
 
-    va_list   va;
-    sl_size_t va_len;
 
-    va_start( va, cs );
-    va_len = clen + sl_va_str_len( va );
-    va_end( va );
 
-    sl_size_t   len = va_len + 1;
-    sl_t        ss = sl_new( len );
-    char*       p;
-    const char* p2;
 
-    p = (char*)ss;
+/* ------------------------------------------------------------
+ * Library
+ * ------------------------------------------------------------ */
 
-    memcpy( p, cs, clen );
-    p += clen;
+sl_t sl_new( sl_size_t size )
+{
+    sl_t s;
+    int  c;
 
-    va_start( va, cs );
-    while ( ( cs = va_arg( va, char* ) ) != NULL ) {
-        p2 = cs;
-        while ( *p2 )
-            *p++ = *p2++;
+    sl_check( size );
+    size = sl_snor( size );
+    /* Room for terminating null. */
+    if ( size == 0 )
+        size = 2;
+    c = sl_class( size );
+    sl_stat_alloc( size );
+    if ( slinky_arena ) {
+        s = sl_setup( sl_arena_alloc( slinky_arena, sl_malsize( c, sl_vsize( size ) ), sl_dsize( c ) ), c, size | 0x1, 0 );
+    } else {
+        void* blk = sl_blk_alloc( sl_malsize( c, sl_vsize( size ) ), sl_dsize( c ) );
+        size = sl_harvest( blk, sl_dsize( c ), size, c );
+        s = sl_setup( blk, c, size, 0 );
+        sl_stat_add( res_live, size );
     }
-    va_end( va );
-
-    *p = 0;
-    sl_len( ss ) += va_len;
-
-    return ss;
+    s[ 0 ] = 0;
+    return s;
 }
 
 
-sl_t sl_from_str_with_size_c( const char* cs, sl_size_t size )
+/* Parenthesized name, since sl_use() is a macro with tracing. */
+sl_t( sl_use )( void* mem, sl_size_t size )
 {
-    sl_size_t len = sc_len1( cs );
-    sl_t      ss;
-    if ( size > len )
-        ss = sl_new( size );
-    else
-        ss = sl_new( len );
-    sl_copy_c( &ss, cs );
-    return ss;
-}
+    sl_t s;
+    int  c = 2;
 
+    assert( ( size & 0x1 ) == 0 );
 
-sl_t sl_refresh( sl_t ss )
-{
-    sl_size_t len = sc_len1( ss );
-    assert( len <= sl_res( ss ) );
-    sl_len( ss ) = len - 1;
-    return ss;
+    if ( size - sl_dsize( c ) > SL_CLASS_MAX( c ) )
+        c = 3;
+    size -= sl_dsize( c );
+    if ( size > SL_STORAGE_MAX )
+        size = SL_STORAGE_MAX;
+    /* Mark allocation as static. */
+    s = sl_setup( mem, c, size | 0x1, 0 );
+    s[ 0 ] = 0;
+    return s;
 }
 
 
-sl_size_t sl_length( sl_t ss )
+sl_t sl_del( sl_p sp )
 {
-    return sl_len( ss );
+    sl_del2( *sp );
+    *sp = 0;
+    return NULL;
 }
 
 
-sl_t sl_set_length( sl_t ss, sl_size_t len )
+void sl_del2( sl_t ss )
 {
-    ss[ len ] = 0;
-    sl_len( ss ) = len;
-    return ss;
+    /* Shared Slinky is freed with last reference. */
+    if ( sl_ext( ss ) && sl_x_release( sl_xptr( ss ) ) > 0 )
+        return;
+
+    if ( !sl_get_local( ss ) ) {
+        sl_stat_add( frees, 1 );
+        sl_stat_add( res_live, -(int64_t)sl_res( ss ) );
+        sl_stat_add( res_freed, sl_res( ss ) );
+        sl_stat_add( len_freed, sl_len( ss ) );
+        sl_blk_free( sl_block( ss ), sl_blksize( ss ) );
+    }
 }
 
 
-sl_size_t sl_reservation_size( sl_t ss )
+sl_v sl_new_many( sl_size_t cnt, sl_size_t size )
 {
-    return sl_res( ss );
-}
+    char* mem;
+    sl_v  sa;
+    int   c;
 
+    sl_check( size );
+    size = sl_snor( size );
+    if ( size == 0 )
+        size = 2;
+    c = sl_class( size );
 
-sl_size_t sl_body_size( void )
-{
-    return sizeof( sl_s );
-}
+    sa = sl_many_alloc( cnt, cnt * sl_many_size( c, size ) );
+    mem = (char*)sa + sl_many_align( ( cnt + 1 ) * sizeof( sl_t ) );
 
+    for ( sl_size_t i = 0; i < cnt; i++ ) {
+        sa[ i ] = sl_many_setup( &mem, c, size, 0 );
+        sa[ i ][ 0 ] = 0;
+    }
 
-sl_size_t sl_normalize_size( sl_size_t size )
-{
-    return sl_snor( size );
+    return sa;
 }
 
 
-sl_base_p sl_base_ptr( sl_t ss )
+sl_v sl_from_array_c( const char** cs, sl_size_t cnt )
 {
-    return sl_base( ss );
-}
+    size_t total = 0;
+    char*  mem;
+    sl_v   sa;
+
+    for ( sl_size_t i = 0; i < cnt; i++ ) {
+        size_t res = sl_snor( sc_len1( cs[ i ] ) );
+        sl_check( res );
+        total += sl_many_size( sl_class( res ), res );
+    }
 
+    sa = sl_many_alloc( cnt, total );
+    mem = (char*)sa + sl_many_align( ( cnt + 1 ) * sizeof( sl_t ) );
 
-char sl_end_char( sl_t ss )
-{
-    if ( sl_len( ss ) == 0 )
-        return 0;
-    else
-        return ss[ sl_len( ss ) - 1 ];
+    for ( sl_size_t i = 0; i < cnt; i++ ) {
+        sl_size_t len = sc_len( cs[ i ] );
+        sl_size_t res = sl_snor( len + 1 );
+        sa[ i ] = sl_many_setup( &mem, sl_class( res ), res, len );
+        memcpy( sa[ i ], cs[ i ], len + 1 );
+    }
+
+    return sa;
 }
 
 
-int sl_compare( sl_t s1, sl_t s2 )
+void sl_del_many( sl_v* sa )
 {
-    return strcmp( s1, s2 );
-}
+    size_t* head = ( (size_t*)*sa ) - 2;
 
+    /* Delete strings moved out of the block. */
+    for ( size_t i = 0; i < head[ 0 ]; i++ ) {
+        if ( ( *sa )[ i ] )
+            sl_del2( ( *sa )[ i ] );
+    }
 
-int sl_is_same( sl_t s1, sl_t s2 )
-{
-    if ( ( sl_len( s1 ) == sl_len( s2 ) ) && ( strcmp( s1, s2 ) == 0 ) )
-        return 1;
-    else
-        return 0;
+    sl_stat_add( frees, 1 );
+    sl_mem_free( head, head[ 1 ] );
+    *sa = NULL;
 }
 
 
-int sl_is_different( sl_t s1, sl_t s2 )
+sl_t sl_reserve( sl_p sp, sl_size_t size )
 {
-    if ( sl_len( s1 ) != sl_len( s2 ) )
-        return 1;
-    else if ( strcmp( s1, s2 ) == 0 )
-        return 0;
-    else
-        return 1;
-}
+    if ( sl_ext( *sp ) )
+        sl_unshare( sp );
 
+    if ( sl_res( *sp ) < size ) {
+        int c;
+        sl_check( size );
+        size = sl_snor( size );
+        c = sl_class( size );
+        /* Arena allocation is extended in place, if class is same. */
+        if ( slinky_arena && c == sl_cls( *sp )
+             && sl_arena_extend( slinky_arena, sl_base( *sp ), sl_malsize( c, sl_vsize( size ) ) ) ) {
+            sl_set_res( *sp, size | 0x1 );
+            sl_stat_add( reallocs, 1 );
+        } else if ( sl_get_local( *sp ) ) {
+            sl_t sn;
+            sl_stat_add( promotions, 1 );
+#ifdef SLINKY_USE_TRACE
+            sl_trace_promotion( *sp, size );
+#endif
+            sn = sl_new( size );
+            sl_set_len( sn, sl_len( *sp ) );
+            memcpy( sn, *sp, sl_len1( sn ) );
+            *sp = sn;
+        } else {
+            *sp = sl_resize( *sp, size );
+        }
+    }
 
-void sl_sort( sl_v sa, sl_size_t len )
-{
-    qsort( sa, len, sizeof( char* ), sl_compare_base );
+    return *sp;
 }
 
 
-sl_t sl_concatenate( sl_p s1, const sl_t s2 )
+#ifdef SLINKY_USE_MEMTUN
+
+sl_t sl_new_with( mt_t mt, sl_size_t size )
 {
-    return sl_concatenate_base( s1, s2, sl_len1( s2 ) );
-}
+    sl_t ret;
 
+    sl_push_memtun( mt );
+    ret = sl_new( size );
+    sl_pop_memtun();
 
-sl_t sl_concatenate_c( sl_p s1, const char* s2 )
-{
-    return sl_concatenate_base( s1, s2, sc_len1( s2 ) );
+    return ret;
 }
 
 
-sl_t sl_push_char_to( sl_p sp, int pos, char c )
+sl_t sl_reserve_with( mt_t mt, sl_p sp, sl_size_t size )
 {
-    pos = sl_norm_idx( *sp, pos );
-    sl_base_p s = sl_base( *sp );
-    sl_reserve( sp, sl_len( *sp ) + 1 );
-    if ( (sl_size_t)pos != s->len )
-        memmove( &s->str[ pos + 1 ], &s->str[ pos ], s->len - pos );
-    s->str[ pos ] = c;
-    s->len++;
-    s->str[ s->len ] = 0;
+    sl_push_memtun( mt );
+    sl_reserve( sp, size );
+    sl_pop_memtun();
+
     return *sp;
 }
 
+#endif
+
 
-sl_t sl_pop_char_from( sl_t ss, int pos )
+sl_t sl_compact( sl_p sp )
 {
-    pos = sl_norm_idx( ss, pos );
-    sl_base_p s = sl_base( ss );
-    if ( (sl_size_t)pos != s->len ) {
-        memmove( &s->str[ pos ], &s->str[ pos + 1 ], s->len - pos );
-        s->len--;
+    sl_size_t len = sl_len1( *sp );
+
+    len = sl_snor( len );
+    if ( sl_res( *sp ) > len ) {
+        /* Shared storage is left as is. */
+        if ( !sl_get_local( *sp ) && !sl_shared( *sp ) ) {
+            sl_stat_add( compacts, 1 );
+            sl_stat_add( compact_bytes, sl_res( *sp ) - len );
+            *sp = sl_resize( *sp, len );
+        }
     }
-    return ss;
+
+    return *sp;
 }
 
 
-sl_t sl_limit_to_pos( sl_t ss, int pos )
+sl_t sl_grow( sl_p sp, sl_size_t size )
 {
-    sl_base_p s = sl_base( ss );
-    s->str[ pos ] = 0;
-    s->len = pos;
-    return ss;
-}
+    sl_size_t res = sl_get_res( *sp ) & sl_smsk;
 
-
-sl_t sl_cut( sl_t ss, int cnt )
-{
-    int       pos;
-    sl_base_p s = sl_base( ss );
-    if ( cnt >= 0 ) {
-        pos = s->len - cnt;
-        s->str[ pos ] = 0;
-        s->len = pos;
-        return ss;
-    } else {
-        sl_size_t len = s->len + cnt;
-        pos = -cnt;
-        memmove( s->str, &s->str[ pos ], len );
-        s->len = len;
-        s->str[ len ] = 0;
-        return ss;
+    /* Extended. */
+    if ( res == 0 ) {
+        sl_unshare( sp );
+        res = sl_res( *sp );
     }
+
+    if ( res < size )
+        sl_reserve( sp, sl_growth_size( res, size ) );
+
+    return *sp;
 }
 
 
-sl_t sl_select_slice( sl_t ss, int a, int b )
+void sl_set_growth( sl_growth_t growth, sl_growth_fn_t fn )
 {
-    sl_size_t an, bn;
+    if ( growth == SL_GROWTH_GEOMETRIC )
+        fn = sl_growth_geometric;
+    else if ( growth != SL_GROWTH_CUSTOM || fn == NULL )
+        fn = sl_growth_exact;
+    __atomic_store_n( &slinky_growth_fn, fn, __ATOMIC_RELEASE );
+}
 
-    /* Normalize a. */
-    an = sl_norm_idx( ss, a );
 
-    /* Normalize b. */
-    bn = sl_norm_idx( ss, b );
+sl_growth_t sl_get_growth( void )
+{
+    sl_growth_fn_t fn = __atomic_load_n( &slinky_growth_fn, __ATOMIC_ACQUIRE );
 
-    /* Reorder. */
-    if ( bn < an ) {
-        int t;
-        t = an;
-        an = bn;
-        bn = t;
-    }
+    if ( fn == sl_growth_exact )
+        return SL_GROWTH_EXACT;
+    if ( fn == sl_growth_geometric )
+        return SL_GROWTH_GEOMETRIC;
+    return SL_GROWTH_CUSTOM;
+}
 
-    sl_base_p s = sl_base( ss );
-    memmove( s->str, &s->str[ an ], bn - an );
-    s->str[ bn - an ] = 0;
-    s->len = bn - an;
 
-    return ss;
+void sl_set_harvest( int val )
+{
+    slinky_harvest = ( val != 0 );
 }
 
 
-sl_t sl_insert_to( sl_p s1, int pos, sl_t s2 )
+int sl_get_harvest( void )
 {
-    return sl_insert_base( s1, pos, s2, sl_len1( s2 ) );
+    return slinky_harvest;
 }
 
 
-sl_t sl_insert_to_c( sl_p s1, int pos, const char* s2 )
+sl_t sl_share( sl_p sp )
 {
-    return sl_insert_base( s1, pos, s2, sc_len1( s2 ) );
+    sl_x_p x;
+
+    x = sl_extend( sp, SL_X_SHARED );
+    sl_x_retain( x );
+
+    return *sp;
 }
 
 
-sl_t sl_unquote( sl_t ss )
+sl_t sl_share_atomic( sl_p sp )
 {
-    sl_size_t ri;
-    sl_size_t wi;
-    sl_size_t cnt;
-    sl_size_t lim;
+    sl_x_p x;
 
-    ri = 0;
-    wi = 0;
-    cnt = 0;
-    lim = sl_len( ss );
+    x = sl_extend( sp, SL_X_SHARED | SL_X_ATOMIC );
+    sl_x_retain( x );
 
-    if ( ss[ 0 ] == '\"' ) {
-        ri++;
-        cnt++;
-    }
+    return *sp;
+}
 
-    if ( ss[ lim - 1 ] == '\"' ) {
-        lim--;
-        cnt++;
-    }
 
-    for ( ; ri < lim; ri++ ) {
-        if ( ss[ ri ] == '\\' ) {
-            ri++;
-            cnt++;
+sl_t sl_unshare( sl_p sp )
+{
+    if ( sl_shared( *sp ) ) {
+        sl_t sn;
+        sn = sl_new( sl_res( *sp ) );
+        sl_set_len( sn, sl_len( *sp ) );
+        memcpy( sn, *sp, sl_len1( sn ) );
+        sl_del2( *sp );
+        *sp = sn;
+    } else if ( sl_ext( *sp ) ) {
+        /* Private storage is about to be modified. */
+        sl_xptr( *sp )->flags &= ~SL_X_HASH;
+    }
 
-            /*
-              Allow the single character escapes.
+    return *sp;
+}
 
-              \a	07	Alert (Beep, Bell) (added in C89)[1]
-              \b	08	Backspace
-              \f	0C	Formfeed
-              \n	0A	Newline (Line Feed); see notes below
-              \r	0D	Carriage Return
-              \t	09	Horizontal Tab
-              \v	0B	Vertical Tab
-              \\	5C	Backslash
-              \'	27	Single quotation mark
-              \"	22	Double quotation mark
-              \?	3F	Question mark (used to avoid trigraphs)
-              \nnnnote 1	any	The byte whose numerical value is given by nnn interpreted as an
-              octal number
-              \xhh…	any	The byte whose numerical value is given by hh… interpreted as a hexadecimal
-              number \enote 2	1B	escape character (some character sets) \Uhhhhhhhhnote 3	none
-              Unicode code point where h is a hexadecimal digit \uhhhhnote 4	none	Unicode code
-              point below 10000 hexadecimal
-            */
 
-            switch ( ss[ ri ] ) {
-                case 'a':
-                    ss[ wi++ ] = '\a';
-                    break;
-                case 'b':
-                    ss[ wi++ ] = '\b';
-                    break;
-                case 'f':
-                    ss[ wi++ ] = '\f';
-                    break;
-                case 'n':
-                    ss[ wi++ ] = '\n';
-                    break;
-                case 'r':
-                    ss[ wi++ ] = '\r';
-                    break;
-                case 'v':
-                    ss[ wi++ ] = '\v';
-                    break;
-                case '\\':
-                    ss[ wi++ ] = '\\';
-                    break;
-                case '\'':
-                    ss[ wi++ ] = '\'';
-                    break;
-                case '"':
-                    ss[ wi++ ] = '\"';
-                    break;
-                case '?':
-                    ss[ wi++ ] = '\?';
-                    break;
-            }
-        } else {
-            ss[ wi++ ] = ss[ ri ];
-        }
+uint64_t sl_hash( sl_t ss )
+{
+    uint64_t hash;
+
+    if ( sl_ext( ss ) ) {
+        sl_x_p x = sl_xptr( ss );
+        if ( sl_hashed( ss ) )
+            return sl_xhash( ss );
+        hash = sl_hash_base( ss, sl_len( ss ) );
+        /* Shared Slinky may be hashed by multiple threads. */
+        __atomic_store_n( &x->hash, hash, __ATOMIC_RELAXED );
+        __atomic_or_fetch( &x->flags, SL_X_HASH, __ATOMIC_RELEASE );
+        return hash;
     }
 
-    sl_len( ss ) -= cnt;
-    ss[ sl_len( ss ) ] = 0;
+    return sl_hash_base( ss, sl_len( ss ) );
+}
 
-    return ss;
+
+uint64_t sl_hash_c( const char* cs )
+{
+    return sl_hash_base( cs, sc_len( cs ) );
 }
 
 
-sl_t sl_quote( sl_p sp )
+uint64_t sl_hash_sr( sr_s sr )
 {
-    sl_size_t wi;
-    sl_size_t cnt;
-    char      tc;
+    return sl_hash_base( sr.str, sr.len );
+}
 
-    cnt = 0;
-    for ( sl_size_t ri = 0; ri < sl_len( *sp ); ri++ ) {
-        if ( sl_char_is_special( *sp[ ri ] ) )
-            cnt++;
-    }
 
-    /* Add start and end quotes. */
-    cnt += 2;
+uint64_t sl_hash_icase( sl_t ss )
+{
+    return sl_hash_icase_base( ss, sl_len( ss ) );
+}
 
-    sl_reserve( sp, sl_len( *sp ) + cnt + 1 );
 
-    wi = sl_len( *sp ) + 1;
-    *( sp[ wi-- ] ) = 0;
-    *( sp[ wi-- ] ) = '\"';
-    for ( int32_t ri = sl_len( *sp ) - cnt; ri >= 0; ri-- ) {
-        if ( ( tc = sl_char_is_special( *sp[ ri ] ) ) ) {
-            *( sp[ wi-- ] ) = tc;
-            *( sp[ wi-- ] ) = '\\';
-        } else {
-            *( sp[ wi-- ] ) = *( sp[ ri ] );
-        }
-    }
+uint64_t sl_hash_sr_icase( sr_s sr )
+{
+    return sl_hash_icase_base( sr.str, sr.len );
+}
 
-    *( sp[ wi-- ] ) = '\"';
 
+sl_t sl_cache_hash( sl_p sp )
+{
+    sl_extend( sp, 0 );
+    sl_hash( *sp );
     return *sp;
 }
 
 
-sl_t sl_format( sl_p sp, const char* fmt, ... )
+int sl_is_shared( sl_t ss )
 {
-    sl_t    ret;
-    va_list ap;
+    if ( sl_shared( ss ) )
+        return 1;
+    else
+        return 0;
+}
 
-    va_start( ap, fmt );
-    ret = sl_va_format( sp, fmt, ap );
-    va_end( ap );
 
-    return ret;
+sl_arena_t sl_arena_new( size_t size )
+{
+    sl_arena_t arena;
+
+    arena = (sl_arena_t)sl_malloc( sizeof( sl_arena_s ) );
+    arena->size = size;
+    arena->first = (sl_arena_chunk_p)sl_malloc( sizeof( sl_arena_chunk_s ) + size );
+    arena->first->next = NULL;
+    arena->first->size = size;
+    arena->cur = arena->first;
+    arena->used = 0;
+    arena->last = NULL;
+
+    return arena;
 }
 
 
-sl_t sl_va_format( sl_p sp, const char* fmt, va_list ap )
+void sl_arena_del( sl_arena_t arena )
 {
-    va_list coap;
+    sl_arena_chunk_p chunk, next;
 
-    /* Copy ap to coap for second va-call. */
-    va_copy( coap, ap );
+    if ( slinky_arena == arena )
+        slinky_arena = NULL;
 
-    int size;
-    size = vsnprintf( NULL, 0, fmt, ap );
+    chunk = arena->first;
+    while ( chunk ) {
+        next = chunk->next;
+        sl_free( chunk );
+        chunk = next;
+    }
 
-    if ( size < 0 )
-        return NULL; // GCOV_EXCL_LINE
+    sl_free( arena );
+}
 
-    size++;
-    sl_reserve( sp, sl_len( *sp ) + size );
 
-    size = vsnprintf( sl_end( *sp ), size, fmt, coap );
-    va_end( coap );
+void sl_arena_reset( sl_arena_t arena )
+{
+    arena->cur = arena->first;
+    arena->used = 0;
+    arena->last = NULL;
+}
 
-    sl_len( *sp ) += size;
 
-    return *sp;
+sl_arena_t sl_set_arena( sl_arena_t arena )
+{
+    sl_arena_t prev = slinky_arena;
+    slinky_arena = arena;
+    return prev;
 }
 
 
-sl_t sl_format_quick( sl_p sp, const char* fmt, ... )
+sl_arena_t sl_get_arena( void )
 {
-    sl_t    ret;
-    va_list ap;
+    return slinky_arena;
+}
 
-    va_start( ap, fmt );
-    ret = sl_va_format_quick( sp, fmt, ap );
-    va_end( ap );
 
-    return ret;
+sl_t sl_copy( sl_p s1, sl_t s2 )
+{
+    return sl_copy_base( s1, s2, sl_len1( s2 ) );
 }
 
 
-sl_t sl_va_format_quick( sl_p sp, const char* fmt, va_list ap )
+sl_t sl_copy_c( sl_p s1, const char* s2 )
 {
+    return sl_copy_base( s1, s2, sc_len1( s2 ) );
+}
 
-    va_list coap;
 
-    va_copy( coap, ap );
+sl_t sl_append_char( sl_p sp, char c )
+{
+    sl_size_t len = sl_len( *sp );
+    sl_grow( sp, len + 1 + 1 );
+    char* p = &( ( *sp )[ len ] );
+    *p++ = c;
+    *p = 0;
+    sl_set_len( *sp, len + 1 );
+    return *sp;
+}
 
-    sl_size_t   size;
-    sl_size_t   extension;
-    const char* c;
-    char*       ts;
-    int64_t     i64;
-    uint64_t    u64;
-    sr_s        sr;
 
-    extension = sl_va_format_quick_size( fmt, ap );
-    sl_reserve( sp, sl_len1( *sp ) + extension );
+sl_t sl_append_n_char( sl_p sp, char c, sl_size_t n )
+{
+    sl_size_t len = sl_len( *sp );
+    sl_grow( sp, len + n + 1 );
+    char* p = &( ( *sp )[ len ] );
+    for ( sl_size_t i = 0; i < n; i++, p++ )
+        *p = c;
+    *p = 0;
+    sl_add_len( *sp, n );
+    return *sp;
+}
 
 
-    /* ------------------------------------------------------------
-     * Expand format string.
-     */
+sl_t sl_append_substr( sl_p sp, const char* cs, sl_size_t clen )
+{
+    sl_size_t len = sl_len( *sp );
+    sl_grow( sp, len + clen + 1 );
+    char* p = &( ( *sp )[ len ] );
+    memcpy( p, cs, clen );
+    p += clen;
+    *p = 0;
+    sl_add_len( *sp, clen );
+    return *sp;
+}
 
-    char* wp = sl_end( *sp );
-    char* first = wp;
 
-    c = fmt;
+sl_t sl_append_str( sl_p sp, const char* cs )
+{
+    sl_size_t len = sl_len( *sp );
+    sl_size_t clen = sc_len( cs );
+    sl_grow( sp, len + clen + 1 );
+    char* p = &( ( *sp )[ len ] );
+    memcpy( p, cs, clen );
+    p += clen;
+    *p = 0;
+    sl_add_len( *sp, clen );
+    return *sp;
+}
 
-    while ( *c ) {
 
-        switch ( *c ) {
+sl_t sl_append_n_str( sl_p sp, const char* cs, sl_size_t n )
+{
+    sl_size_t len = sl_len( *sp );
+    sl_size_t clen = sc_len( cs );
 
-            case '%': {
-                c++;
+    sl_grow( sp, len + n * clen + 1 );
+    char* p = &( ( *sp )[ len ] );
+    for ( sl_size_t i = 0; i < n; i++, p += clen )
+        memcpy( p, cs, clen );
+    *p = 0;
+    sl_add_len( *sp, n * clen );
+    return *sp;
+}
 
-                switch ( *c ) {
 
-                    case '!': {
-                        wp = sl_end( *sp );
-                        break;
-                    }
+sl_t sl_append_sr( sl_p sp, sr_s sr )
+{
+    return sl_append_substr( sp, sr.str, sr.len );
+}
+
+
+sl_t sl_append_va_str( sl_p sp, const char* cs, ... )
+{
+    if ( cs == NULL )
+        return *sp;
+
+    sl_size_t len = sl_len( *sp );
+    sl_size_t clen = sc_len( cs );
+
+    va_list   va;
+    sl_size_t va_len;
+
+    va_start( va, cs );
+    va_len = clen + sl_va_str_len( va );
+    va_end( va );
+
+    sl_grow( sp, len + va_len + 1 );
+
+    char*       p = &( ( *sp )[ len ] );
+    const char* p2;
+    memcpy( p, cs, clen );
+    p += clen;
+
+    va_start( va, cs );
+    while ( ( cs = va_arg( va, char* ) ) != NULL ) {
+        p2 = cs;
+        while ( *p2 )
+            *p++ = *p2++;
+    }
+    va_end( va );
+
+    *p = 0;
+    sl_add_len( *sp, va_len );
+
+    return *sp;
+}
+
+
+sl_t sl_duplicate( sl_t ss )
+{
+    if ( sl_ext( ss ) && ( sl_xptr( ss )->flags & SL_X_SHARED ) ) {
+        sl_x_retain( sl_xptr( ss ) );
+        return ss;
+    }
+
+    sl_t sn;
+    sn = sl_new( sl_res( ss ) );
+    sl_copy( &sn, ss );
+    return sn;
+}
+
+
+char* sl_duplicate_c( sl_t ss )
+{
+    sl_size_t len1 = sl_len1( ss );
+#ifdef SLINKY_USE_MEMTUN
+    char* dup = mt_alloc( sl_get_memtun(), len1 );
+#else
+    char* dup = sl_malloc( len1 );
+#endif
+    memcpy( dup, ss, len1 );
+    return dup;
+}
+
+
+sl_t sl_replicate( sl_t ss )
+{
+    if ( sl_ext( ss ) && ( sl_xptr( ss )->flags & SL_X_SHARED ) ) {
+        sl_x_retain( sl_xptr( ss ) );
+        return ss;
+    }
+
+    sl_t sn;
+    sn = sl_new( sl_len1( ss ) );
+    sl_copy( &sn, ss );
+    return sn;
+}
+
+
+char* sl_drop( sl_t ss )
+{
+    char* ret;
+
+#if !defined( SLINKY_USE_POOL ) && !defined( SLINKY_USE_MEMTUN ) && !defined( SLINKY_ALIGN )
+    if ( !sl_ext( ss ) && !sl_mapped( ss ) ) {
+        ret = (char*)sl_base( ss );
+        memmove( ret, (void*)ss, sl_len1( ss ) );
+        return ret;
+    }
+#endif
+
+    /* Pool and memtun blocks, extended, aligned and mapped
+       allocations can't be freed with sl_free, hence copy. */
+    ret = sl_duplicate_c( ss );
+    sl_del2( ss );
+    return ret;
+}
+
+
+sl_t sl_clear( sl_t ss )
+{
+    sl_mutate( ss );
+    sl_set_len( ss, 0 );
+    *ss = 0;
+    return ss;
+}
+
+
+sl_t sl_from_str_c( const char* cs )
+{
+    sl_size_t len = sc_len1( cs );
+    sl_t      ss = sl_new( len );
+    memcpy( ss, cs, len );
+    sl_set_len( ss, len - 1 );
+    return ss;
+}
+
+
+sl_t sl_from_len_c( const char* cs, sl_size_t clen )
+{
+    sl_size_t len = clen + 1;
+    sl_t      ss = sl_new( len );
+    memcpy( ss, cs, len );
+    sl_set_len( ss, len - 1 );
+    return ss;
+}
+
+
+sl_t sl_from_va_str_c( const char* cs, ... )
+{
+    if ( cs == NULL )
+        return NULL;
+
+    sl_size_t clen = sc_len( cs );
+
+    va_list   va;
+    sl_size_t va_len;
+
+    va_start( va, cs );
+    va_len = clen + sl_va_str_len( va );
+    va_end( va );
+
+    sl_size_t   len = va_len + 1;
+    sl_t        ss = sl_new( len );
+    char*       p;
+    const char* p2;
+
+    p = (char*)ss;
+
+    memcpy( p, cs, clen );
+    p += clen;
+
+    va_start( va, cs );
+    while ( ( cs = va_arg( va, char* ) ) != NULL ) {
+        p2 = cs;
+        while ( *p2 )
+            *p++ = *p2++;
+    }
+    va_end( va );
+
+    *p = 0;
+    sl_add_len( ss, va_len );
+
+    return ss;
+}
+
+
+sl_t sl_from_str_with_size_c( const char* cs, sl_size_t size )
+{
+    sl_size_t len = sc_len1( cs );
+    sl_t      ss;
+    if ( size > len )
+        ss = sl_new( size );
+    else
+        ss = sl_new( len );
+    sl_copy_c( &ss, cs );
+    return ss;
+}
+
+
+sl_t sl_refresh( sl_t ss )
+{
+    sl_mutate( ss );
+    sl_size_t len = sc_len1( ss );
+    assert( len <= sl_res( ss ) );
+    sl_set_len( ss, len - 1 );
+    return ss;
+}
+
+
+sl_size_t sl_length( sl_t ss )
+{
+    return sl_len( ss );
+}
+
+
+sl_t sl_set_length( sl_t ss, sl_size_t len )
+{
+    sl_mutate( ss );
+    ss[ len ] = 0;
+    sl_set_len( ss, len );
+    return ss;
+}
+
+
+sl_size_t sl_reservation_size( sl_t ss )
+{
+    return sl_res( ss );
+}
+
+
+sl_size_t sl_body_size( void )
+{
+    return sl_dsize( 2 );
+}
+
+
+sl_size_t sl_normalize_size( sl_size_t size )
+{
+    return sl_snor( size );
+}
+
+
+sl_base_p sl_base_ptr( sl_t ss )
+{
+    return sl_base( ss );
+}
+
+
+char sl_end_char( sl_t ss )
+{
+    if ( sl_len( ss ) == 0 )
+        return 0;
+    else
+        return ss[ sl_len( ss ) - 1 ];
+}
+
+
+int sl_compare( sl_t s1, sl_t s2 )
+{
+    if ( s1 == s2 )
+        return 0;
+    return strcmp( s1, s2 );
+}
+
+
+int sl_is_same( sl_t s1, sl_t s2 )
+{
+    if ( s1 == s2 )
+        return 1;
+    else if ( sl_interned( s1 ) && sl_interned( s2 ) )
+        return 0;
+    else if ( sl_hashed( s1 ) && sl_hashed( s2 ) && sl_xhash( s1 ) != sl_xhash( s2 ) )
+        return 0;
+    else if ( ( sl_len( s1 ) == sl_len( s2 ) ) && ( strcmp( s1, s2 ) == 0 ) )
+        return 1;
+    else
+        return 0;
+}
+
+
+int sl_is_different( sl_t s1, sl_t s2 )
+{
+    if ( s1 == s2 )
+        return 0;
+    else if ( sl_interned( s1 ) && sl_interned( s2 ) )
+        return 1;
+    else if ( sl_hashed( s1 ) && sl_hashed( s2 ) && sl_xhash( s1 ) != sl_xhash( s2 ) )
+        return 1;
+    else if ( sl_len( s1 ) != sl_len( s2 ) )
+        return 1;
+    else if ( strcmp( s1, s2 ) == 0 )
+        return 0;
+    else
+        return 1;
+}
+
+
+int sl_compare_icase( sl_t s1, sl_t s2 )
+{
+    sl_size_t len = ( sl_len( s1 ) < sl_len( s2 ) ) ? sl_len( s1 ) : sl_len( s2 );
+    int       ret;
+
+    if ( s1 == s2 )
+        return 0;
+    ret = sl_mem_icase( s1, s2, len );
+    if ( ret == 0 )
+        ret = ( sl_len( s1 ) > sl_len( s2 ) ) - ( sl_len( s1 ) < sl_len( s2 ) );
+    else
+        ret = ( ret > 0 ) - ( ret < 0 );
+
+    return ret;
+}
+
+
+int sl_is_same_icase( sl_t s1, sl_t s2 )
+{
+    if ( s1 == s2 )
+        return 1;
+    else if ( sl_len( s1 ) != sl_len( s2 ) )
+        return 0;
+    else
+        return sl_mem_icase( s1, s2, sl_len( s1 ) ) == 0;
+}
+
+
+void sl_sort( sl_v sa, sl_size_t len )
+{
+    qsort( sa, len, sizeof( char* ), sl_compare_base );
+}
+
+
+sl_t sl_concatenate( sl_p s1, const sl_t s2 )
+{
+    return sl_concatenate_base( s1, s2, sl_len1( s2 ) );
+}
+
+
+sl_t sl_concatenate_c( sl_p s1, const char* s2 )
+{
+    return sl_concatenate_base( s1, s2, sc_len1( s2 ) );
+}
+
+
+sl_t sl_push_char_to( sl_p sp, sl_pos_t pos, char c )
+{
+    pos = sl_norm_idx( *sp, pos );
+    sl_grow( sp, sl_len( *sp ) + 1 + 1 );
+    sl_t      s = *sp;
+    sl_size_t len = sl_len( s );
+    if ( (sl_size_t)pos != len )
+        memmove( &s[ pos + 1 ], &s[ pos ], len - pos );
+    s[ pos ] = c;
+    len++;
+    s[ len ] = 0;
+    sl_set_len( s, len );
+    return *sp;
+}
+
+
+sl_t sl_pop_char_from( sl_t ss, sl_pos_t pos )
+{
+    sl_mutate( ss );
+    pos = sl_norm_idx( ss, pos );
+    sl_size_t len = sl_len( ss );
+    if ( (sl_size_t)pos != len ) {
+        memmove( &ss[ pos ], &ss[ pos + 1 ], len - pos );
+        sl_set_len( ss, len - 1 );
+    }
+    return ss;
+}
+
+
+sl_t sl_limit_to_pos( sl_t ss, sl_pos_t pos )
+{
+    sl_mutate( ss );
+    ss[ pos ] = 0;
+    sl_set_len( ss, pos );
+    return ss;
+}
+
+
+sl_t sl_cut( sl_t ss, sl_pos_t cnt )
+{
+    sl_mutate( ss );
+    sl_pos_t pos;
+    if ( cnt >= 0 ) {
+        pos = sl_len( ss ) - cnt;
+        ss[ pos ] = 0;
+        sl_set_len( ss, pos );
+        return ss;
+    } else {
+        sl_size_t len = sl_len( ss ) + cnt;
+        pos = -cnt;
+        memmove( ss, &ss[ pos ], len );
+        sl_set_len( ss, len );
+        ss[ len ] = 0;
+        return ss;
+    }
+}
+
+
+sl_t sl_select_slice( sl_t ss, sl_pos_t a, sl_pos_t b )
+{
+    sl_size_t an, bn;
+
+    sl_mutate( ss );
+
+    /* Normalize a. */
+    an = sl_norm_idx( ss, a );
+
+    /* Normalize b. */
+    bn = sl_norm_idx( ss, b );
+
+    /* Reorder. */
+    if ( bn < an ) {
+        sl_size_t t;
+        t = an;
+        an = bn;
+        bn = t;
+    }
+
+    memmove( ss, &ss[ an ], bn - an );
+    ss[ bn - an ] = 0;
+    sl_set_len( ss, bn - an );
+
+    return ss;
+}
+
+
+sl_t sl_insert_to( sl_p s1, sl_pos_t pos, sl_t s2 )
+{
+    return sl_insert_base( s1, pos, s2, sl_len1( s2 ) );
+}
+
+
+sl_t sl_insert_to_c( sl_p s1, sl_pos_t pos, const char* s2 )
+{
+    return sl_insert_base( s1, pos, s2, sc_len1( s2 ) );
+}
+
+
+sl_t sl_unquote( sl_t ss )
+{
+    sl_size_t ri;
+    sl_size_t wi;
+    sl_size_t cnt;
+    sl_size_t lim;
+
+    sl_mutate( ss );
+
+    ri = 0;
+    wi = 0;
+    cnt = 0;
+    lim = sl_len( ss );
+
+    if ( ss[ 0 ] == '\"' ) {
+        ri++;
+        cnt++;
+    }
+
+    if ( ss[ lim - 1 ] == '\"' ) {
+        lim--;
+        cnt++;
+    }
+
+    for ( ; ri < lim; ri++ ) {
+        if ( ss[ ri ] == '\\' ) {
+            ri++;
+            cnt++;
+
+            /*
+              Allow the single character escapes.
+
+              \a	07	Alert (Beep, Bell) (added in C89)[1]
+              \b	08	Backspace
+              \f	0C	Formfeed
+              \n	0A	Newline (Line Feed); see notes below
+              \r	0D	Carriage Return
+              \t	09	Horizontal Tab
+              \v	0B	Vertical Tab
+              \\	5C	Backslash
+              \'	27	Single quotation mark
+              \"	22	Double quotation mark
+              \?	3F	Question mark (used to avoid trigraphs)
+              \nnnnote 1	any	The byte whose numerical value is given by nnn interpreted as an
+              octal number
+              \xhh…	any	The byte whose numerical value is given by hh… interpreted as a hexadecimal
+              number \enote 2	1B	escape character (some character sets) \Uhhhhhhhhnote 3	none
+              Unicode code point where h is a hexadecimal digit \uhhhhnote 4	none	Unicode code
+              point below 10000 hexadecimal
+            */
+
+            switch ( ss[ ri ] ) {
+                case 'a':
+                    ss[ wi++ ] = '\a';
+                    break;
+                case 'b':
+                    ss[ wi++ ] = '\b';
+                    break;
+                case 'f':
+                    ss[ wi++ ] = '\f';
+                    break;
+                case 'n':
+                    ss[ wi++ ] = '\n';
+                    break;
+                case 'r':
+                    ss[ wi++ ] = '\r';
+                    break;
+                case 'v':
+                    ss[ wi++ ] = '\v';
+                    break;
+                case '\\':
+                    ss[ wi++ ] = '\\';
+                    break;
+                case '\'':
+                    ss[ wi++ ] = '\'';
+                    break;
+                case '"':
+                    ss[ wi++ ] = '\"';
+                    break;
+                case '?':
+                    ss[ wi++ ] = '\?';
+                    break;
+            }
+        } else {
+            ss[ wi++ ] = ss[ ri ];
+        }
+    }
+
+    sl_set_len( ss, sl_len( ss ) - cnt );
+    ss[ sl_len( ss ) ] = 0;
+
+    return ss;
+}
+
+
+sl_t sl_quote( sl_p sp )
+{
+    sl_size_t len;
+    sl_size_t wi;
+    sl_size_t cnt;
+    char      tc;
+    char*     ss;
+
+    len = sl_len( *sp );
+    cnt = 0;
+    for ( sl_size_t ri = 0; ri < len; ri++ ) {
+        if ( sl_char_is_special( ( *sp )[ ri ] ) )
+            cnt++;
+    }
+
+    /* Add start and end quotes. */
+    cnt += 2;
+
+    sl_grow( sp, len + cnt + 1 );
+    ss = *sp;
+
+    /* Expand from right to left. */
+    wi = len + cnt;
+    ss[ wi-- ] = 0;
+    ss[ wi-- ] = '\"';
+    for ( sl_size_t ri = len; ri > 0; ri-- ) {
+        if ( ( tc = sl_char_is_special( ss[ ri - 1 ] ) ) ) {
+            ss[ wi-- ] = tc;
+            ss[ wi-- ] = '\\';
+        } else {
+            ss[ wi-- ] = ss[ ri - 1 ];
+        }
+    }
+
+    ss[ wi ] = '\"';
+    sl_set_len( ss, len + cnt );
+
+    return ss;
+}
+
+
+sl_t sl_format( sl_p sp, const char* fmt, ... )
+{
+    sl_t    ret;
+    va_list ap;
+
+    va_start( ap, fmt );
+    ret = sl_va_format( sp, fmt, ap );
+    va_end( ap );
+
+    return ret;
+}
+
+
+sl_t sl_va_format( sl_p sp, const char* fmt, va_list ap )
+{
+    va_list coap;
+
+    /* Copy ap to coap for second va-call. */
+    va_copy( coap, ap );
+
+    int size;
+    size = vsnprintf( NULL, 0, fmt, ap );
+
+    if ( size < 0 )
+        return NULL; // GCOV_EXCL_LINE
+
+    size++;
+    sl_grow( sp, sl_len( *sp ) + size );
+
+    size = vsnprintf( sl_end( *sp ), size, fmt, coap );
+    va_end( coap );
+
+    sl_add_len( *sp, size );
+
+    return *sp;
+}
+
+
+sl_t sl_format_quick( sl_p sp, const char* fmt, ... )
+{
+    sl_t    ret;
+    va_list ap;
+
+    va_start( ap, fmt );
+    ret = sl_va_format_quick( sp, fmt, ap );
+    va_end( ap );
+
+    return ret;
+}
+
+
+sl_t sl_va_format_quick( sl_p sp, const char* fmt, va_list ap )
+{
+
+    va_list coap;
+
+    va_copy( coap, ap );
+
+    sl_size_t   size;
+    sl_size_t   extension;
+    const char* c;
+    char*       ts;
+    int64_t     i64;
+    uint64_t    u64;
+    sr_s        sr;
+
+    extension = sl_va_format_quick_size( fmt, ap );
+    sl_grow( sp, sl_len1( *sp ) + extension );
+
+
+    /* ------------------------------------------------------------
+     * Expand format string.
+     */
+
+    char* wp = sl_end( *sp );
+    char* first = wp;
+
+    c = fmt;
+
+    while ( *c ) {
+
+        switch ( *c ) {
+
+            case '%': {
+                c++;
+
+                switch ( *c ) {
+
+                    case '!': {
+                        wp = sl_end( *sp );
+                        break;
+                    }
 
                     case 's':
                     case 'S': {
@@ -875,779 +2248,4630 @@ sl_t sl_va_format_quick( sl_p sp, const char* fmt, va_list ap )
                         break;
                     }
 
-                    case 'i':
-                    case 'I': {
-                        if ( *c == 'i' ) {
-                            i64 = va_arg( coap, int );
-                        } else {
-                            i64 = va_arg( coap, int64_t );
-                        }
-                        wp = sl_i64_to_str( i64, wp );
-                        break;
-                    }
+                    case 'i':
+                    case 'I': {
+                        if ( *c == 'i' ) {
+                            i64 = va_arg( coap, int );
+                        } else {
+                            i64 = va_arg( coap, int64_t );
+                        }
+                        wp = sl_i64_to_str( i64, wp );
+                        break;
+                    }
+
+                    case 'u':
+                    case 'U': {
+                        if ( *c == 'u' ) {
+                            u64 = va_arg( coap, unsigned int );
+                        } else {
+                            u64 = va_arg( coap, uint64_t );
+                        }
+                        wp = sl_u64_to_str( u64, wp );
+                        break;
+                    }
+
+                    case 'c': {
+                        char ch;
+                        ch = (char)va_arg( coap, int );
+                        *wp++ = ch;
+                        break;
+                    }
+
+                    case 'p': {
+                        sl_pos_t pos;
+                        i64 = va_arg( coap, int );
+                        pos = wp - first;
+                        if ( i64 > pos ) {
+                            for ( sl_pos_t i = pos; i < i64; i++ ) {
+                                *wp++ = ' ';
+                            }
+                        }
+                        break;
+                    }
+
+                    case 'r': {
+                        sr = va_arg( coap, sr_s );
+                        memcpy( wp, sr.str, sr.len );
+                        wp += sr.len;
+                        break;
+                    }
+
+                    case 'a': {
+                        char      left_pad;
+                        char      pad_char;
+                        sl_size_t width;
+                        sl_size_t nominal_size;
+                        sl_pos_t  gap;
+                        char*     first;
+
+                        // %al012i
+
+                        c++;
+                        if ( *c == 'l' ) {
+                            left_pad = 1;
+                        } else {
+                            left_pad = 0;
+                        }
+                        c++;
+                        pad_char = *c;
+                        c++;
+
+                        width = sl_str_to_number( &c );
+
+                        first = wp;
+                        sl_va_format_quick_append( &wp, *c, coap );
+                        nominal_size = ( wp - first );
+
+                        gap = ( width - nominal_size );
+
+                        if ( left_pad && gap ) {
+                            memmove( first + gap, first, gap );
+                            for ( sl_pos_t i = 0; i < gap; i++ ) {
+                                *first = pad_char;
+                                first++;
+                            }
+                            wp += gap;
+                        }
+
+                        if ( !left_pad && gap ) {
+                            for ( sl_pos_t i = 0; i < gap; i++ ) {
+                                *wp = pad_char;
+                                wp++;
+                            }
+                        }
+                        break;
+                    }
+
+                    case '%': {
+                        *wp++ = '%';
+                        break;
+                    }
+
+                    default: {
+                        *wp++ = *c;
+                        break;
+                    }
+                }
+
+                c++;
+                break;
+            }
+
+            default: {
+                *wp++ = *c++;
+                break;
+            }
+        }
+    }
+    va_end( coap );
+
+    sl_add_len( *sp, ( wp - first ) );
+
+    *wp = 0;
+
+    return *sp;
+}
+
+
+sl_pos_t sl_invert_pos( sl_t ss, sl_pos_t pos )
+{
+    if ( pos > 0 )
+        return -1 * ( sl_len( ss ) - pos );
+    else
+        return sl_len( ss ) + pos;
+}
+
+
+sl_pos_t sl_find_char_right( sl_t ss, char c, sl_size_t pos )
+{
+    size_t idx;
+
+    if ( pos >= sl_len( ss ) )
+        return -1;
+
+    idx = sl_scan_char( ss + pos, sl_len( ss ) - pos, c );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return pos + idx;
+}
+
+
+sl_pos_t sl_find_char_left( sl_t ss, char c, sl_size_t pos )
+{
+    size_t idx;
+
+    if ( sl_len( ss ) == 0 )
+        return -1;
+    if ( pos >= sl_len( ss ) )
+        pos = sl_len( ss ) - 1;
+
+    idx = sl_scan_char_rev( ss, pos + 1, c );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_size_t sl_count_char( sl_t ss, char c )
+{
+    return sl_scan_count( ss, sl_len( ss ), c );
+}
+
+
+sl_pos_t sl_find_any_char( sl_t ss, const char* set, sl_size_t pos )
+{
+    size_t idx;
+
+    if ( pos >= sl_len( ss ) )
+        return -1;
+
+    idx = sl_scan_any( ss + pos, sl_len( ss ) - pos, set );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return pos + idx;
+}
+
+
+sl_pos_t sl_find_index( sl_t s1, const char* s2 )
+{
+    size_t idx;
+
+    if ( s2[ 0 ] == 0 )
+        return -1;
+
+    idx = sl_search( s1, sl_len( s1 ), s2, sc_len( s2 ) );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_pos_t sl_find_index_icase( sl_t s1, const char* s2 )
+{
+    sl_needle_s nd;
+    size_t      idx;
+
+    sl_needle_setup( &nd, s2, sc_len( s2 ) );
+    nd.icase = 1;
+    idx = sl_needle_find( &nd, s1, sl_len( s1 ), 0 );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_pos_t sl_find_index_right( sl_t s1, const char* s2 )
+{
+    sl_needle_s nd;
+    size_t      idx;
+
+    sl_needle_setup( &nd, s2, sc_len( s2 ) );
+    idx = sl_needle_find_rev( &nd, s1, sl_len( s1 ) );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_size_t sl_find_last( sl_t s1, const char* s2, sr_s* match, sl_size_t size )
+{
+    sl_needle_s nd;
+    sl_size_t   cnt = 0;
+    size_t      end = sl_len( s1 );
+    size_t      idx;
+
+    sl_needle_setup( &nd, s2, sc_len( s2 ) );
+    while ( cnt < size ) {
+        idx = sl_needle_find_rev( &nd, s1, end );
+        if ( idx == SIZE_MAX )
+            break;
+        match[ cnt++ ] = sr_new( s1 + idx, nd.len );
+        end = idx;
+    }
+
+    return cnt;
+}
+
+
+sl_size_t sl_find_all( sl_t s1, const char* s2, sr_s* match, sl_size_t size )
+{
+    sl_find_iter_s it;
+    sl_size_t      cnt = 0;
+    sr_s           sr;
+
+    sl_find_iter( &it, s1, s2 );
+    while ( sl_find_next( &it, &sr ) ) {
+        if ( cnt < size )
+            match[ cnt ] = sr;
+        cnt++;
+    }
+
+    return cnt;
+}
+
+
+void sl_find_iter( sl_find_iter_s* it, sl_t s1, const char* s2 )
+{
+    it->hay = s1;
+    it->hlen = sl_len( s1 );
+    it->ndl = s2;
+    it->nlen = sc_len( s2 );
+    it->nd = NULL;
+    it->pos = 0;
+}
+
+
+void sl_find_iter_needle( sl_find_iter_s* it, sl_t ss, sl_needle_t nd )
+{
+    it->hay = ss;
+    it->hlen = sl_len( ss );
+    it->ndl = nd->str;
+    it->nlen = nd->len;
+    it->nd = nd;
+    it->pos = 0;
+}
+
+
+int sl_find_next( sl_find_iter_s* it, sr_s* match )
+{
+    size_t idx = SIZE_MAX;
+
+    if ( it->nd ) {
+        idx = sl_needle_find( it->nd, it->hay, it->hlen, it->pos );
+    } else if ( it->pos < it->hlen ) {
+        idx = sl_search( it->hay + it->pos, it->hlen - it->pos, it->ndl, it->nlen );
+        if ( idx != SIZE_MAX )
+            idx += it->pos;
+    }
+
+    if ( idx == SIZE_MAX ) {
+        it->pos = it->hlen;
+        return 0;
+    }
+
+    *match = sr_new( it->hay + idx, it->nlen );
+    it->pos = idx + it->nlen;
+
+    return 1;
+}
+
+
+sl_size_t sl_find_fill( sl_find_iter_s* it, sr_s* match, sl_size_t size )
+{
+    sl_size_t cnt = 0;
+
+    while ( cnt < size && sl_find_next( it, &match[ cnt ] ) )
+        cnt++;
+
+    return cnt;
+}
+
+
+sl_pos_t sl_divide_with_char( sl_t ss, char c, sl_pos_t size, char*** div )
+{
+    if ( size < 0 ) {
+        /* Just count size, don't replace chars. */
+        return sl_divide_base( ss, c, -1, NULL );
+    } else if ( !sl_mutable( ss ) ) {
+        /* Terminators would be visible to other references. */
+        return -1;
+    } else if ( *div ) {
+        /* Use pre-allocated storage. */
+        return sl_divide_base( ss, c, size, *div );
+    } else {
+        /* Calculate size and allocate storage. */
+        size = sl_divide_base( ss, c, -1, NULL );
+#ifdef SLINKY_USE_MEMTUN
+        *div = (char**)mt_alloc( sl_get_memtun(), size * sizeof( char* ) );
+#else
+        *div = (char**)sl_malloc( size * sizeof( char* ) );
+#endif
+        return sl_divide_base( ss, c, size, *div );
+    }
+}
+
+
+sl_pos_t sl_segment_with_str( sl_t ss, const char* sc, sl_pos_t size, char*** div )
+{
+    sl_needle_s nd;
+
+    sl_needle_setup( &nd, sc, sc_len( sc ) );
+    return sl_segment_with_needle( ss, &nd, size, div );
+}
+
+
+sl_pos_t sl_segment_with_needle( sl_t ss, sl_needle_t nd, sl_pos_t size, char*** div )
+{
+    if ( size < 0 ) {
+        /* Just count size, don't replace chars. */
+        return sl_segment_base( ss, nd, -1, NULL );
+    } else if ( !sl_mutable( ss ) ) {
+        /* Terminators would be visible to other references. */
+        return -1;
+    } else if ( *div ) {
+        /* Use pre-allocated storage. */
+        return sl_segment_base( ss, nd, size, *div );
+    } else {
+        /* Calculate size and allocate storage. */
+        size = sl_segment_base( ss, nd, -1, NULL );
+#ifdef SLINKY_USE_MEMTUN
+        *div = (char**)mt_alloc( sl_get_memtun(), size * sizeof( char* ) );
+#else
+        *div = (char**)sl_malloc( size * sizeof( char* ) );
+#endif
+        return sl_segment_base( ss, nd, size, *div );
+    }
+}
+
+
+sl_t sl_glue_array( sl_v sa, sl_size_t size, const char* glu )
+{
+    sl_size_t len = 0;
+    sl_size_t i;
+
+    /* Calc sa len. */
+    i = 0;
+    while ( i < size )
+        len += strlen( sa[ i++ ] );
+
+    /* Add glu len. */
+    len += ( size - 1 ) * strlen( glu );
+
+    sl_t ss;
+    ss = sl_new( len + 1 );
+    sl_set_len( ss, len );
+
+    /* Build result. */
+    char* p = ss;
+    i = 0;
+    while ( i < size ) {
+        p = sl_copy_setup( p, sa[ i ] );
+        if ( i < ( size - 1 ) )
+            p = sl_copy_setup( p, glu );
+        i++;
+    }
+    ss[ sl_len( ss ) ] = 0;
+
+    return ss;
+}
+
+
+char* sl_tokenize( sl_t ss, const char* delim, char** pos )
+{
+    if ( *pos == 0 ) {
+        /* First iteration. */
+        size_t idx;
+        if ( !sl_mutable( ss ) )
+            return NULL;
+        idx = sl_search( ss, sl_len( ss ), delim, sc_len( delim ) );
+        if ( idx == SIZE_MAX )
+            return NULL;
+        else {
+            ss[ idx ] = 0;
+            *pos = &( ss[ idx ] );
+            return ss;
+        }
+    } else if ( *pos == sl_end( ss ) ) {
+        /* Passed the last iteration. */
+        return NULL;
+    } else {
+        /* Fix nulled char. */
+        **pos = delim[ 0 ];
+        char* p = *pos;
+        p += strlen( delim );
+
+        if ( *p == 0 ) {
+            /* ss ended with delim, so we are done. */
+            *pos = sl_end( ss );
+            return NULL;
+        }
+
+        /* Find next delim. */
+        size_t idx;
+        idx = sl_search( p, sl_end( ss ) - p, delim, sc_len( delim ) );
+        if ( idx == SIZE_MAX ) {
+            /* Last token, mark this by: */
+            *pos = sl_end( ss );
+            return p;
+        } else {
+            p[ idx ] = 0;
+            *pos = &( p[ idx ] );
+            return p;
+        }
+    }
+}
+
+
+sl_t sl_rm_extension( sl_t ss, const char* ext )
+{
+    sl_pos_t pos;
+
+    sl_mutate( ss );
+
+    pos = sl_find_index_right( ss, ext );
+    if ( pos >= 0 ) {
+        ss[ pos ] = 0;
+        sl_set_len( ss, pos );
+        return ss;
+    } else
+        return NULL;
+}
+
+
+sl_t sl_directory_name( sl_t ss )
+{
+    sl_pos_t i;
+
+    sl_mutate( ss );
+
+    /* Find first "/" from end. */
+    i = sl_find_char_left( ss, '/', sl_len( ss ) );
+    if ( i < 0 )
+        i = 0;
+
+    if ( i == 0 ) {
+        if ( ss[ i ] == '/' ) {
+            ss[ 1 ] = 0;
+            sl_set_len( ss, 1 );
+        } else {
+            ss[ 0 ] = '.';
+            ss[ 1 ] = 0;
+            sl_set_len( ss, 1 );
+            return ss;
+        }
+    } else {
+        ss[ i ] = 0;
+        sl_set_len( ss, i );
+    }
+
+    return ss;
+}
+
+
+sl_t sl_basename( sl_t ss )
+{
+    sl_pos_t i;
+
+    sl_mutate( ss );
+
+    /* Find first "/" from end. */
+    i = sl_find_char_left( ss, '/', sl_len( ss ) );
+    if ( i < 0 )
+        i = 0;
+
+    if ( i == 0 && ss[ i ] != '/' ) {
+        return ss;
+    } else {
+        i++;
+        sl_set_len( ss, sl_len( ss ) - i );
+        memmove( ss, &( ss[ i ] ), sl_len( ss ) );
+        ss[ sl_len( ss ) ] = 0;
+    }
+
+    return ss;
+}
+
+
+sl_t sl_swap_chars( sl_t ss, char f, char t )
+{
+    sl_size_t i;
+
+    sl_mutate( ss );
+
+    i = 0;
+    while ( i < sl_len( ss ) ) {
+        if ( ss[ i ] == f )
+            ss[ i ] = t;
+        i++;
+    }
+
+    return ss;
+}
+
+
+sl_t sl_map_str( sl_p sp, const char* f, const char* t )
+{
+    sl_needle_s nd;
+
+    sl_needle_setup( &nd, f, sc_len( f ) );
+    return sl_map_needle( sp, &nd, t );
+}
+
+
+sl_t sl_map_needle( sl_p sp, sl_needle_t nd, const char* t )
+{
+    /*
+     * If "t" is longer than "f", loop and count how many instances of
+     * "f" is found. Increase size of sp by N*t.len - N*f.len.
+     *
+     * Loop and find the next "f" index. Skip upto index and insert "t"
+     * inplace. Continue until "f" is no more found and insert tail of
+     * "sp".
+     */
+
+    sl_size_t f_len = nd->len;
+    sl_size_t t_len = sc_len( t );
+
+    size_t idx;
+    char * a, *b, *e;
+
+    if ( sl_ext( *sp ) )
+        sl_unshare( sp );
+
+    if ( t_len > f_len ) {
+        /* Calculate number of parts. */
+        sl_size_t cnt;
+
+        /*
+         * Replace XXX with YYYY.
+         *
+         * foooXXXfiiiXXXdiii
+         * foooYYYYfiiiYYYYdiii
+         *
+         * Prepare org before copy as:
+         * --foooXXXfiiiXXXdiii
+         *
+         *   OR
+         *
+         * foooXXXfiiiXXXdiiiXXX
+         * foooYYYYfiiiYYYYdiiiYYYY
+         */
+        cnt = sl_find_all_needle( *sp, nd, NULL, 0 );
+
+        sl_size_t nlen;
+        sl_size_t olen = sl_len( *sp );
+        nlen = sl_len( *sp ) - ( cnt * f_len ) + ( cnt * t_len );
+        sl_grow( sp, nlen + 1 );
+        sl_set_len( *sp, nlen );
+
+        /*
+         * Shift original sp content to right in order to enable copying
+         * chars safely from right to left.
+         */
+        b = &( ( *sp )[ nlen - olen ] );
+        memmove( b, *sp, olen + 1 );
+        a = *sp;
+        e = b + olen;
+    } else {
+        /*
+         * Replace XXX with YY.
+         *
+         * foooXXXfiiiXXXdiii
+         * foooYYfiiiYYdiii
+         */
+        a = *sp;
+        b = *sp;
+        e = sl_end( *sp );
+    }
+
+    while ( *b ) {
+        idx = sl_needle_find( nd, b, e - b, 0 );
+        if ( idx != SIZE_MAX ) {
+            memmove( a, b, idx );
+            a += idx;
+            a = sl_copy_setup( a, t );
+            b += ( idx + f_len );
+        } else {
+            a = sl_copy_setup( a, b );
+            *a = 0;
+            break;
+        }
+    }
+
+    if ( *b == 0 )
+        *a = 0;
+
+    sl_set_len( *sp, a - *sp );
+
+    return *sp;
+}
+
+
+sl_t sl_map_many( sl_p sp, const char** pairs, sl_size_t n )
+{
+    sl_multi_t mp;
+    sr_s*      sr;
+
+    /* Patterns first, then replacements. */
+    sr = (sr_s*)sl_malloc( ( 2 * n + 1 ) * sizeof( sr_s ) );
+    for ( sl_size_t i = 0; i < n; i++ ) {
+        sr[ i ] = sr_new_c( pairs[ 2 * i ] );
+        sr[ n + i ] = sr_new_c( pairs[ 2 * i + 1 ] );
+    }
+
+    mp = sl_multi_new_sr( sr, n );
+    sl_map_multi( sp, mp, sr + n );
+    sl_multi_del( mp );
+    sl_free( sr );
+
+    return *sp;
+}
+
+
+sl_t sl_map_multi( sl_p sp, sl_multi_t mp, const sr_s* to )
+{
+    /*
+     * Scan for output size and for the largest growth at any point,
+     * i.e. how far ahead the output can get from the input. Original
+     * content is moved right by the largest growth, and output is
+     * written from the start. Output never passes unread input.
+     */
+
+    size_t   olen = sl_len( *sp );
+    size_t   pos = 0;
+    size_t   cnt = 0;
+    size_t   idx;
+    int64_t  delta = 0;
+    int64_t  ahead = 0;
+    uint32_t id;
+    char *   a, *b, *e;
+
+    if ( sl_ext( *sp ) )
+        sl_unshare( sp );
+
+    while ( ( idx = sl_multi_find( mp, *sp, olen, pos, &id ) ) != SIZE_MAX ) {
+        delta += (int64_t)to[ id ].len - (int64_t)mp->pat[ id ].len;
+        if ( delta > ahead )
+            ahead = delta;
+        pos = idx + mp->pat[ id ].len;
+        cnt++;
+    }
+
+    if ( cnt == 0 )
+        return *sp;
+
+    sl_reserve( sp, olen + ahead + 1 );
+
+    a = *sp;
+    b = a + ahead;
+    e = b + olen;
+    memmove( b, a, olen + 1 );
+
+    while ( ( idx = sl_multi_find( mp, b, e - b, 0, &id ) ) != SIZE_MAX ) {
+        memmove( a, b, idx );
+        a += idx;
+        memcpy( a, to[ id ].str, to[ id ].len );
+        a += to[ id ].len;
+        b += idx + mp->pat[ id ].len;
+    }
+    memmove( a, b, e - b + 1 );
+    a += e - b;
+
+    sl_set_len( *sp, a - *sp );
+    assert( sl_len( *sp ) == olen + delta );
+
+    return *sp;
+}
+
+
+sl_t sl_map_part( sl_p sp, sl_size_t from_a, sl_size_t from_b, const char* to, sl_size_t to_len )
+{
+    sl_pos_t size_diff;
+    char*    start;
+    char*    orgtail;
+    char*    newtail;
+
+    if ( sl_ext( *sp ) )
+        sl_unshare( sp );
+
+    size_diff = to_len - ( from_b - from_a );
+    if ( size_diff > 0 ) {
+        sl_grow( sp, sl_len1( *sp ) + size_diff );
+    }
+
+    start = *sp;
+    orgtail = &start[ from_b ];
+    newtail = &start[ from_a + to_len ];
+
+    memmove( newtail, orgtail, sl_len1( *sp ) - from_b );
+    memcpy( &start[ from_a ], to, to_len );
+
+    sl_set_len( *sp, sl_len( *sp ) + size_diff );
+
+    return *sp;
+}
+
+
+sl_t sl_capitalize( sl_t ss )
+{
+    sl_mutate( ss );
+    if ( sl_len( ss ) > 0 )
+        ss[ 0 ] = toupper( ss[ 0 ] );
+
+    return ss;
+}
+
+
+sl_t sl_toupper( sl_t ss )
+{
+    sl_mutate( ss );
+    for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
+        ss[ i ] = toupper( ss[ i ] );
+    }
+    return ss;
+}
+
+
+sl_t sl_tolower( sl_t ss )
+{
+    sl_mutate( ss );
+    for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
+        ss[ i ] = tolower( ss[ i ] );
+    }
+    return ss;
+}
+
+
+sl_t sl_read_file( const char* filename )
+{
+    return sl_read_file_with_pad( filename, 0, 0 );
+}
+
+
+sl_t sl_read_file_with_pad( const char* filename, sl_size_t left, sl_size_t right )
+{
+    sl_t ss;
+
+    off_t size = sl_file_size( filename );
+    if ( size < 0 )
+        return NULL; // GCOV_EXCL_LINE
+
+    /* File does not fit to Slinky. */
+    if ( (uint64_t)size + left + right + 1 > SL_STORAGE_MAX )
+        return NULL;
+
+    int fd;
+
+    fd = open( filename, O_RDONLY );
+    if ( fd == -1 )
+        return NULL; // GCOV_EXCL_LINE
+
+    ss = sl_new( size + left + right + 1 );
+
+    if ( sl_read_fd( fd, &ss[ left ], size ) != 0 ) {
+        sl_del2( ss );   // GCOV_EXCL_LINE
+        close( fd );     // GCOV_EXCL_LINE
+        return NULL;     // GCOV_EXCL_LINE
+    }
+
+    /* Zero the head and tail. */
+    memset( ss, 0, left );
+    memset( &ss[ size + left ], 0, right + 1 );
+    sl_set_len( ss, size + left );
+    close( fd );
+
+    return ss;
+}
+
+
+sl_t sl_write_file( sl_t ss, const char* filename )
+{
+    int fd;
+
+    fd = creat( filename, S_IWUSR | S_IRUSR );
+    if ( fd == -1 )
+        return NULL; // GCOV_EXCL_LINE
+    if ( sl_write_fd( fd, ss, sl_len( ss ) ) != 0 )
+        ss = NULL; // GCOV_EXCL_LINE
+    close( fd );
+
+    return ss;
+}
+
+
+void sl_print( const char* fmt, ... )
+{
+    char mem[ 2048 ];
+    sl_t sl;
+
+    sl = sl_use( mem, 2048 );
+
+    va_list ap;
+
+    va_start( ap, fmt );
+    sl_va_format_quick( &sl, fmt, ap );
+    va_end( ap );
+
+    printf( "%s", sl );
+    sl_del( &sl );
+}
+
+
+void sl_write( const int fd, const char* fmt, ... )
+{
+    char mem[ 2048 ];
+    sl_t sl;
+
+    sl = sl_use( mem, 2048 );
+
+    va_list ap;
+
+    va_start( ap, fmt );
+    sl_va_format_quick( &sl, fmt, ap );
+    va_end( ap );
+
+    write( fd, sl, sl_length( sl ) );
+    sl_del( &sl );
+}
+
+
+void sl_dump( sl_t ss )
+{
+    printf( "%s\n", ss );
+    printf( "  len: %llu\n", (unsigned long long)sl_len( ss ) );
+    printf( "  res: %llu\n", (unsigned long long)sl_res( ss ) );
+}
+
+
+void sl_set_local( sl_t ss, int val )
+{
+    assert( val == 0 || !sl_ext( ss ) );
+    if ( val != 0 )
+        sl_set_res( ss, sl_get_res( ss ) | 0x1 );
+    else
+        sl_set_res( ss, sl_get_res( ss ) & sl_smsk );
+}
+
+
+int sl_get_local( sl_t ss )
+{
+    return sl_local( ss );
+}
+
+
+sr_s sr_new( const char* str, sl_size_t len )
+{
+    sr_s ret;
+    ret.str = str;
+    ret.len = len;
+    return ret;
+}
+
+
+sr_s sr_new_c( const char* str )
+{
+    sr_s ret;
+    ret.str = str;
+    ret.len = strlen( str );
+    return ret;
+}
+
+const char* sr_text( sr_s sr )
+{
+    return sr.str;
+}
+
+sl_size_t sr_length( sr_s sr )
+{
+    return sr.len;
+}
+
+int sr_compare( sr_s s1, sr_s s2 )
+{
+    if ( s1.len != s2.len ) {
+        return 1;
+    } else {
+        return memcmp( s1.str, s2.str, s1.len );
+    }
+}
+
+int sr_compare_full( sr_s s1, sr_s s2 )
+{
+    if ( s1.len != s2.len ) {
+        size_t len;
+        if ( s1.len < s2.len ) {
+            len = s1.len;
+        } else {
+            len = s2.len;
+        }
+        return strncmp( s1.str, s2.str, len );
+    } else {
+        return strncmp( s1.str, s2.str, s1.len );
+    }
+}
+
+int sr_compare_icase( sr_s s1, sr_s s2 )
+{
+    if ( s1.len != s2.len ) {
+        return 1;
+    } else {
+        return sl_mem_icase( s1.str, s2.str, s1.len );
+    }
+}
+
+int sr_compare_full_icase( sr_s s1, sr_s s2 )
+{
+    if ( s1.len < s2.len ) {
+        return sl_mem_icase( s1.str, s2.str, s1.len );
+    } else {
+        return sl_mem_icase( s1.str, s2.str, s2.len );
+    }
+}
+
+
+sl_hmap_t sl_hmap_new( size_t size )
+{
+    sl_hmap_t map;
+    size_t    cap = SL_HMAP_GROUP;
+
+    while ( cap / 8 * 7 < size )
+        cap *= 2;
+
+    map = (sl_hmap_t)sl_malloc( sizeof( sl_hmap_s ) );
+    sl_hmap_alloc( map, cap );
+    map->count = 0;
+
+    return map;
+}
+
+
+void sl_hmap_del( sl_hmap_t map )
+{
+    for ( size_t i = 0; i < map->cap; i++ ) {
+        if ( map->ctrl[ i ] >= 0 )
+            sl_del2( map->slot[ i ].key );
+    }
+    sl_free( map->ctrl );
+    sl_free( map->slot );
+    sl_free( map );
+}
+
+
+int sl_hmap_put( sl_hmap_t map, sl_t key, void* value )
+{
+    uint64_t hash = sl_hash( key );
+    size_t   idx;
+
+    idx = sl_hmap_lookup( map, key, sl_len( key ), hash );
+    if ( idx != SIZE_MAX ) {
+        map->slot[ idx ].value = value;
+        return 0;
+    }
+
+    idx = sl_hmap_insert( map, hash );
+    map->slot[ idx ].key = sl_replicate( key );
+    map->slot[ idx ].value = value;
+
+    return 1;
+}
+
+
+int sl_hmap_put_sr( sl_hmap_t map, sr_s key, void* value )
+{
+    uint64_t hash = sl_hash_sr( key );
+    size_t   idx;
+    sl_t     ss;
+
+    idx = sl_hmap_lookup( map, key.str, key.len, hash );
+    if ( idx != SIZE_MAX ) {
+        map->slot[ idx ].value = value;
+        return 0;
+    }
+
+    ss = sl_new( key.len + 1 );
+    memcpy( ss, key.str, key.len );
+    ss[ key.len ] = 0;
+    sl_set_len( ss, key.len );
+
+    idx = sl_hmap_insert( map, hash );
+    map->slot[ idx ].key = ss;
+    map->slot[ idx ].value = value;
+
+    return 1;
+}
+
+
+void** sl_hmap_find( sl_hmap_t map, sr_s key )
+{
+    size_t idx;
+
+    idx = sl_hmap_lookup( map, key.str, key.len, sl_hash_sr( key ) );
+    if ( idx != SIZE_MAX )
+        return &map->slot[ idx ].value;
+    else
+        return NULL;
+}
+
+
+void** sl_hmap_find_sl( sl_hmap_t map, sl_t key )
+{
+    size_t idx;
+
+    idx = sl_hmap_lookup( map, key, sl_len( key ), sl_hash( key ) );
+    if ( idx != SIZE_MAX )
+        return &map->slot[ idx ].value;
+    else
+        return NULL;
+}
+
+
+int sl_hmap_erase( sl_hmap_t map, sr_s key )
+{
+    size_t idx;
+    size_t grp;
+
+    idx = sl_hmap_lookup( map, key.str, key.len, sl_hash_sr( key ) );
+    if ( idx == SIZE_MAX )
+        return 0;
+
+    sl_del2( map->slot[ idx ].key );
+
+    /* Probing stops at group with empty slot, hence the slot can be
+       emptied if group has empty slots. */
+    grp = idx & ~( (size_t)SL_HMAP_GROUP - 1 );
+    if ( sl_hmap_match( &map->ctrl[ grp ], SL_HMAP_EMPTY ) ) {
+        map->ctrl[ idx ] = SL_HMAP_EMPTY;
+        map->left++;
+    } else {
+        map->ctrl[ idx ] = SL_HMAP_DELETED;
+    }
+    map->count--;
+
+    return 1;
+}
+
+
+size_t sl_hmap_count( sl_hmap_t map )
+{
+    return map->count;
+}
+
+
+int sl_hmap_next( sl_hmap_t map, size_t* iter, sl_t* key, void** value )
+{
+    while ( *iter < map->cap ) {
+        size_t i = ( *iter )++;
+        if ( map->ctrl[ i ] >= 0 ) {
+            *key = map->slot[ i ].key;
+            if ( value )
+                *value = map->slot[ i ].value;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+sl_needle_t sl_needle_new( const char* cs )
+{
+    return sl_needle_new_sr( sr_new_c( cs ) );
+}
+
+
+sl_needle_t sl_needle_new_sr( sr_s sr )
+{
+    return sl_needle_create( sr, 0 );
+}
+
+
+sl_needle_t sl_needle_new_icase( const char* cs )
+{
+    return sl_needle_create( sr_new_c( cs ), 1 );
+}
+
+
+void sl_needle_del( sl_needle_t nd )
+{
+    sl_free( nd );
+}
+
+
+sl_pos_t sl_find_needle( sl_t ss, sl_needle_t nd, sl_size_t pos )
+{
+    size_t idx;
+
+    idx = sl_needle_find( nd, ss, sl_len( ss ), pos );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_pos_t sr_find_needle( sr_s sr, sl_needle_t nd, sl_size_t pos )
+{
+    size_t idx;
+
+    idx = sl_needle_find( nd, sr.str, sr.len, pos );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_pos_t sl_find_needle_right( sl_t ss, sl_needle_t nd, sl_size_t pos )
+{
+    size_t idx;
+
+    if ( pos > sl_len( ss ) )
+        pos = sl_len( ss );
+
+    idx = sl_needle_find_rev( nd, ss, pos );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_pos_t sr_find_needle_right( sr_s sr, sl_needle_t nd, sl_size_t pos )
+{
+    size_t idx;
+
+    if ( pos > sr.len )
+        pos = sr.len;
+
+    idx = sl_needle_find_rev( nd, sr.str, pos );
+    if ( idx == SIZE_MAX )
+        return -1;
+    else
+        return idx;
+}
+
+
+sl_size_t sl_find_all_needle( sl_t ss, sl_needle_t nd, sl_size_t* offs, sl_size_t size )
+{
+    sl_size_t cnt = 0;
+    size_t    pos = 0;
+    size_t    idx;
+
+    while ( ( idx = sl_needle_find( nd, ss, sl_len( ss ), pos ) ) != SIZE_MAX ) {
+        if ( cnt < size )
+            offs[ cnt ] = idx;
+        cnt++;
+        pos = idx + nd->len;
+    }
+
+    return cnt;
+}
+
+
+sl_multi_t sl_multi_new( const char** pats, sl_size_t cnt )
+{
+    sl_multi_t mp;
+    sr_s*      sr;
+
+    sr = (sr_s*)sl_malloc( ( cnt + 1 ) * sizeof( sr_s ) );
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        sr[ i ] = sr_new_c( pats[ i ] );
+    mp = sl_multi_new_sr( sr, cnt );
+    sl_free( sr );
+
+    return mp;
+}
+
+
+sl_multi_t sl_multi_new_sr( const sr_s* pats, sl_size_t cnt )
+{
+    sl_multi_t mp;
+    size_t     total = 0;
+    char*      str;
+
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        total += pats[ i ].len;
+
+    /* Patterns are copied after the pattern references. */
+    mp = (sl_multi_t)sl_malloc( sizeof( sl_multi_s ) );
+    mp->pat = (sr_s*)sl_malloc( cnt * sizeof( sr_s ) + total + 1 );
+    mp->cnt = cnt;
+    str = (char*)( mp->pat + cnt );
+    for ( sl_size_t i = 0; i < cnt; i++ ) {
+        memcpy( str, pats[ i ].str, pats[ i ].len );
+        mp->pat[ i ] = sr_new( str, pats[ i ].len );
+        str += pats[ i ].len;
+    }
+
+    sl_multi_build( mp );
+
+    return mp;
+}
+
+
+void sl_multi_del( sl_multi_t mp )
+{
+    sl_free( mp->next );
+    sl_free( mp->out );
+    sl_free( mp->depth );
+    sl_free( mp->pat );
+    sl_free( mp );
+}
+
+
+sl_pos_t sl_find_multi( sl_t ss, sl_multi_t mp, sl_size_t pos, sl_size_t* id )
+{
+    return sr_find_multi( sr_new( ss, sl_len( ss ) ), mp, pos, id );
+}
+
+
+sl_pos_t sr_find_multi( sr_s sr, sl_multi_t mp, sl_size_t pos, sl_size_t* id )
+{
+    size_t   idx;
+    uint32_t pid;
+
+    idx = sl_multi_find( mp, sr.str, sr.len, pos, &pid );
+    if ( idx == SIZE_MAX )
+        return -1;
+
+    if ( id )
+        *id = pid;
+    return idx;
+}
+
+
+sl_size_t sl_find_all_multi( sl_t ss, sl_multi_t mp, sl_match_s* match, sl_size_t size )
+{
+    return sl_multi_all( mp, sr_new( ss, sl_len( ss ) ), match, size );
+}
+
+
+sl_size_t sr_find_all_multi( sr_s sr, sl_multi_t mp, sl_match_s* match, sl_size_t size )
+{
+    return sl_multi_all( mp, sr, match, size );
+}
+
+
+sl_size_t sl_count_multi( sl_t ss, sl_multi_t mp )
+{
+    return sl_multi_all( mp, sr_new( ss, sl_len( ss ) ), NULL, 0 );
+}
+
+
+sl_size_t sr_count_multi( sr_s sr, sl_multi_t mp )
+{
+    return sl_multi_all( mp, sr, NULL, 0 );
+}
+
+
+sl_glob_t sl_glob_new( const char* pat )
+{
+    return sl_glob_new_many( &pat, 1 );
+}
+
+
+sl_glob_t sl_glob_new_many( const char** pats, sl_size_t cnt )
+{
+    sl_glob_t gp;
+    sr_s*     sr;
+
+    sr = (sr_s*)sl_malloc( ( cnt + 1 ) * sizeof( sr_s ) );
+    for ( sl_size_t i = 0; i < cnt; i++ )
+        sr[ i ] = sr_new_c( pats[ i ] );
+    gp = sl_glob_new_sr( sr, cnt );
+    sl_free( sr );
+
+    return gp;
+}
+
+
+sl_glob_t sl_glob_new_sr( const sr_s* pats, sl_size_t cnt )
+{
+    sl_glob_t gp;
+
+    gp = (sl_glob_t)sl_malloc( sizeof( sl_glob_s ) );
+    gp->cnt = cnt;
+    sl_glob_build( gp, pats );
+
+    return gp;
+}
+
+
+void sl_glob_del( sl_glob_t gp )
+{
+    if ( gp->dfa ) {
+        sl_free( gp->dfa );
+        sl_free( gp->dacc );
+    }
+    sl_free( gp->mask );
+    sl_free( gp->star );
+    sl_free( gp->pid );
+    sl_free( gp );
+}
+
+
+sl_pos_t sl_glob_match( sl_t ss, sl_glob_t gp )
+{
+    return sr_glob_match( sr_new( ss, sl_len( ss ) ), gp );
+}
+
+
+sl_pos_t sr_glob_match( sr_s sr, sl_glob_t gp )
+{
+    size_t id;
+
+    id = sl_glob_run( gp, sr.str, sr.len );
+    if ( id == SIZE_MAX )
+        return -1;
+    else
+        return id;
+}
+
+
+
+
+/* ------------------------------------------------------------
+ * Utility functions.
+ * ------------------------------------------------------------ */
+
+
+/**
+ * Find first "c" from "cs".
+ *
+ * Vector loop checks four vectors per round.
+ *
+ * @param cs  Data.
+ * @param len Data length.
+ * @param c   Char to find.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_scan_char( const char* cs, size_t len, char c )
+{
+    size_t i = 0;
+
+#ifdef SL_VEC
+    sl_vec_t v = sl_vsplat( c );
+    uint64_t m;
+
+    for ( ; i + 4 * SL_VEC <= len; i += 4 * SL_VEC ) {
+        sl_vec_t e0 = sl_veq( sl_vload( cs + i ), v );
+        sl_vec_t e1 = sl_veq( sl_vload( cs + i + SL_VEC ), v );
+        sl_vec_t e2 = sl_veq( sl_vload( cs + i + 2 * SL_VEC ), v );
+        sl_vec_t e3 = sl_veq( sl_vload( cs + i + 3 * SL_VEC ), v );
+        if ( sl_vmask( sl_vor( sl_vor( e0, e1 ), sl_vor( e2, e3 ) ) ) ) {
+            if ( ( m = sl_vmask( e0 ) ) )
+                return i + __builtin_ctzll( m ) / SL_VBITS;
+            if ( ( m = sl_vmask( e1 ) ) )
+                return i + SL_VEC + __builtin_ctzll( m ) / SL_VBITS;
+            if ( ( m = sl_vmask( e2 ) ) )
+                return i + 2 * SL_VEC + __builtin_ctzll( m ) / SL_VBITS;
+            m = sl_vmask( e3 );
+            return i + 3 * SL_VEC + __builtin_ctzll( m ) / SL_VBITS;
+        }
+    }
+
+    for ( ; i + SL_VEC <= len; i += SL_VEC ) {
+        m = sl_vmask( sl_veq( sl_vload( cs + i ), v ) );
+        if ( m )
+            return i + __builtin_ctzll( m ) / SL_VBITS;
+    }
+#endif
+
+    for ( ; i < len; i++ ) {
+        if ( cs[ i ] == c )
+            return i;
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Find last "c" from "cs".
+ *
+ * @param cs  Data.
+ * @param len Data length.
+ * @param c   Char to find.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_scan_char_rev( const char* cs, size_t len, char c )
+{
+    size_t i = len;
+
+#ifdef SL_VEC
+    sl_vec_t v = sl_vsplat( c );
+    uint64_t m;
+
+    while ( i >= SL_VEC ) {
+        i -= SL_VEC;
+        m = sl_vmask( sl_veq( sl_vload( cs + i ), v ) );
+        if ( m )
+            return i + ( 63 - __builtin_clzll( m ) ) / SL_VBITS;
+    }
+#endif
+
+    while ( i > 0 ) {
+        i--;
+        if ( cs[ i ] == c )
+            return i;
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Count "c" in "cs".
+ *
+ * @param cs  Data.
+ * @param len Data length.
+ * @param c   Char to count.
+ *
+ * @return Count.
+ */
+static size_t sl_scan_count( const char* cs, size_t len, char c )
+{
+    size_t i = 0;
+    size_t cnt = 0;
+
+#ifdef SL_VEC
+    sl_vec_t v = sl_vsplat( c );
+
+    for ( ; i + SL_VEC <= len; i += SL_VEC )
+        cnt += __builtin_popcountll( sl_vmask( sl_veq( sl_vload( cs + i ), v ) ) );
+    cnt /= SL_VBITS;
+#endif
+
+    for ( ; i < len; i++ )
+        cnt += ( cs[ i ] == c );
+
+    return cnt;
+}
+
+
+/**
+ * Find first char of "set" from "cs".
+ *
+ * Small sets are compared with vectors, bigger sets with byte map.
+ *
+ * @param cs  Data.
+ * @param len Data length.
+ * @param set Chars to find.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_scan_any( const char* cs, size_t len, const char* set )
+{
+    size_t  i = 0;
+    size_t  cnt = sc_len( set );
+    uint8_t map[ 256 ];
+
+    if ( cnt == 0 )
+        return SIZE_MAX;
+    if ( cnt == 1 )
+        return sl_scan_char( cs, len, set[ 0 ] );
+
+#ifdef SL_VEC
+    if ( cnt <= SL_ANY_VEC ) {
+        sl_vec_t v[ SL_ANY_VEC ];
+        uint64_t m;
+
+        for ( size_t j = 0; j < cnt; j++ )
+            v[ j ] = sl_vsplat( set[ j ] );
+
+        for ( ; i + SL_VEC <= len; i += SL_VEC ) {
+            sl_vec_t d = sl_vload( cs + i );
+            sl_vec_t e = sl_veq( d, v[ 0 ] );
+            for ( size_t j = 1; j < cnt; j++ )
+                e = sl_vor( e, sl_veq( d, v[ j ] ) );
+            m = sl_vmask( e );
+            if ( m )
+                return i + __builtin_ctzll( m ) / SL_VBITS;
+        }
+    }
+#endif
+
+    memset( map, 0, sizeof( map ) );
+    for ( size_t j = 0; j < cnt; j++ )
+        map[ (uint8_t)set[ j ] ] = 1;
+
+    for ( ; i < len; i++ ) {
+        if ( map[ (uint8_t)cs[ i ] ] )
+            return i;
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Return estimated frequency rank of byte in text (higher is more
+ * frequent).
+ *
+ * @param c Byte.
+ *
+ * @return Rank.
+ */
+static int sl_byte_rank( uint8_t c )
+{
+    if ( c == ' ' )
+        return 255;
+    if ( c >= 'a' && c <= 'z' )
+        /* "etaoinshrdlu" are the most common. */
+        return ( ( 0x1e6999 >> ( c - 'a' ) ) & 1 ) ? 240 : 200;
+    if ( c == '\n' || c == '\t' )
+        return 160;
+    if ( c >= '0' && c <= '9' )
+        return 150;
+    if ( c >= 'A' && c <= 'Z' )
+        return 140;
+    if ( c > ' ' && c < 0x7f )
+        return 100;
+    return 50;
+}
+
+
+/**
+ * Create compiled needle with copy of "sr". All tables are set up,
+ * hence needle is read-only when used.
+ *
+ * @param sr    Needle string.
+ * @param icase ASCII case-insensitive.
+ *
+ * @return Needle.
+ */
+static sl_needle_t sl_needle_create( sr_s sr, int icase )
+{
+    sl_needle_t nd;
+    char*       str;
+
+    nd = (sl_needle_t)sl_malloc( sizeof( sl_needle_s ) + sr.len + 1 );
+    str = (char*)( nd + 1 );
+    memcpy( str, sr.str, sr.len );
+    str[ sr.len ] = 0;
+
+    sl_needle_setup( nd, str, sr.len );
+    nd->icase = icase;
+    if ( sr.len > 1 ) {
+        sl_needle_rare( nd );
+        sl_needle_twoway( nd );
+    }
+
+    return nd;
+}
+
+
+/**
+ * Setup needle for filter search. Needle string is not copied.
+ *
+ * Filter bytes are the first and the last byte. Two-Way tables are
+ * set up on demand.
+ *
+ * @param nd  Needle.
+ * @param str Needle string.
+ * @param len Needle length.
+ */
+static void sl_needle_setup( sl_needle_t nd, const char* str, size_t len )
+{
+    nd->str = (char*)str;
+    nd->len = len;
+    nd->off0 = 0;
+    nd->off1 = ( len > 0 ) ? len - 1 : 0;
+    nd->icase = 0;
+    nd->p = 0;
+}
+
+
+/**
+ * Select needle filter bytes by rarity: the rarest byte, and the
+ * rarest byte that is different from it. Needle with single byte
+ * value keeps the first and the last byte.
+ *
+ * @param nd Needle.
+ */
+static void sl_needle_rare( sl_needle_t nd )
+{
+    const uint8_t* n = (const uint8_t*)nd->str;
+    size_t         o0 = 0;
+    size_t         o1 = SIZE_MAX;
+    int            r0 = 256;
+    int            r1 = 256;
+    int            r;
+
+    for ( size_t i = 0; i < nd->len; i++ ) {
+        r = sl_byte_rank( sl_nfold( nd, n[ i ] ) );
+        if ( r < r0 ) {
+            r0 = r;
+            o0 = i;
+        }
+    }
+    for ( size_t i = 0; i < nd->len; i++ ) {
+        r = sl_byte_rank( sl_nfold( nd, n[ i ] ) );
+        if ( sl_nfold( nd, n[ i ] ) != sl_nfold( nd, n[ o0 ] ) && r < r1 ) {
+            r1 = r;
+            o1 = i;
+        }
+    }
+
+    if ( o1 != SIZE_MAX ) {
+        nd->off0 = o0;
+        nd->off1 = o1;
+    }
+}
+
+
+/**
+ * Setup Two-Way tables for needle: critical factorization, period and
+ * bad char shift.
+ *
+ * @param nd Needle.
+ */
+static void sl_needle_twoway( sl_needle_t nd )
+{
+    const uint8_t* n = (const uint8_t*)nd->str;
+    size_t         nlen = nd->len;
+    size_t         ip, jp, k, p, ms, p0;
+
+    memset( nd->set, 0, sizeof( nd->set ) );
+    for ( size_t i = 0; i < nlen; i++ ) {
+        uint8_t c = sl_nfold( nd, n[ i ] );
+        nd->set[ c >> 6 ] |= (uint64_t)1 << ( c & 63 );
+        nd->shift[ c ] = i + 1;
+    }
+
+    /* Maximal suffix for "<" order. */
+    ip = SIZE_MAX;
+    jp = 0;
+    k = p = 1;
+    while ( jp + k < nlen ) {
+        if ( sl_nfold( nd, n[ ip + k ] ) == sl_nfold( nd, n[ jp + k ] ) ) {
+            if ( k == p ) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if ( sl_nfold( nd, n[ ip + k ] ) > sl_nfold( nd, n[ jp + k ] ) ) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    ms = ip;
+    p0 = p;
+
+    /* Maximal suffix for ">" order. */
+    ip = SIZE_MAX;
+    jp = 0;
+    k = p = 1;
+    while ( jp + k < nlen ) {
+        if ( sl_nfold( nd, n[ ip + k ] ) == sl_nfold( nd, n[ jp + k ] ) ) {
+            if ( k == p ) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if ( sl_nfold( nd, n[ ip + k ] ) < sl_nfold( nd, n[ jp + k ] ) ) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+
+    /* Critical factorization is the longer suffix. */
+    if ( ip + 1 > ms + 1 )
+        ms = ip;
+    else
+        p = p0;
+
+    if ( nd->icase ? sl_mem_icase( nd->str, nd->str + p, ms + 1 ) : memcmp( n, n + p, ms + 1 ) ) {
+        /* Non-periodic needle. */
+        nd->mem0 = 0;
+        p = ( ( ms > nlen - ms - 1 ) ? ms : nlen - ms - 1 ) + 1;
+    } else {
+        nd->mem0 = nlen - p;
+    }
+    nd->ms = ms;
+    nd->p = p;
+}
+
+
+/**
+ * Find "ndl" from "hay".
+ *
+ * Needle is set up on stack with first/last byte filter, see
+ * sl_needle_find().
+ *
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param ndl  Needle.
+ * @param nlen Needle length.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_search( const char* hay, size_t hlen, const char* ndl, size_t nlen )
+{
+    sl_needle_s nd;
+
+    if ( nlen == 0 || nlen > hlen )
+        return SIZE_MAX;
+    if ( nlen == 1 )
+        return sl_scan_char( hay, hlen, ndl[ 0 ] );
+
+    sl_needle_setup( &nd, ndl, nlen );
+    return sl_needle_find( &nd, hay, hlen, 0 );
+}
+
+
+/**
+ * Find needle from "hay" starting at "pos".
+ *
+ * Search is selected by needle length: char scan for single char,
+ * and byte pair filter otherwise. Filter falls back to Two-Way for
+ * long needles with many false candidates, hence search is linear in
+ * haystack length. Empty needle is not found, as in sl_find_index().
+ * Case-insensitive needle is always searched with filter.
+ *
+ * @param nd   Needle.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_needle_find( sl_needle_t nd, const char* hay, size_t hlen, size_t pos )
+{
+    size_t idx;
+
+    if ( nd->len == 0 || pos > hlen || nd->len > hlen - pos )
+        return SIZE_MAX;
+    if ( nd->icase )
+        return sl_search_filter_icase( nd, hay, hlen, pos );
+    if ( nd->len == 1 ) {
+        idx = sl_scan_char( hay + pos, hlen - pos, nd->str[ 0 ] );
+        return ( idx == SIZE_MAX ) ? idx : pos + idx;
+    }
+    return sl_search_filter( nd, hay, hlen, pos );
+}
+
+
+/**
+ * Find needle from "hay" with byte pair filter.
+ *
+ * Candidates are positions where both filter bytes match (vector
+ * compare of two shifted loads), and candidates are verified with
+ * memcmp. Long needle switches to Two-Way, when verified bytes exceed
+ * scanned bytes.
+ *
+ * @param nd   Needle (2 or more bytes).
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_search_filter( sl_needle_t nd, const char* hay, size_t hlen, size_t pos )
+{
+    const char* ndl = nd->str;
+    size_t      nlen = nd->len;
+    size_t      last = hlen - nlen;
+    size_t      i = pos;
+    size_t      work = 0;
+    size_t      o0 = nd->off0;
+    size_t      o1 = nd->off1;
+    char        c0 = ndl[ o0 ];
+    char        c1 = ndl[ o1 ];
+
+#ifdef SL_VEC
+    sl_vec_t v0 = sl_vsplat( c0 );
+    sl_vec_t v1 = sl_vsplat( c1 );
+    uint64_t m;
+
+    for ( ; i + SL_VEC <= last + 1; i += SL_VEC ) {
+        m = sl_vmask( sl_vand( sl_veq( sl_vload( hay + i + o0 ), v0 ),
+                               sl_veq( sl_vload( hay + i + o1 ), v1 ) ) );
+        while ( m ) {
+            size_t at = i + __builtin_ctzll( m ) / SL_VBITS;
+            if ( nlen > SL_SEARCH_SHORT && ( work += nlen ) > at - pos + 4096 )
+                return sl_search_twoway( nd, hay, hlen, at, 0 );
+            if ( !memcmp( hay + at, ndl, nlen ) )
+                return at;
+            m &= ~( ( ( (uint64_t)1 << SL_VBITS ) - 1 ) << ( ( at - i ) * SL_VBITS ) );
+        }
+    }
+#endif
+
+    for ( ; i <= last; i++ ) {
+        if ( hay[ i + o0 ] == c0 && hay[ i + o1 ] == c1 ) {
+            if ( nlen > SL_SEARCH_SHORT && ( work += nlen ) > i - pos + 4096 )
+                return sl_search_twoway( nd, hay, hlen, i, 0 );
+            if ( !memcmp( hay + i, ndl, nlen ) )
+                return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Find needle from "hay" with byte pair filter, ASCII
+ * case-insensitive. Haystack is folded to lowercase on the fly, see
+ * sl_search_filter().
+ *
+ * @param nd   Needle (case-insensitive).
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_search_filter_icase( sl_needle_t nd, const char* hay, size_t hlen, size_t pos )
+{
+    const char* ndl = nd->str;
+    size_t      nlen = nd->len;
+    size_t      last = hlen - nlen;
+    size_t      i = pos;
+    size_t      work = 0;
+    size_t      o0 = nd->off0;
+    size_t      o1 = nd->off1;
+    uint8_t     c0 = sl_lower( ndl[ o0 ] );
+    uint8_t     c1 = sl_lower( ndl[ o1 ] );
+
+#ifdef SL_VEC
+    sl_vec_t v0 = sl_vsplat( c0 );
+    sl_vec_t v1 = sl_vsplat( c1 );
+    uint64_t m;
+
+    for ( ; i + SL_VEC <= last + 1; i += SL_VEC ) {
+        m = sl_vmask( sl_vand( sl_veq( sl_vlower( sl_vload( hay + i + o0 ) ), v0 ),
+                               sl_veq( sl_vlower( sl_vload( hay + i + o1 ) ), v1 ) ) );
+        while ( m ) {
+            size_t at = i + __builtin_ctzll( m ) / SL_VBITS;
+            if ( nlen > SL_SEARCH_SHORT && ( work += nlen ) > at - pos + 4096 )
+                return sl_search_twoway( nd, hay, hlen, at, 0 );
+            if ( !sl_mem_icase( hay + at, ndl, nlen ) )
+                return at;
+            m &= ~( ( ( (uint64_t)1 << SL_VBITS ) - 1 ) << ( ( at - i ) * SL_VBITS ) );
+        }
+    }
+#endif
+
+    for ( ; i <= last; i++ ) {
+        if ( sl_lower( hay[ i + o0 ] ) == c0 && sl_lower( hay[ i + o1 ] ) == c1 ) {
+            if ( nlen > SL_SEARCH_SHORT && ( work += nlen ) > i - pos + 4096 )
+                return sl_search_twoway( nd, hay, hlen, i, 0 );
+            if ( !sl_mem_icase( hay + i, ndl, nlen ) )
+                return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Compare memory ASCII case-insensitively. Bytes are folded to
+ * lowercase on the fly.
+ *
+ * @param s1  One.
+ * @param s2  The other.
+ * @param len Compared length.
+ *
+ * @return Difference of first different (folded) bytes, or 0.
+ */
+static int sl_mem_icase( const char* s1, const char* s2, size_t len )
+{
+    size_t i = 0;
+
+#ifdef SL_VEC
+    for ( ; i + SL_VEC <= len; i += SL_VEC ) {
+        uint64_t m = sl_vmask( sl_veq( sl_vlower( sl_vload( s1 + i ) ), sl_vlower( sl_vload( s2 + i ) ) ) );
+        if ( m != SL_VFULL ) {
+            /* Scalar loop returns the difference. */
+            i += __builtin_ctzll( ~m ) / SL_VBITS;
+            break;
+        }
+    }
+#endif
+
+    for ( ; i < len; i++ ) {
+        int d = sl_lower( s1[ i ] ) - sl_lower( s2[ i ] );
+        if ( d )
+            return d;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find needle from "hay" with Two-Way algorithm (Crochemore-Perrin).
+ *
+ * Needle is split by critical factorization. Right part is compared
+ * first, and on match the left part. Bad char shift (last window
+ * byte) skips windows quickly. Search is linear and uses constant
+ * space.
+ *
+ * Two-Way tables are set up, if not done yet. Case-insensitive needle
+ * folds bytes on compare.
+ *
+ * With "last", search continues after match (shift by period), and
+ * the last match is returned.
+ *
+ * @param nd   Needle.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ * @param last Find last match.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_search_twoway( sl_needle_t nd, const char* hay, size_t hlen, size_t pos, int last )
+{
+    const uint8_t* h = (const uint8_t*)hay;
+    const uint8_t* n = (const uint8_t*)nd->str;
+    size_t         nlen = nd->len;
+    size_t         found = SIZE_MAX;
+    size_t         k, mem;
+
+    if ( nd->p == 0 )
+        sl_needle_twoway( nd );
+    mem = 0;
+
+    while ( pos + nlen <= hlen ) {
+        const uint8_t* w = h + pos;
+        uint8_t        c = sl_nfold( nd, w[ nlen - 1 ] );
+
+        /* Bad char shift. */
+        if ( nd->set[ c >> 6 ] & ( (uint64_t)1 << ( c & 63 ) ) ) {
+            k = nlen - nd->shift[ c ];
+            if ( k ) {
+                if ( k < mem )
+                    k = mem;
+                pos += k;
+                mem = 0;
+                continue;
+            }
+        } else {
+            pos += nlen;
+            mem = 0;
+            continue;
+        }
+
+        /* Right part. */
+        for ( k = ( nd->ms + 1 > mem ) ? nd->ms + 1 : mem; k < nlen && sl_nfold( nd, n[ k ] ) == sl_nfold( nd, w[ k ] ); k++ )
+            ;
+        if ( k < nlen ) {
+            pos += k - nd->ms;
+            mem = 0;
+            continue;
+        }
+
+        /* Left part. */
+        for ( k = nd->ms + 1; k > mem && sl_nfold( nd, n[ k - 1 ] ) == sl_nfold( nd, w[ k - 1 ] ); k-- )
+            ;
+        if ( k <= mem ) {
+            if ( !last )
+                return pos;
+            found = pos;
+        }
+
+        pos += nd->p;
+        mem = nd->mem0;
+    }
+
+    return found;
+}
+
+
+/**
+ * Find last needle from "hay" with Two-Way algorithm.
+ *
+ * Haystack is searched backwards in windows, and the last match of
+ * window is found with sl_search_twoway(). Window size is doubled
+ * after each window, hence search time is linear to the distance of
+ * the match from the end, and not to the haystack length.
+ *
+ * @param nd   Needle.
+ * @param hay  Haystack.
+ * @param hlen Haystack length (search end, at least needle length).
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_search_twoway_rev( sl_needle_t nd, const char* hay, size_t hlen )
+{
+    size_t nlen = nd->len;
+    size_t win = ( nlen > 4096 ) ? nlen : 4096;
+    size_t pos, at;
+
+    for ( ;; ) {
+        /* Window positions are from "pos" to "hlen - nlen". */
+        pos = ( hlen - nlen > win ) ? hlen - nlen - win : 0;
+        at = sl_search_twoway( nd, hay, hlen, pos, 1 );
+        if ( at != SIZE_MAX || pos == 0 )
+            return at;
+        hlen = pos - 1 + nlen;
+        win *= 2;
+    }
+}
+
+
+/**
+ * Find last needle from "hay" with byte pair filter, i.e. reverse
+ * sl_search_filter().
+ *
+ * Blocks are scanned from the end, and candidates from the last one
+ * in block. Long needle switches to Two-Way over the remaining prefix
+ * (see sl_search_twoway_rev()), when verified bytes exceed scanned
+ * bytes. With "icase" haystack is
+ * folded on the fly. Search is inlined to sl_needle_find_rev(), hence
+ * "icase" is a constant.
+ *
+ * @param nd    Needle.
+ * @param hay   Haystack.
+ * @param hlen  Haystack length (search end).
+ * @param icase ASCII case-insensitive.
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static inline __attribute__( ( always_inline ) ) size_t sl_search_filter_rev( sl_needle_t nd, const char* hay, size_t hlen, int icase )
+{
+    const char* ndl = nd->str;
+    size_t      nlen = nd->len;
+    size_t      i = hlen - nlen + 1;
+    size_t      work = 0;
+    size_t      o0 = nd->off0;
+    size_t      o1 = nd->off1;
+    uint8_t     c0 = icase ? sl_lower( ndl[ o0 ] ) : (uint8_t)ndl[ o0 ];
+    uint8_t     c1 = icase ? sl_lower( ndl[ o1 ] ) : (uint8_t)ndl[ o1 ];
+
+#ifdef SL_VEC
+    sl_vec_t v0 = sl_vsplat( c0 );
+    sl_vec_t v1 = sl_vsplat( c1 );
+    sl_vec_t a, b;
+    uint64_t m;
+
+    while ( i >= SL_VEC ) {
+        i -= SL_VEC;
+        a = sl_vload( hay + i + o0 );
+        b = sl_vload( hay + i + o1 );
+        if ( icase ) {
+            a = sl_vlower( a );
+            b = sl_vlower( b );
+        }
+        m = sl_vmask( sl_vand( sl_veq( a, v0 ), sl_veq( b, v1 ) ) );
+        while ( m ) {
+            size_t at = i + ( 63 - __builtin_clzll( m ) ) / SL_VBITS;
+            if ( nlen > SL_SEARCH_SHORT && ( work += nlen ) > hlen - at + 4096 )
+                return sl_search_twoway_rev( nd, hay, at + nlen );
+            if ( !( icase ? sl_mem_icase( hay + at, ndl, nlen ) : memcmp( hay + at, ndl, nlen ) ) )
+                return at;
+            m &= ~( ( ( (uint64_t)1 << SL_VBITS ) - 1 ) << ( ( at - i ) * SL_VBITS ) );
+        }
+    }
+#endif
+
+    while ( i > 0 ) {
+        i--;
+        if ( ( icase ? sl_lower( hay[ i + o0 ] ) : (uint8_t)hay[ i + o0 ] ) == c0
+             && ( icase ? sl_lower( hay[ i + o1 ] ) : (uint8_t)hay[ i + o1 ] ) == c1 ) {
+            if ( nlen > SL_SEARCH_SHORT && ( work += nlen ) > hlen - i + 4096 )
+                return sl_search_twoway_rev( nd, hay, i + nlen );
+            if ( !( icase ? sl_mem_icase( hay + i, ndl, nlen ) : memcmp( hay + i, ndl, nlen ) ) )
+                return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Find last needle from "hay" (see sl_needle_find()).
+ *
+ * @param nd   Needle.
+ * @param hay  Haystack.
+ * @param hlen Haystack length (search end).
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_needle_find_rev( sl_needle_t nd, const char* hay, size_t hlen )
+{
+    if ( nd->len == 0 || nd->len > hlen )
+        return SIZE_MAX;
+    if ( nd->icase )
+        return sl_search_filter_rev( nd, hay, hlen, 1 );
+    if ( nd->len == 1 )
+        return sl_scan_char_rev( hay, hlen, nd->str[ 0 ] );
+    return sl_search_filter_rev( nd, hay, hlen, 0 );
+}
+
+
+/**
+ * Build multi-pattern search tables: byte classes, Aho-Corasick
+ * automaton and fingerprints for small pattern set.
+ *
+ * @param mp Multi-pattern search (with patterns).
+ */
+static void sl_multi_build( sl_multi_t mp )
+{
+    size_t    total = 1;
+    size_t    states = 1;
+    size_t    min = SIZE_MAX;
+    size_t    ncls;
+    uint32_t* fail;
+    uint32_t* queue;
+    size_t    head, tail;
+
+    /* Byte classes: class 0 for bytes not in patterns. */
+    memset( mp->cls, 0, sizeof( mp->cls ) );
+    ncls = 1;
+    for ( size_t i = 0; i < mp->cnt; i++ ) {
+        for ( size_t j = 0; j < mp->pat[ i ].len; j++ ) {
+            uint8_t c = mp->pat[ i ].str[ j ];
+            if ( mp->cls[ c ] == 0 )
+                mp->cls[ c ] = ncls++;
+        }
+        total += mp->pat[ i ].len;
+        if ( mp->pat[ i ].len < min )
+            min = mp->pat[ i ].len;
+    }
+    mp->ncls = ncls;
+
+    /* Trie, transition 0 is missing child (root is never a child). */
+    mp->next = (uint32_t*)sl_malloc( total * ncls * sizeof( uint32_t ) );
+    mp->out = (uint32_t*)sl_malloc( total * sizeof( uint32_t ) );
+    mp->depth = (uint32_t*)sl_malloc( total * sizeof( uint32_t ) );
+    memset( mp->next, 0, total * ncls * sizeof( uint32_t ) );
+    mp->out[ 0 ] = SL_MULTI_NONE;
+    mp->depth[ 0 ] = 0;
+
+    for ( size_t i = 0; i < mp->cnt; i++ ) {
+        uint32_t st = 0;
+        for ( size_t j = 0; j < mp->pat[ i ].len; j++ ) {
+            uint32_t* t = &mp->next[ st * ncls + mp->cls[ (uint8_t)mp->pat[ i ].str[ j ] ] ];
+            if ( *t == 0 ) {
+                *t = states;
+                mp->out[ states ] = SL_MULTI_NONE;
+                mp->depth[ states ] = j + 1;
+                states++;
+            }
+            st = *t;
+        }
+        /* First duplicate wins, empty pattern is ignored. */
+        if ( st != 0 && mp->out[ st ] == SL_MULTI_NONE )
+            mp->out[ st ] = i;
+    }
+
+    /*
+     * Resolve failure transitions in breadth-first order. State
+     * output is own pattern or the output of failure state, i.e. the
+     * longest pattern ending at state.
+     */
+    fail = (uint32_t*)sl_malloc( states * sizeof( uint32_t ) );
+    queue = (uint32_t*)sl_malloc( states * sizeof( uint32_t ) );
+    head = tail = 0;
+    fail[ 0 ] = 0;
+    for ( size_t c = 0; c < ncls; c++ ) {
+        uint32_t t = mp->next[ c ];
+        if ( t ) {
+            fail[ t ] = 0;
+            queue[ tail++ ] = t;
+        }
+    }
+    while ( head < tail ) {
+        uint32_t st = queue[ head++ ];
+        for ( size_t c = 0; c < ncls; c++ ) {
+            uint32_t* t = &mp->next[ st * ncls + c ];
+            uint32_t  f = mp->next[ fail[ st ] * ncls + c ];
+            if ( *t ) {
+                fail[ *t ] = f;
+                if ( mp->out[ *t ] == SL_MULTI_NONE )
+                    mp->out[ *t ] = mp->out[ f ];
+                queue[ tail++ ] = *t;
+            } else {
+                *t = f;
+            }
+        }
+    }
+    sl_free( fail );
+    sl_free( queue );
+
+    /* Fingerprints for small set, longest pattern first. */
+    mp->fcnt = 0;
+    mp->flen = ( min >= 2 ) ? 2 : 1;
+#ifdef SL_VEC
+    if ( mp->cnt <= SL_MULTI_SMALL && min > 0 ) {
+        mp->fcnt = mp->cnt;
+        for ( size_t i = 0; i < mp->cnt; i++ ) {
+            size_t j = i;
+            while ( j > 0 && mp->pat[ mp->ford[ j - 1 ] ].len < mp->pat[ i ].len ) {
+                mp->ford[ j ] = mp->ford[ j - 1 ];
+                j--;
+            }
+            mp->ford[ j ] = i;
+            mp->fp[ 0 ][ i ] = mp->pat[ i ].str[ 0 ];
+            mp->fp[ 1 ][ i ] = mp->pat[ i ].str[ mp->flen - 1 ];
+        }
+    }
+#endif
+}
+
+
+/**
+ * Find first (leftmost-longest) pattern match from "hay".
+ *
+ * @param mp   Multi-pattern search.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ * @param id   Matching pattern (output).
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_multi_find( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id )
+{
+    if ( pos >= hlen )
+        return SIZE_MAX;
+    else if ( mp->fcnt )
+        return sl_multi_small( mp, hay, hlen, pos, id );
+    else
+        return sl_multi_scan( mp, hay, hlen, pos, id );
+}
+
+
+/**
+ * Find first pattern match from "hay" with automaton.
+ *
+ * Match ending at current position starts at (pos + 1 - pattern
+ * length). Scan continues after match, as long as current state
+ * (partial match) starts at or before the match, since that can
+ * still give a longer or an earlier match.
+ *
+ * @param mp   Multi-pattern search.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ * @param id   Matching pattern (output).
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_multi_scan( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id )
+{
+    const uint8_t*  h = (const uint8_t*)hay;
+    const uint32_t* next = mp->next;
+    size_t          ncls = mp->ncls;
+    size_t          best = SIZE_MAX;
+    uint32_t        st = 0;
+
+    for ( size_t i = pos; i < hlen; i++ ) {
+        st = next[ st * ncls + mp->cls[ h[ i ] ] ];
+        if ( mp->out[ st ] != SL_MULTI_NONE ) {
+            size_t at = i + 1 - mp->pat[ mp->out[ st ] ].len;
+            if ( at <= best ) {
+                best = at;
+                *id = mp->out[ st ];
+            }
+        }
+        if ( best != SIZE_MAX && i + 1 - mp->depth[ st ] > best )
+            break;
+    }
+
+    return best;
+}
+
+
+/**
+ * Find first pattern match from "hay" with fingerprint filter.
+ *
+ * Candidates are positions where first (and second) byte matches
+ * with any pattern. Candidates are verified in order, hence the
+ * first verified is the leftmost.
+ *
+ * @param mp   Multi-pattern search.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Search start pos.
+ * @param id   Matching pattern (output).
+ *
+ * @return Index (or SIZE_MAX if not found).
+ */
+static size_t sl_multi_small( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id )
+{
+    size_t i = pos;
+
+#ifdef SL_VEC
+    sl_vec_t v0[ SL_MULTI_SMALL ];
+    sl_vec_t v1[ SL_MULTI_SMALL ];
+    size_t   fcnt = mp->fcnt;
+    size_t   f1 = mp->flen - 1;
+    uint64_t m;
+
+    for ( size_t k = 0; k < fcnt; k++ ) {
+        v0[ k ] = sl_vsplat( mp->fp[ 0 ][ k ] );
+        v1[ k ] = sl_vsplat( mp->fp[ 1 ][ k ] );
+    }
+
+    if ( hlen - pos >= SL_VEC + f1 ) {
+        while ( i + f1 < hlen ) {
+            size_t skip = 0;
+            if ( i + SL_VEC + f1 > hlen ) {
+                /* Last vector overlaps with the previous. */
+                skip = i - ( hlen - SL_VEC - f1 );
+                i -= skip;
+            }
+            sl_vec_t h0 = sl_vload( hay + i );
+            sl_vec_t h1 = sl_vload( hay + i + f1 );
+            sl_vec_t acc = sl_vand( sl_veq( h0, v0[ 0 ] ), sl_veq( h1, v1[ 0 ] ) );
+            for ( size_t k = 1; k < fcnt; k++ )
+                acc = sl_vor( acc, sl_vand( sl_veq( h0, v0[ k ] ), sl_veq( h1, v1[ k ] ) ) );
+            m = sl_vmask( acc ) & ( ~(uint64_t)0 << ( skip * SL_VBITS ) );
+            while ( m ) {
+                size_t at = i + __builtin_ctzll( m ) / SL_VBITS;
+                if ( sl_multi_verify( mp, hay, hlen, at, id ) )
+                    return at;
+                m &= ~( ( ( (uint64_t)1 << SL_VBITS ) - 1 ) << ( ( at - i ) * SL_VBITS ) );
+            }
+            i += SL_VEC;
+        }
+        return SIZE_MAX;
+    }
+#endif
+
+    for ( ; i < hlen; i++ ) {
+        if ( sl_multi_verify( mp, hay, hlen, i, id ) )
+            return i;
+    }
+
+    return SIZE_MAX;
+}
+
+
+/**
+ * Verify fingerprint candidate, longest pattern first.
+ *
+ * @param mp   Multi-pattern search.
+ * @param hay  Haystack.
+ * @param hlen Haystack length.
+ * @param pos  Candidate pos.
+ * @param id   Matching pattern (output).
+ *
+ * @return 1 if pattern matches (else 0).
+ */
+static int sl_multi_verify( sl_multi_t mp, const char* hay, size_t hlen, size_t pos, uint32_t* id )
+{
+    for ( size_t k = 0; k < mp->fcnt; k++ ) {
+        sr_s* p = &mp->pat[ mp->ford[ k ] ];
+        if ( p->str[ 0 ] == hay[ pos ] && p->len <= hlen - pos
+             && !memcmp( hay + pos, p->str, p->len ) ) {
+            *id = mp->ford[ k ];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find all (non-overlapping) pattern matches.
+ *
+ * @param mp    Multi-pattern search.
+ * @param sr    Haystack.
+ * @param match Storage for matches (or NULL).
+ * @param size  Size of match.
+ *
+ * @return Number of matches.
+ */
+static sl_size_t sl_multi_all( sl_multi_t mp, sr_s sr, sl_match_s* match, sl_size_t size )
+{
+    sl_size_t cnt = 0;
+    size_t    pos = 0;
+    size_t    idx;
+    uint32_t  id;
+
+    while ( ( idx = sl_multi_find( mp, sr.str, sr.len, pos, &id ) ) != SIZE_MAX ) {
+        if ( cnt < size ) {
+            match[ cnt ].sr = sr_new( sr.str + idx, mp->pat[ id ].len );
+            match[ cnt ].id = id;
+        }
+        cnt++;
+        pos = idx + mp->pat[ id ].len;
+    }
+
+    return cnt;
+}
+
+
+/** Add byte to glob byte set. */
+#define sl_glob_add(set,c) ((set)[(uint8_t)(c) >> 6] |= (uint64_t)1 << ((uint8_t)(c) & 63))
+
+/** Is byte in glob byte set? */
+#define sl_glob_has(set,c) (((set)[(uint8_t)(c) >> 6] >> ((uint8_t)(c) & 63)) & 1)
+
+
+/**
+ * Parse glob pattern to tokens. Token is a set of bytes it consumes,
+ * and flags for self loop (star) and optional directories ("**" and
+ * "/"). Token count is at most pattern length.
+ *
+ * "*", "?" and "[...]" do not match "/". "**" as a full path
+ * component matches also "/". "**" followed by "/" matches zero or
+ * more directories, and it has three tokens: entry (consumes nothing),
+ * star and "/". Entry leads to each of the following three tokens, and
+ * skipping is possible only on entry. Consecutive "**" and "/"
+ * components are merged.
+ *
+ * @param pat  Pattern.
+ * @param len  Pattern length.
+ * @param set  Token byte sets (output).
+ * @param flag Token flags (output).
+ *
+ * @return Token count.
+ */
+static size_t sl_glob_parse( const char* pat, size_t len, uint64_t ( *set )[ 4 ], uint8_t* flag )
+{
+    size_t n = 0;
+    size_t i = 0;
+    size_t j;
+
+    while ( i < len ) {
+        uint64_t* ts = set[ n ];
+        uint8_t   c = pat[ i ];
+
+        memset( ts, 0, 4 * sizeof( uint64_t ) );
+        flag[ n ] = 0;
+
+        if ( c == '*' ) {
+            int comp;
+
+            for ( j = i; j < len && pat[ j ] == '*'; j++ )
+                ;
+            comp = ( j - i >= 2 && ( i == 0 || pat[ i - 1 ] == '/' ) && ( j == len || pat[ j ] == '/' ) );
+            if ( comp && j < len ) {
+                if ( n >= 3 && ( flag[ n - 3 ] & SL_GLOB_OPT ) ) {
+                    /* Same as the previous "**" and "/". */
+                    i = j + 1;
+                    continue;
+                }
+                /* Entry, star and "/". */
+                flag[ n++ ] = SL_GLOB_OPT;
+                memset( set[ n ], 0xff, 4 * sizeof( uint64_t ) );
+                flag[ n++ ] = SL_GLOB_STAR;
+                memset( set[ n ], 0, 4 * sizeof( uint64_t ) );
+                sl_glob_add( set[ n ], '/' );
+                flag[ n ] = 0;
+                i = j + 1;
+            } else {
+                memset( ts, 0xff, 4 * sizeof( uint64_t ) );
+                flag[ n ] = SL_GLOB_STAR;
+                if ( !comp )
+                    ts[ '/' >> 6 ] &= ~( (uint64_t)1 << ( '/' & 63 ) );
+                i = j;
+            }
+        } else if ( c == '?' ) {
+            memset( ts, 0xff, 4 * sizeof( uint64_t ) );
+            ts[ '/' >> 6 ] &= ~( (uint64_t)1 << ( '/' & 63 ) );
+            i++;
+        } else if ( c == '[' && ( j = sl_glob_class( pat, len, i, ts ) ) ) {
+            i = j;
+        } else {
+            if ( c == '\\' && i + 1 < len )
+                c = pat[ ++i ];
+            sl_glob_add( ts, c );
+            i++;
+        }
+        n++;
+    }
+
+    return n;
+}
+
+
+/**
+ * Parse glob bracket expression to byte set. Expression may be
+ * negated with "!" or "^", and it may include ranges (a-z) and
+ * escaped bytes. "]" as the first byte is literal.
+ *
+ * @param pat Pattern.
+ * @param len Pattern length.
+ * @param i   Position of "[".
+ * @param set Byte set (output, cleared).
+ *
+ * @return Position after "]" (or 0 if expression is not terminated).
+ */
+static size_t sl_glob_class( const char* pat, size_t len, size_t i, uint64_t* set )
+{
+    size_t j = i + 1;
+    size_t first;
+    int    neg = 0;
+
+    if ( j < len && ( pat[ j ] == '!' || pat[ j ] == '^' ) ) {
+        neg = 1;
+        j++;
+    }
+
+    first = j;
+    while ( j < len && ( pat[ j ] != ']' || j == first ) ) {
+        uint8_t lo, hi;
+
+        if ( pat[ j ] == '\\' && j + 1 < len )
+            j++;
+        lo = hi = pat[ j++ ];
+        if ( j + 1 < len && pat[ j ] == '-' && pat[ j + 1 ] != ']' ) {
+            j++;
+            if ( pat[ j ] == '\\' && j + 1 < len )
+                j++;
+            hi = pat[ j++ ];
+        }
+        for ( unsigned b = lo; b <= hi; b++ )
+            sl_glob_add( set, b );
+    }
+
+    if ( j >= len ) {
+        memset( set, 0, 4 * sizeof( uint64_t ) );
+        return 0;
+    }
+
+    if ( neg ) {
+        for ( int k = 0; k < 4; k++ )
+            set[ k ] = ~set[ k ];
+    }
+    set[ '/' >> 6 ] &= ~( (uint64_t)1 << ( '/' & 63 ) );
+
+    return j + 1;
+}
+
+
+/**
+ * Build glob NFA: parse patterns, split bytes to classes with the
+ * same token sets, and set up position masks.
+ *
+ * @param gp   Glob (with pattern count).
+ * @param pats Patterns.
+ */
+static void sl_glob_build( sl_glob_t gp, const sr_s* pats )
+{
+    size_t    total = 0;
+    size_t    tokens = 0;
+    size_t    bits = 0;
+    size_t    words;
+    uint64_t( *set )[ 4 ];
+    uint8_t*  flag;
+    size_t*   cnt;
+    uint16_t  remap[ 512 ];
+    uint8_t   rep[ 256 ];
+    size_t    ncls;
+
+    for ( size_t i = 0; i < gp->cnt; i++ )
+        total += pats[ i ].len;
+
+    /* Tokens of all patterns, consecutively. */
+    set = (uint64_t( * )[ 4 ])sl_malloc( ( total + 1 ) * sizeof( *set ) );
+    flag = (uint8_t*)sl_malloc( total + 1 );
+    cnt = (size_t*)sl_malloc( ( gp->cnt + 1 ) * sizeof( size_t ) );
+    for ( size_t i = 0; i < gp->cnt; i++ ) {
+        cnt[ i ] = sl_glob_parse( pats[ i ].str, pats[ i ].len, set + tokens, flag + tokens );
+        tokens += cnt[ i ];
+        bits += cnt[ i ] + 1;
+    }
+
+    /* Byte classes: refine partition with each token set. */
+    memset( gp->cls, 0, sizeof( gp->cls ) );
+    ncls = 1;
+    for ( size_t t = 0; t < tokens; t++ ) {
+        size_t nn = 0;
+        memset( remap, 0xff, 2 * ncls * sizeof( uint16_t ) );
+        for ( int c = 0; c < 256; c++ ) {
+            uint16_t* r = &remap[ 2 * gp->cls[ c ] + sl_glob_has( set[ t ], c ) ];
+            if ( *r == UINT16_MAX )
+                *r = nn++;
+            gp->cls[ c ] = *r;
+        }
+        ncls = nn;
+    }
+    gp->ncls = ncls;
+    for ( int c = 255; c >= 0; c-- )
+        rep[ gp->cls[ c ] ] = c;
+
+    words = bits / 64 + 1;
+    gp->words = words;
+    gp->mask = (uint64_t*)sl_malloc( ncls * words * sizeof( uint64_t ) );
+    gp->star = (uint64_t*)sl_malloc( 4 * words * sizeof( uint64_t ) );
+    gp->opt = gp->star + words;
+    gp->init = gp->opt + words;
+    gp->acc = gp->init + words;
+    gp->pid = (uint32_t*)sl_malloc( bits * sizeof( uint32_t ) + 1 );
+    memset( gp->mask, 0, ncls * words * sizeof( uint64_t ) );
+    memset( gp->star, 0, 4 * words * sizeof( uint64_t ) );
+
+    /* Positions, pattern accept bit after its tokens. */
+    tokens = 0;
+    bits = 0;
+    for ( size_t i = 0; i < gp->cnt; i++ ) {
+        gp->init[ bits >> 6 ] |= (uint64_t)1 << ( bits & 63 );
+        for ( size_t j = 0; j <= cnt[ i ]; j++ ) {
+            size_t   b = bits + j;
+            uint64_t bit = (uint64_t)1 << ( b & 63 );
+            gp->pid[ b ] = i;
+            if ( j == cnt[ i ] ) {
+                gp->acc[ b >> 6 ] |= bit;
+                break;
+            }
+            if ( flag[ tokens + j ] & SL_GLOB_STAR )
+                gp->star[ b >> 6 ] |= bit;
+            if ( flag[ tokens + j ] & SL_GLOB_OPT )
+                gp->opt[ b >> 6 ] |= bit;
+            for ( size_t k = 0; k < ncls; k++ ) {
+                if ( sl_glob_has( set[ tokens + j ], rep[ k ] ) )
+                    gp->mask[ k * words + ( b >> 6 ) ] |= bit;
+            }
+        }
+        tokens += cnt[ i ];
+        bits += cnt[ i ] + 1;
+    }
+    sl_glob_close( gp, gp->init );
+
+    sl_free( set );
+    sl_free( flag );
+    sl_free( cnt );
+
+    gp->dfa = NULL;
+    gp->dacc = NULL;
+    if ( words == 1 )
+        sl_glob_dfa( gp );
+}
+
+
+/**
+ * Convert single word NFA to DFA (subset construction). DFA is not
+ * created, if it would have more than SL_GLOB_DFA states.
+ *
+ * @param gp Glob (with NFA).
+ */
+static void sl_glob_dfa( sl_glob_t gp )
+{
+    size_t    ncls = gp->ncls;
+    uint64_t  state[ SL_GLOB_DFA ];
+    uint32_t* dfa;
+    uint32_t* dacc;
+    size_t    cnt = 2;
+    uint64_t  s, t;
+    size_t    n;
+
+    dfa = (uint32_t*)sl_malloc( SL_GLOB_DFA * ncls * sizeof( uint32_t ) );
+    dacc = (uint32_t*)sl_malloc( SL_GLOB_DFA * sizeof( uint32_t ) );
+    state[ 0 ] = 0;
+    state[ 1 ] = gp->init[ 0 ];
+
+    /* States are numbered in creation order, i.e. breadth-first. */
+    for ( size_t q = 0; q < cnt; q++ ) {
+        t = state[ q ] & gp->acc[ 0 ];
+        dacc[ q ] = t ? gp->pid[ __builtin_ctzll( t ) ] : SL_MULTI_NONE;
+        for ( size_t k = 0; k < ncls; k++ ) {
+            t = state[ q ] & gp->mask[ k ];
+            s = ( t << 1 ) | ( t & gp->star[ 0 ] );
+            sl_glob_close( gp, &s );
+            for ( n = 0; n < cnt && state[ n ] != s; n++ )
+                ;
+            if ( n == cnt ) {
+                if ( cnt == SL_GLOB_DFA ) {
+                    sl_free( dfa );
+                    sl_free( dacc );
+                    return;
+                }
+                state[ cnt++ ] = s;
+            }
+            dfa[ q * ncls + k ] = n * ncls;
+        }
+    }
+
+    gp->dfa = dfa;
+    gp->dacc = dacc;
+}
+
+
+/**
+ * Add positions reachable without consuming bytes: from optional
+ * directory entry to the next three positions, and then over stars.
+ * Parser merges consecutive stars and optional directories, hence one
+ * step of each is enough.
+ *
+ * @param gp Glob.
+ * @param st State (updated).
+ *
+ * @return Non-zero if state has any positions.
+ */
+static uint64_t sl_glob_close( sl_glob_t gp, uint64_t* st )
+{
+    uint64_t carry = 0;
+    uint64_t any = 0;
+    uint64_t t;
+
+    for ( size_t w = 0; w < gp->words; w++ ) {
+        t = st[ w ] & gp->opt[ w ];
+        st[ w ] |= ( t << 1 ) | ( t << 2 ) | ( t << 3 ) | carry;
+        carry = ( t >> 63 ) | ( t >> 62 ) | ( t >> 61 );
+    }
+
+    carry = 0;
+    for ( size_t w = 0; w < gp->words; w++ ) {
+        t = st[ w ] & gp->star[ w ];
+        st[ w ] |= ( t << 1 ) | carry;
+        carry = t >> 63;
+        any |= st[ w ];
+    }
+
+    return any;
+}
+
+
+/**
+ * Match string against glob patterns. DFA takes one transition per
+ * byte. Otherwise each byte advances all active NFA positions at once
+ * (shift-and), and single state word is kept in a register. Match is
+ * linear in string length and never backtracks.
+ *
+ * @param gp  Glob.
+ * @param str String.
+ * @param len String length.
+ *
+ * @return Index of first matching pattern (or SIZE_MAX if none).
+ */
+static size_t sl_glob_run( sl_glob_t gp, const char* str, size_t len )
+{
+    const uint8_t* p = (const uint8_t*)str;
+    size_t         words = gp->words;
+    size_t         id = SIZE_MAX;
+    uint64_t       buf[ SL_GLOB_STACK ];
+    uint64_t*      st;
+    uint64_t       t;
+
+    if ( gp->dfa ) {
+        uint32_t off = gp->ncls;
+
+        for ( size_t i = 0; i < len && off; i++ )
+            off = gp->dfa[ off + gp->cls[ p[ i ] ] ];
+
+        id = gp->dacc[ off / gp->ncls ];
+        return ( id == SL_MULTI_NONE ) ? SIZE_MAX : id;
+    }
+
+    if ( words == 1 ) {
+        uint64_t s0 = gp->init[ 0 ];
+        uint64_t star = gp->star[ 0 ];
+        uint64_t opt = gp->opt[ 0 ];
+
+        for ( size_t i = 0; i < len && s0; i++ ) {
+            t = s0 & gp->mask[ gp->cls[ p[ i ] ] ];
+            s0 = ( t << 1 ) | ( t & star );
+            t = s0 & opt;
+            s0 |= ( t << 1 ) | ( t << 2 ) | ( t << 3 );
+            s0 |= ( s0 & star ) << 1;
+        }
+
+        s0 &= gp->acc[ 0 ];
+        return s0 ? gp->pid[ __builtin_ctzll( s0 ) ] : SIZE_MAX;
+    }
+
+    st = ( words <= SL_GLOB_STACK ) ? buf : (uint64_t*)sl_malloc( words * sizeof( uint64_t ) );
+    memcpy( st, gp->init, words * sizeof( uint64_t ) );
+
+    for ( size_t i = 0; i < len; i++ ) {
+        const uint64_t* m = gp->mask + gp->cls[ p[ i ] ] * words;
+        uint64_t        carry = 0;
+
+        for ( size_t w = 0; w < words; w++ ) {
+            t = st[ w ] & m[ w ];
+            st[ w ] = ( t << 1 ) | carry | ( t & gp->star[ w ] );
+            carry = t >> 63;
+        }
+        if ( !sl_glob_close( gp, st ) )
+            break;
+    }
+
+    for ( size_t w = 0; w < words; w++ ) {
+        t = st[ w ] & gp->acc[ w ];
+        if ( t ) {
+            id = gp->pid[ w * 64 + __builtin_ctzll( t ) ];
+            break;
+        }
+    }
+
+    if ( st != buf )
+        sl_free( st );
+
+    return id;
+}
+
+
+/**
+ * Copy "src" to "dst" and return pointer to end of "dst".
+ *
+ * @param dst Destination str.
+ * @param src Source str.
+ *
+ * @return Pointer to dst end.
+ */
+static char* sl_copy_setup( char* dst, const char* src )
+{
+    size_t i = 0;
+    while ( src[ i ] ) {
+        dst[ i ] = src[ i ];
+        i++;
+    }
+    return &( dst[ i ] );
+}
+
+
+/**
+ * Return file size or (-1 on error).
+ *
+ * @param filename Name of file.
+ *
+ * @return File size.
+ */
+static off_t sl_file_size( const char* filename )
+{
+    struct stat st;
+
+    if ( stat( filename, &st ) == 0 )
+        return st.st_size;
+
+    return -1; // GCOV_EXCL_LINE
+}
+
+
+/**
+ * Read "size" bytes from file, also when size exceeds the single read
+ * limit.
+ *
+ * @param fd   File descriptor.
+ * @param buf  Read buffer.
+ * @param size Read size.
+ *
+ * @return 0 on success (else -1).
+ */
+static int sl_read_fd( int fd, char* buf, size_t size )
+{
+    ssize_t ret;
+
+    while ( size > 0 ) {
+        ret = read( fd, buf, size );
+        if ( ret <= 0 )
+            return -1; // GCOV_EXCL_LINE
+        buf += ret;
+        size -= ret;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Write "size" bytes to file, also when size exceeds the single write
+ * limit.
+ *
+ * @param fd   File descriptor.
+ * @param buf  Write buffer.
+ * @param size Write size.
+ *
+ * @return 0 on success (else -1).
+ */
+static int sl_write_fd( int fd, const char* buf, size_t size )
+{
+    ssize_t ret;
+
+    while ( size > 0 ) {
+        ret = write( fd, buf, size );
+        if ( ret <= 0 )
+            return -1; // GCOV_EXCL_LINE
+        buf += ret;
+        size -= ret;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Normalize (possibly negative) SL index. Positive index is saturated
+ * to SL length, and negative index is normalized.
+ *
+ * -1 means last char in SL, -2 second to last, etc. Index after last
+ * char can only be expressed by positive indeces. E.g. for SL with
+ * length of 4 the indeces are:
+ *
+ * Chars:     a  b  c  d  \0
+ * Positive:  0  1  2  3  4
+ * Negative: -4 -3 -2 -1
+ *
+ * @param ss  SL.
+ * @param idx Index to SL.
+ *
+ * @return Unsigned (positive) index to SL.
+ */
+static sl_size_t sl_norm_idx( sl_t ss, sl_pos_t idx )
+{
+    sl_size_t ret;
+
+    if ( idx < 0 ) {
+        ret = sl_len( ss ) + idx;
+    } else if ( (sl_size_t)idx > sl_len( ss ) ) {
+        ret = sl_len( ss );
+    } else {
+        ret = idx;
+    }
+
+    return ret;
+}
+
+
+/** wyhash secret. */
+static const uint64_t sl_hash_secret[ 4 ] = { 0xa0761d6478bd642fULL,
+                                              0xe7037ed1a0b428dbULL,
+                                              0x8ebc6af09c88c6e3ULL,
+                                              0x589965cc75374cc3ULL };
+
+
+/**
+ * Multiply 64-bit values to 128-bit result.
+ *
+ * @param a Value (low result).
+ * @param b Value (high result).
+ */
+static inline void sl_hash_mum( uint64_t* a, uint64_t* b )
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)( r >> 64 );
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + ( rm0 << 32 ), c = t < rl, lo, hi;
+    lo = t + ( rm1 << 32 );
+    c += lo < t;
+    hi = rh + ( rm0 >> 32 ) + ( rm1 >> 32 ) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+
+/**
+ * Multiply and fold 64-bit values.
+ */
+static inline uint64_t sl_hash_mix( uint64_t a, uint64_t b )
+{
+    sl_hash_mum( &a, &b );
+    return a ^ b;
+}
+
+
+/** Read 8 bytes. */
+static inline uint64_t sl_hash_r8( const uint8_t* p )
+{
+    uint64_t v;
+    memcpy( &v, p, 8 );
+    return v;
+}
+
+
+/** Read 4 bytes. */
+static inline uint64_t sl_hash_r4( const uint8_t* p )
+{
+    uint32_t v;
+    memcpy( &v, p, 4 );
+    return v;
+}
+
+
+/**
+ * Fold 8 bytes to ASCII lowercase (SWAR).
+ */
+static inline uint64_t sl_hash_fold( uint64_t v )
+{
+    uint64_t h = v & 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t ge_a = h + 0x3f3f3f3f3f3f3f3fULL;
+    uint64_t gt_z = h + 0x2525252525252525ULL;
+
+    return v | ( ( ( ge_a ^ gt_z ) & ~v & 0x8080808080808080ULL ) >> 2 );
+}
+
+
+/** Read 8 bytes, folded if "icase". */
+#define sl_hash_f8(p,icase) ((icase) ? sl_hash_fold(sl_hash_r8(p)) : sl_hash_r8(p))
+
+/** Read 4 bytes, folded if "icase". */
+#define sl_hash_f4(p,icase) ((icase) ? sl_hash_fold(sl_hash_r4(p)) : sl_hash_r4(p))
+
+/** Read byte, folded if "icase". */
+#define sl_hash_f1(c,icase) ((uint64_t)((icase) ? sl_lower(c) : (c)))
+
+
+/**
+ * Calculate 64-bit hash of string (wyhash).
+ *
+ * Hash is not stable across platforms with different byte order.
+ *
+ * With "icase", bytes are folded to ASCII lowercase on read. Core is
+ * inlined to hash functions, hence "icase" is a constant.
+ *
+ * @param cs    String.
+ * @param len   String length.
+ * @param icase ASCII case-insensitive.
+ *
+ * @return Hash.
+ */
+static inline __attribute__( ( always_inline ) ) uint64_t sl_hash_core( const char* cs, sl_size_t len, int icase )
+{
+    const uint64_t* sec = sl_hash_secret;
+    const uint8_t*  p = (const uint8_t*)cs;
+    uint64_t        seed = sec[ 0 ];
+    uint64_t        a, b;
+
+    seed ^= sl_hash_mix( seed ^ sec[ 0 ], sec[ 1 ] );
+
+    if ( len <= 16 ) {
+        if ( len >= 4 ) {
+            a = ( sl_hash_f4( p, icase ) << 32 ) | sl_hash_f4( p + ( ( len >> 3 ) << 2 ), icase );
+            b = ( sl_hash_f4( p + len - 4, icase ) << 32 )
+                | sl_hash_f4( p + len - 4 - ( ( len >> 3 ) << 2 ), icase );
+        } else if ( len > 0 ) {
+            a = ( sl_hash_f1( p[ 0 ], icase ) << 16 ) | ( sl_hash_f1( p[ len >> 1 ], icase ) << 8 )
+                | sl_hash_f1( p[ len - 1 ], icase );
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        sl_size_t i = len;
+        if ( i > 48 ) {
+            /* Three independent lanes. */
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = sl_hash_mix( sl_hash_f8( p, icase ) ^ sec[ 1 ], sl_hash_f8( p + 8, icase ) ^ seed );
+                see1 = sl_hash_mix( sl_hash_f8( p + 16, icase ) ^ sec[ 2 ], sl_hash_f8( p + 24, icase ) ^ see1 );
+                see2 = sl_hash_mix( sl_hash_f8( p + 32, icase ) ^ sec[ 3 ], sl_hash_f8( p + 40, icase ) ^ see2 );
+                p += 48;
+                i -= 48;
+            } while ( i > 48 );
+            seed ^= see1 ^ see2;
+        }
+        while ( i > 16 ) {
+            seed = sl_hash_mix( sl_hash_f8( p, icase ) ^ sec[ 1 ], sl_hash_f8( p + 8, icase ) ^ seed );
+            i -= 16;
+            p += 16;
+        }
+        a = sl_hash_f8( p + i - 16, icase );
+        b = sl_hash_f8( p + i - 8, icase );
+    }
+
+    a ^= sec[ 1 ];
+    b ^= seed;
+    sl_hash_mum( &a, &b );
+
+    return sl_hash_mix( a ^ sec[ 0 ] ^ len, b ^ sec[ 1 ] );
+}
+
+
+/**
+ * Calculate 64-bit hash of string (see sl_hash_core()).
+ *
+ * @param cs  String.
+ * @param len String length.
+ *
+ * @return Hash.
+ */
+static uint64_t sl_hash_base( const char* cs, sl_size_t len )
+{
+    return sl_hash_core( cs, len, 0 );
+}
+
+
+/**
+ * Calculate 64-bit hash of string, ASCII case-insensitive (see
+ * sl_hash_core()).
+ *
+ * @param cs  String.
+ * @param len String length.
+ *
+ * @return Hash.
+ */
+static uint64_t sl_hash_icase_base( const char* cs, sl_size_t len )
+{
+    return sl_hash_core( cs, len, 1 );
+}
+
+
+/**
+ * Create empty heap Slinky with extended descriptor.
+ *
+ * @param size  Storage size (even).
+ * @param flags Extension flags.
+ *
+ * @return Slinky (with one reference).
+ */
+static sl_t sl_new_ext( sl_size_t size, uint32_t flags )
+{
+    sl_x_p x;
+    sl_t   s;
+    int    c = sl_class( size );
+
+    sl_stat_alloc( size );
+    x = (sl_x_p)sl_blk_alloc( sizeof( sl_x_s ) + sl_malsize( c, sl_vsize( size ) ), sizeof( sl_x_s ) + sl_dsize( c ) );
+    size = sl_harvest( x, sizeof( sl_x_s ) + sl_dsize( c ), size, c );
+    sl_stat_add( res_live, size );
+    x->res = size;
+    x->ref = 1;
+    x->flags = flags;
+    s = sl_setup( x + 1, c, 0, 0 );
+    s[ 0 ] = 0;
+
+    return s;
+}
+
+
+/**
+ * Resize heap allocated Slinky storage. Content is moved to a new
+ * block, if descriptor class changes.
+ *
+ * @param ss   Slinky.
+ * @param size New storage size.
+ *
+ * @return Slinky.
+ */
+static sl_t sl_resize( sl_t ss, sl_size_t size )
+{
+    sl_size_t res = sl_res( ss );
+    sl_size_t len = sl_len( ss );
+    size_t    xs = sl_ext( ss ) ? sizeof( sl_x_s ) : 0;
+    int       c = sl_class( size );
+    char*     blk;
+    sl_t      s;
+
+    if ( c == sl_cls( ss ) ) {
+        blk = sl_blk_realloc( sl_block( ss ), sl_blksize( ss ), xs + sl_malsize( c, sl_vsize( size ) ), xs + sl_dsize( c ) );
+    } else {
+        blk = sl_blk_alloc( xs + sl_malsize( c, sl_vsize( size ) ), xs + sl_dsize( c ) );
+        memcpy( blk, sl_block( ss ), xs );
+        memcpy( blk + xs + sl_dsize( c ), ss, len + 1 );
+        sl_blk_free( sl_block( ss ), sl_blksize( ss ) );
+    }
+
+    size = sl_harvest( blk, xs + sl_dsize( c ), size, c );
+    if ( xs ) {
+        ( (sl_x_p)blk )->res = size;
+        s = sl_setup( blk + xs, c, 0, len );
+    } else {
+        s = sl_setup( blk, c, size, len );
+    }
+
+    sl_stat_add( reallocs, 1 );
+    sl_stat_add( res_live, (int64_t)size - (int64_t)res );
+
+    return s;
+}
+
+
+/**
+ * Allocate block for many Slinky strings.
+ *
+ * Block has a header (count and block size), the NULL terminated
+ * Slinky array and Slinky strings.
+ *
+ * @param cnt  Number of Slinky strings.
+ * @param size Size of Slinky strings.
+ *
+ * @return Slinky array.
+ */
+static sl_v sl_many_alloc( sl_size_t cnt, size_t size )
+{
+    size_t* head;
+    size_t  arr = sl_many_align( ( cnt + 1 ) * sizeof( sl_t ) );
+    sl_v    sa;
+
+    sl_stat_alloc( 2 * sizeof( size_t ) + arr + size );
+    head = (size_t*)sl_mem_alloc( 2 * sizeof( size_t ) + arr + size );
+    head[ 0 ] = cnt;
+    head[ 1 ] = 2 * sizeof( size_t ) + arr + size;
+    sa = (sl_v)&head[ 2 ];
+    sa[ cnt ] = NULL;
+
+    return sa;
+}
+
+
+/**
+ * Setup local Slinky to block of many Slinky strings, and advance
+ * block position past it. Content is aligned to SLINKY_ALIGN, see
+ * sl_many_size().
+ *
+ * @param mem Block position.
+ * @param cls Descriptor class.
+ * @param res Storage size.
+ * @param len Length.
+ *
+ * @return Slinky.
+ */
+static sl_t sl_many_setup( char** mem, int cls, sl_size_t res, sl_size_t len )
+{
+    char* p = *mem + sl_apad( *mem, sl_dsize( cls ) );
+
+    *mem = p + sl_many_align( sl_dsize( cls ) + sl_vsize( res ) );
+    return sl_setup( p, cls, res | 0x1, len );
+}
+
+
+/**
+ * Add extended descriptor to Slinky, unless it exists.
+ *
+ * Local Slinky is copied to heap with extended descriptor.
+ *
+ * @param sp    Pointer to Slinky.
+ * @param flags Extension flags to add.
+ *
+ * @return Extended descriptor.
+ */
+static sl_x_p sl_extend( sl_p sp, uint32_t flags )
+{
+    sl_x_p    x;
+    sl_size_t res;
+    int       c;
+
+    if ( sl_ext( *sp ) ) {
+        x = sl_xptr( *sp );
+    } else {
+        res = sl_res( *sp );
+        c = sl_cls( *sp );
+        if ( sl_get_local( *sp ) ) {
+            sl_t sn;
+            sn = sl_new_ext( res, flags );
+            sl_set_len( sn, sl_len( *sp ) );
+            memcpy( sn, *sp, sl_len1( *sp ) );
+            *sp = sn;
+            return sl_xptr( sn );
+        } else {
+            sl_size_t len = sl_len( *sp );
+            sl_stat_add( reallocs, 1 );
+            x = (sl_x_p)sl_blk_realloc( sl_base( *sp ), sl_blksize( *sp ), sizeof( sl_x_s ) + sl_malsize( c, sl_vsize( res ) ),
+                                        sizeof( sl_x_s ) + sl_dsize( c ) );
+            memmove( x + 1, x, sl_malsize( c, len + 1 ) );
+            *sp = sl_setup( x + 1, c, 0, len );
+        }
+        x->res = res;
+        x->ref = 1;
+        x->flags = 0;
+    }
+
+    /* Flags of shared Slinky are updated only if needed, since other
+       threads may read them. */
+    if ( ( x->flags & flags ) != flags )
+        x->flags |= flags;
+
+    return x;
+}
+
+
+/**
+ * Add reference to extended Slinky.
+ *
+ * @param x Extended descriptor.
+ */
+static void sl_x_retain( sl_x_p x )
+{
+    if ( x->flags & SL_X_ATOMIC )
+        __atomic_add_fetch( &x->ref, 1, __ATOMIC_RELAXED );
+    else
+        x->ref++;
+}
+
+
+/**
+ * Remove reference from extended Slinky.
+ *
+ * @param x Extended descriptor.
+ *
+ * @return Remaining references.
+ */
+static uint32_t sl_x_release( sl_x_p x )
+{
+    if ( x->flags & SL_X_ATOMIC )
+        return __atomic_sub_fetch( &x->ref, 1, __ATOMIC_ACQ_REL );
+    else
+        return --x->ref;
+}
+
+
+/**
+ * Return reference count of extended Slinky.
+ *
+ * @param x Extended descriptor.
+ *
+ * @return References.
+ */
+static uint32_t sl_x_count( sl_x_p x )
+{
+    if ( x->flags & SL_X_ATOMIC )
+        return __atomic_load_n( &x->ref, __ATOMIC_ACQUIRE );
+    else
+        return x->ref;
+}
+
+
+/**
+ * Check if Slinky storage may be modified in place, i.e. it is not
+ * shared with other references nor interned. Cached hash of mutable
+ * Slinky is invalidated, since the content is about to change.
+ *
+ * @param ss Slinky.
+ *
+ * @return 1 if mutable, else 0.
+ */
+static int sl_mutable( sl_t ss )
+{
+    if ( sl_ext( ss ) ) {
+        sl_x_p x = sl_xptr( ss );
+        if ( sl_x_count( x ) > 1 || ( x->flags & SL_X_INTERN ) )
+            return 0;
+        x->flags &= ~SL_X_HASH;
+    }
+
+    return 1;
+}
+
+
+/**
+ * Report misuse that can't be recovered from, and abort. Checked also
+ * in release builds, since continuing would corrupt other Slinkies.
+ *
+ * @param msg Message.
+ */
+static void sl_fatal( const char* msg )
+{
+    fprintf( stderr, "slinky: %s\n", msg );
+    abort();
+}
+
+
+/**
+ * Return bitmask of control bytes in group matching "c".
+ *
+ * @param ctrl Group control bytes.
+ * @param c    Control byte.
+ *
+ * @return Bitmask.
+ */
+static inline uint32_t sl_hmap_match( const int8_t* ctrl, int8_t c )
+{
+#ifdef __SSE2__
+    __m128i g = _mm_loadu_si128( (const __m128i*)ctrl );
+    return (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( g, _mm_set1_epi8( c ) ) );
+#else
+    uint32_t m = 0;
+    for ( int i = 0; i < SL_HMAP_GROUP; i++ ) {
+        if ( ctrl[ i ] == c )
+            m |= 1u << i;
+    }
+    return m;
+#endif
+}
+
 
-                    case 'u':
-                    case 'U': {
-                        if ( *c == 'u' ) {
-                            u64 = va_arg( coap, unsigned int );
-                        } else {
-                            u64 = va_arg( coap, uint64_t );
-                        }
-                        wp = sl_u64_to_str( u64, wp );
-                        break;
-                    }
+/**
+ * Return bitmask of free (empty or deleted) slots in group.
+ *
+ * @param ctrl Group control bytes.
+ *
+ * @return Bitmask.
+ */
+static inline uint32_t sl_hmap_match_free( const int8_t* ctrl )
+{
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8( _mm_loadu_si128( (const __m128i*)ctrl ) );
+#else
+    uint32_t m = 0;
+    for ( int i = 0; i < SL_HMAP_GROUP; i++ ) {
+        if ( ctrl[ i ] < 0 )
+            m |= 1u << i;
+    }
+    return m;
+#endif
+}
 
-                    case 'c': {
-                        char ch;
-                        ch = (char)va_arg( coap, int );
-                        *wp++ = ch;
-                        break;
-                    }
 
-                    case 'p': {
-                        int pos;
-                        i64 = va_arg( coap, int );
-                        pos = wp - first;
-                        if ( i64 > pos ) {
-                            for ( sl_size_t i = pos; i < i64; i++ ) {
-                                *wp++ = ' ';
-                            }
-                        }
-                        break;
-                    }
+/**
+ * Find slot of key.
+ *
+ * Groups are probed triangularly, starting from the group selected by
+ * hash. Slot candidates are selected by 7 bits of hash in control
+ * bytes, and probing stops at group with empty slot.
+ *
+ * @param map  Map.
+ * @param key  Key string.
+ * @param len  Key length.
+ * @param hash Key hash.
+ *
+ * @return Slot index (or SIZE_MAX if not found).
+ */
+static size_t sl_hmap_lookup( sl_hmap_t map, const char* key, sl_size_t len, uint64_t hash )
+{
+    size_t mask = map->cap / SL_HMAP_GROUP - 1;
+    size_t grp = ( hash >> 7 ) & mask;
+    int8_t h2 = hash & 0x7f;
+
+    for ( size_t i = 1;; i++ ) {
+        const int8_t* ctrl = &map->ctrl[ grp * SL_HMAP_GROUP ];
+        uint32_t      m = sl_hmap_match( ctrl, h2 );
+        while ( m ) {
+            size_t idx = grp * SL_HMAP_GROUP + __builtin_ctz( m );
+            sl_t   k = map->slot[ idx ].key;
+            if ( sl_len( k ) == len && !memcmp( k, key, len ) )
+                return idx;
+            m &= m - 1;
+        }
+        if ( sl_hmap_match( ctrl, SL_HMAP_EMPTY ) )
+            return SIZE_MAX;
+        grp = ( grp + i ) & mask;
+    }
+}
 
-                    case 'r': {
-                        sr = va_arg( coap, sr_s );
-                        memcpy( wp, sr.str, sr.len );
-                        wp += sr.len;
-                        break;
-                    }
 
-                    case 'a': {
-                        char      left_pad;
-                        char      pad_char;
-                        sl_size_t width;
-                        sl_size_t nominal_size;
-                        int       gap;
-                        char*     first;
+/**
+ * Reserve slot for new key (not in map).
+ *
+ * @param map  Map.
+ * @param hash Key hash.
+ *
+ * @return Slot index.
+ */
+static size_t sl_hmap_insert( sl_hmap_t map, uint64_t hash )
+{
+    size_t   mask;
+    size_t   grp;
+    size_t   idx;
+    uint32_t m;
+
+    if ( map->left == 0 ) {
+        /* Grow, unless deleted slots are enough. */
+        if ( map->count + 1 > map->cap / 16 * 7 )
+            sl_hmap_rehash( map, map->cap * 2 );
+        else
+            sl_hmap_rehash( map, map->cap );
+    }
 
-                        // %al012i
+    mask = map->cap / SL_HMAP_GROUP - 1;
+    grp = ( hash >> 7 ) & mask;
+    for ( size_t i = 1;; i++ ) {
+        m = sl_hmap_match_free( &map->ctrl[ grp * SL_HMAP_GROUP ] );
+        if ( m )
+            break;
+        grp = ( grp + i ) & mask;
+    }
 
-                        c++;
-                        if ( *c == 'l' ) {
-                            left_pad = 1;
-                        } else {
-                            left_pad = 0;
-                        }
-                        c++;
-                        pad_char = *c;
-                        c++;
+    idx = grp * SL_HMAP_GROUP + __builtin_ctz( m );
+    if ( map->ctrl[ idx ] == SL_HMAP_EMPTY )
+        map->left--;
+    map->ctrl[ idx ] = hash & 0x7f;
+    map->count++;
 
-                        width = sl_str_to_number( &c );
+    return idx;
+}
 
-                        first = wp;
-                        sl_va_format_quick_append( &wp, *c, coap );
-                        nominal_size = ( wp - first );
 
-                        gap = ( width - nominal_size );
+/**
+ * Re-insert all entries to new slots.
+ *
+ * @param map Map.
+ * @param cap New slot count.
+ */
+static void sl_hmap_rehash( sl_hmap_t map, size_t cap )
+{
+    int8_t*         ctrl = map->ctrl;
+    sl_hmap_slot_s* slot = map->slot;
+    size_t          old = map->cap;
 
-                        if ( left_pad && gap ) {
-                            memmove( first + gap, first, gap );
-                            for ( int i = 0; i < gap; i++ ) {
-                                *first = pad_char;
-                                first++;
-                            }
-                            wp += gap;
-                        }
+    sl_hmap_alloc( map, cap );
+    map->count = 0;
 
-                        if ( !left_pad && gap ) {
-                            for ( int i = 0; i < gap; i++ ) {
-                                *wp = pad_char;
-                                wp++;
-                            }
-                        }
-                        break;
-                    }
+    for ( size_t i = 0; i < old; i++ ) {
+        if ( ctrl[ i ] >= 0 ) {
+            size_t idx = sl_hmap_insert( map, sl_hash( slot[ i ].key ) );
+            map->slot[ idx ] = slot[ i ];
+        }
+    }
 
-                    case '%': {
-                        *wp++ = '%';
-                        break;
-                    }
+    sl_free( ctrl );
+    sl_free( slot );
+}
 
-                    default: {
-                        *wp++ = *c;
-                        break;
-                    }
-                }
 
-                c++;
-                break;
-            }
+/**
+ * Allocate empty slots for map.
+ *
+ * @param map Map.
+ * @param cap Slot count.
+ */
+static void sl_hmap_alloc( sl_hmap_t map, size_t cap )
+{
+    map->ctrl = (int8_t*)sl_malloc( cap );
+    memset( map->ctrl, SL_HMAP_EMPTY, cap );
+    map->slot = (sl_hmap_slot_s*)sl_malloc( cap * sizeof( sl_hmap_slot_s ) );
+    map->cap = cap;
+    map->left = cap / 8 * 7;
+}
 
-            default: {
-                *wp++ = *c++;
-                break;
-            }
+
+/**
+ * Allocate memory from arena.
+ *
+ * Continue to next chunk if current chunk does not have enough
+ * room. Allocate new chunk if none of the remaining chunks fit.
+ *
+ * Allocation is padded so that the bytes after "head" (content) are
+ * aligned to SLINKY_ALIGN.
+ *
+ * @param arena Arena.
+ * @param size  Allocation size.
+ * @param head  Allocation size before content (descriptor).
+ *
+ * @return Allocation.
+ */
+static void* sl_arena_alloc( sl_arena_t arena, size_t size, size_t head )
+{
+    sl_arena_chunk_p chunk;
+    size_t           pad;
+
+    /* Keep allocations aligned. */
+    size = ( size + 7 ) & ~( (size_t)7 );
+
+    while ( arena->used + ( pad = sl_apad( &arena->cur->mem[ arena->used ], head ) ) + size > arena->cur->size ) {
+        if ( arena->cur->next == NULL ) {
+            size_t csize = ( size + SL_BLK_PAD > arena->size ) ? size + SL_BLK_PAD : arena->size;
+            chunk = (sl_arena_chunk_p)sl_malloc( sizeof( sl_arena_chunk_s ) + csize );
+            chunk->next = NULL;
+            chunk->size = csize;
+            arena->cur->next = chunk;
         }
+        arena->cur = arena->cur->next;
+        arena->used = 0;
     }
-    va_end( coap );
 
-    sl_len( *sp ) += ( wp - first );
+    arena->last = &arena->cur->mem[ arena->used + pad ];
+    arena->used += pad + size;
 
-    *wp = 0;
+    return arena->last;
+}
 
-    return *sp;
+
+/**
+ * Extend the last arena allocation in place.
+ *
+ * @param arena Arena.
+ * @param ptr   Allocation.
+ * @param size  New allocation size.
+ *
+ * @return 1 if extended (else 0).
+ */
+static int sl_arena_extend( sl_arena_t arena, void* ptr, size_t size )
+{
+    size_t used;
+
+    if ( ptr != arena->last )
+        return 0;
+
+    size = ( size + 7 ) & ~( (size_t)7 );
+    used = ( arena->last - arena->cur->mem ) + size;
+    if ( used > arena->cur->size )
+        return 0;
+
+    arena->used = used;
+
+    return 1;
 }
 
 
-int sl_invert_pos( sl_t ss, int pos )
+/**
+ * Allocate memory for Slinky.
+ *
+ * @param size Allocation size.
+ *
+ * @return Allocation.
+ */
+static void* sl_mem_alloc( size_t size )
 {
-    if ( pos > 0 )
-        return -1 * ( sl_len( ss ) - pos );
-    else
-        return sl_len( ss ) + pos;
+#ifdef SLINKY_USE_MMAP
+    if ( size >= SLINKY_MMAP_MIN )
+        return sl_map_alloc( size );
+#endif
+
+#if defined( SLINKY_USE_POOL )
+    sl_pool_blk_p b;
+    uint32_t      cls;
+
+    cls = sl_pool_class( size );
+    if ( cls < SL_POOL_CLASSES ) {
+        sl_pool_p pool = sl_pool_get();
+        if ( pool->free[ cls ] == NULL )
+            sl_pool_drain( pool );
+        b = pool->free[ cls ];
+        if ( b ) {
+            pool->free[ cls ] = sl_pool_next( b );
+            return b + 1;
+        }
+        b = (sl_pool_blk_p)sl_malloc( sizeof( sl_pool_blk_s ) + sl_pool_size( cls ) );
+        b->owner = pool;
+        atomic_fetch_add( &pool->live, 1 );
+    } else {
+        b = (sl_pool_blk_p)sl_malloc( sizeof( sl_pool_blk_s ) + size );
+        b->owner = NULL;
+    }
+    b->cls = cls;
+    return b + 1;
+#elif defined( SLINKY_USE_MEMTUN )
+    mt_t        mt = sl_get_memtun();
+    sl_mt_blk_p b = (sl_mt_blk_p)mt_alloc( mt, sizeof( sl_mt_blk_s ) + size );
+    b->mt = mt;
+    return b + 1;
+#else
+    return sl_malloc( size );
+#endif
 }
 
 
-int sl_find_char_right( sl_t ss, char c, sl_size_t pos )
+/**
+ * Re-allocate memory for Slinky.
+ *
+ * @param ptr  Current allocation.
+ * @param old  Current allocation size.
+ * @param size New allocation size.
+ *
+ * @return Allocation.
+ */
+static void* sl_mem_realloc( void* ptr, size_t old, size_t size )
 {
-    while ( pos < sl_len( ss ) && ss[ pos ] != c )
-        pos++;
+#ifdef SLINKY_USE_MMAP
+    if ( old >= SLINKY_MMAP_MIN || size >= SLINKY_MMAP_MIN ) {
+        void* ret;
+        if ( old >= SLINKY_MMAP_MIN && size >= SLINKY_MMAP_MIN )
+            return sl_map_realloc( ptr, old, size );
+        /* Move between mapped and backend memory. */
+        ret = sl_mem_alloc( size );
+        memcpy( ret, ptr, ( old < size ) ? old : size );
+        sl_mem_free( ptr, old );
+        return ret;
+    }
+#else
+    (void)old;
+#endif
 
-    if ( pos == sl_len( ss ) )
-        return -1;
-    else
-        return pos;
+#if defined( SLINKY_USE_POOL )
+    sl_pool_blk_p b;
+    uint32_t      cls;
+    size_t        copy;
+    void*         ret;
+
+    b = (sl_pool_blk_p)ptr - 1;
+    cls = sl_pool_class( size );
+
+    if ( b->cls < SL_POOL_CLASSES ) {
+        /* Block has room for new size. */
+        if ( cls == b->cls )
+            return ptr;
+        copy = sl_pool_size( b->cls );
+        if ( copy > size )
+            copy = size;
+    } else if ( cls >= SL_POOL_CLASSES ) {
+        /* Large to large. */
+        b = (sl_pool_blk_p)sl_realloc( b, sizeof( sl_pool_blk_s ) + size );
+        return b + 1;
+    } else {
+        /* Large to size class, i.e. shrink. */
+        copy = size;
+    }
+
+    ret = sl_mem_alloc( size );
+    memcpy( ret, ptr, copy );
+    sl_mem_free( ptr, old );
+    return ret;
+#elif defined( SLINKY_USE_MEMTUN )
+    sl_mt_blk_p b = (sl_mt_blk_p)ptr - 1;
+    if ( b->mt != sl_get_memtun() ) {
+        /* Move to current allocator. */
+        void* ret = sl_mem_alloc( size );
+        memcpy( ret, ptr, ( old < size ) ? old : size );
+        sl_mem_free( ptr, old );
+        return ret;
+    }
+    b = (sl_mt_blk_p)mt_realloc( b->mt, b, sizeof( sl_mt_blk_s ) + size );
+    return b + 1;
+#else
+    return sl_realloc( ptr, size );
+#endif
+}
+
+
+/**
+ * Free Slinky memory.
+ *
+ * @param ptr  Allocation.
+ * @param size Allocation size.
+ */
+static void sl_mem_free( void* ptr, size_t size )
+{
+#ifdef SLINKY_USE_MMAP
+    if ( size >= SLINKY_MMAP_MIN ) {
+        sl_map_free( ptr, size );
+        return;
+    }
+#else
+    (void)size;
+#endif
+
+#if defined( SLINKY_USE_POOL )
+    sl_pool_blk_p b;
+    sl_pool_p     owner;
+
+    b = (sl_pool_blk_p)ptr - 1;
+    owner = b->owner;
+
+    if ( b->cls >= SL_POOL_CLASSES ) {
+        sl_free( b );
+    } else if ( owner == sl_pool_local ) {
+        sl_pool_next( b ) = owner->free[ b->cls ];
+        owner->free[ b->cls ] = b;
+    } else if ( atomic_load( &owner->orphan ) ) {
+        sl_free( b );
+        sl_pool_unref( owner );
+    } else {
+        sl_pool_blk_p head;
+        /* Keep pool alive over push, since block may be released by
+           others. */
+        atomic_fetch_add( &owner->live, 1 );
+        head = atomic_load( &owner->remote );
+        do {
+            sl_pool_next( b ) = head;
+        } while ( !atomic_compare_exchange_weak( &owner->remote, &head, b ) );
+
+        /* Owner might have exited during push. */
+        if ( atomic_load( &owner->orphan ) )
+            sl_pool_release( owner );
+        sl_pool_unref( owner );
+    }
+#elif defined( SLINKY_USE_MEMTUN )
+    sl_mt_blk_p b = (sl_mt_blk_p)ptr - 1;
+    mt_free( b->mt, b );
+#else
+    sl_free( ptr );
+#endif
 }
 
 
-int sl_find_char_left( sl_t ss, char c, sl_size_t pos )
+/**
+ * Return usable size of allocation, which may exceed the requested
+ * size.
+ *
+ * @param ptr  Allocation.
+ * @param size Requested size.
+ *
+ * @return Usable size.
+ */
+static size_t sl_mem_usable( void* ptr, size_t size )
 {
-    while ( pos > 0 && ss[ pos ] != c )
-        pos--;
+#ifdef SLINKY_USE_MMAP
+    if ( size >= SLINKY_MMAP_MIN )
+        return sl_map_size( size );
+    /* Backend allocation must stay below mapping threshold. */
+    size = sl_mem_usable_base( ptr, size );
+    if ( size >= SLINKY_MMAP_MIN )
+        size = SLINKY_MMAP_MIN - 1;
+    return size;
+#else
+    return sl_mem_usable_base( ptr, size );
+#endif
+}
 
-    if ( pos == 0 && ss[ pos ] != c )
-        return -1;
-    else
-        return pos;
+
+/**
+ * Return usable size of backend allocation.
+ *
+ * @param ptr  Allocation.
+ * @param size Requested size.
+ *
+ * @return Usable size.
+ */
+static size_t sl_mem_usable_base( void* ptr, size_t size )
+{
+#if defined( SLINKY_USE_POOL )
+    sl_pool_blk_p b = (sl_pool_blk_p)ptr - 1;
+    if ( b->cls < SL_POOL_CLASSES )
+        return sl_pool_size( b->cls );
+    return size;
+#elif defined( SLINKY_USE_MEMTUN )
+    (void)ptr;
+    return size;
+#elif defined( SLINKY_USE_MEM_API )
+#    ifdef SLINKY_USE_MEM_USABLE
+    (void)size;
+    return sl_usable_size( ptr );
+#    else
+    (void)ptr;
+    return size;
+#    endif
+#elif defined( __GLIBC__ ) && !( SIXTEN_USE_MEM_API == 1 )
+    (void)size;
+    return malloc_usable_size( ptr );
+#else
+    (void)ptr;
+    return size;
+#endif
 }
 
 
-int sl_find_index( sl_t s1, const char* s2 )
+/**
+ * Return storage size for allocation, i.e. harvest allocator slack if
+ * enabled.
+ *
+ * @param ptr  Allocation.
+ * @param head Allocation size before storage (descriptors).
+ * @param size Requested storage size.
+ * @param cls  Descriptor class.
+ *
+ * @return Storage size (even).
+ */
+static sl_size_t sl_harvest( void* ptr, size_t head, sl_size_t size, int cls )
 {
-    if ( s2[ 0 ] == 0 )
-        return -1;
+    size_t usable;
+
+    if ( !slinky_harvest )
+        return size;
+
+    usable = sl_blk_usable( ptr, head + sl_vsize( size ) ) - head;
+    if ( usable > SL_STORAGE_MAX )
+        usable = SL_STORAGE_MAX;
+    /* Storage must fit to descriptor class. */
+    if ( usable > SL_CLASS_MAX( cls ) )
+        usable = SL_CLASS_MAX( cls );
+#ifdef SLINKY_ALIGN
+    usable &= ~(size_t)( SLINKY_ALIGN - 1 );
+#else
+    usable &= ~(size_t)1;
+#endif
+    if ( usable < size )
+        return size;
+
+    return usable;
+}
+
+
+#ifdef SLINKY_ALIGN
+
+/**
+ * Return block offset in allocation, so that content (after
+ * descriptor) is aligned. Offset is at least one, since it is stored
+ * to the byte before block.
+ *
+ * @param raw  Allocation (SLINKY_ALIGN bytes larger than block).
+ * @param head Block size before content (descriptors).
+ *
+ * @return Block offset.
+ */
+static size_t sl_blk_offset( char* raw, size_t head )
+{
+    uintptr_t pos;
+
+    pos = (uintptr_t)raw + 1 + head + SLINKY_ALIGN - 1;
+    pos &= ~(uintptr_t)( SLINKY_ALIGN - 1 );
+
+    return pos - head - (uintptr_t)raw;
+}
+
+
+/**
+ * Return allocation of block.
+ *
+ * @param blk Block.
+ *
+ * @return Allocation.
+ */
+static char* sl_blk_raw( void* blk )
+{
+    return (char*)blk - 1 - ( (uint8_t*)blk )[ -1 ];
+}
 
-    int i1 = 0;
-    int i2 = 0;
-    int i;
+#endif
 
-    while ( s1[ i1 ] ) {
-        i = i1;
-        if ( s1[ i ] == s2[ i2 ] ) {
-            while ( s1[ i ] == s2[ i2 ] && s2[ i2 ] ) {
-                i++;
-                i2++;
-            }
-            if ( s2[ i2 ] == 0 )
-                return i1;
-        }
-        i1++;
-    }
 
-    return -1;
+/**
+ * Allocate Slinky block.
+ *
+ * @param size Block size.
+ * @param head Block size before content (descriptors).
+ *
+ * @return Block.
+ */
+static void* sl_blk_alloc( size_t size, size_t head )
+{
+#ifdef SLINKY_ALIGN
+    char*  raw = sl_mem_alloc( size + SLINKY_ALIGN );
+    size_t off = sl_blk_offset( raw, head );
+
+    raw[ off - 1 ] = (char)( off - 1 );
+    return raw + off;
+#else
+    (void)head;
+    return sl_mem_alloc( size );
+#endif
 }
 
 
-int sl_divide_with_char( sl_t ss, char c, int size, char*** div )
+/**
+ * Re-allocate Slinky block.
+ *
+ * @param blk  Current block.
+ * @param old  Current block size.
+ * @param size New block size.
+ * @param head New block size before content (descriptors).
+ *
+ * @return Block.
+ */
+static void* sl_blk_realloc( void* blk, size_t old, size_t size, size_t head )
 {
-    if ( size < 0 ) {
-        /* Just count size, don't replace chars. */
-        return sl_divide_base( ss, c, -1, NULL );
-    } else if ( *div ) {
-        /* Use pre-allocated storage. */
-        return sl_divide_base( ss, c, size, *div );
-    } else {
-        /* Calculate size and allocate storage. */
-        size = sl_divide_base( ss, c, -1, NULL );
-#ifdef SLINKY_USE_MEMTUN
-        *div = (char**)mt_alloc( slinky_mt, size * sizeof( char* ) );
+#ifdef SLINKY_ALIGN
+    char*  raw = sl_blk_raw( blk );
+    size_t off = (char*)blk - raw;
+    size_t noff;
+
+    raw = sl_mem_realloc( raw, old + SLINKY_ALIGN, size + SLINKY_ALIGN );
+    noff = sl_blk_offset( raw, head );
+    /* Content alignment may differ after re-allocation. */
+    if ( noff != off )
+        memmove( raw + noff, raw + off, ( old < size ) ? old : size );
+    raw[ noff - 1 ] = (char)( noff - 1 );
+
+    return raw + noff;
 #else
-        *div = (char**)sl_malloc( size * sizeof( char* ) );
+    (void)head;
+    return sl_mem_realloc( blk, old, size );
 #endif
-        return sl_divide_base( ss, c, size, *div );
-    }
 }
 
 
-int sl_segment_with_str( sl_t ss, const char* sc, int size, char*** div )
+/**
+ * Free Slinky block.
+ *
+ * @param blk  Block.
+ * @param size Block size.
+ */
+static void sl_blk_free( void* blk, size_t size )
 {
-    if ( size < 0 ) {
-        /* Just count size, don't replace chars. */
-        return sl_segment_base( ss, sc, -1, NULL );
-    } else if ( *div ) {
-        /* Use pre-allocated storage. */
-        return sl_segment_base( ss, sc, size, *div );
-    } else {
-        /* Calculate size and allocate storage. */
-        size = sl_segment_base( ss, sc, -1, NULL );
-#ifdef SLINKY_USE_MEMTUN
-        *div = (char**)mt_alloc( slinky_mt, size * sizeof( char* ) );
+#ifdef SLINKY_ALIGN
+    sl_mem_free( sl_blk_raw( blk ), size + SLINKY_ALIGN );
 #else
-        *div = (char**)sl_malloc( size * sizeof( char* ) );
+    sl_mem_free( blk, size );
 #endif
-        return sl_segment_base( ss, sc, size, *div );
-    }
 }
 
 
-sl_t sl_glue_array( sl_v sa, sl_size_t size, const char* glu )
+/**
+ * Return usable size of Slinky block.
+ *
+ * @param blk  Block.
+ * @param size Block size.
+ *
+ * @return Usable size.
+ */
+static size_t sl_blk_usable( void* blk, size_t size )
 {
-    int       len = 0;
-    sl_size_t i;
+#ifdef SLINKY_ALIGN
+    /* Full pad is excluded, since block size is derived from storage
+       size (and pad is added to it). */
+    return sl_mem_usable( sl_blk_raw( blk ), size + SLINKY_ALIGN ) - SLINKY_ALIGN;
+#else
+    return sl_mem_usable( blk, size );
+#endif
+}
 
-    /* Calc sa len. */
-    i = 0;
-    while ( i < size )
-        len += strlen( sa[ i++ ] );
 
-    /* Add glu len. */
-    len += ( size - 1 ) * strlen( glu );
+#ifdef SLINKY_USE_MMAP
 
-    sl_t ss;
-    ss = sl_new( len + 1 );
-    sl_len( ss ) = len;
+/**
+ * Return mapping size for allocation (page multiple).
+ *
+ * @param size Allocation size.
+ *
+ * @return Mapping size.
+ */
+static size_t sl_map_size( size_t size )
+{
+    static size_t page = 0;
 
-    /* Build result. */
-    char* p = ss;
-    i = 0;
-    while ( i < size ) {
-        p = sl_copy_setup( p, sa[ i ] );
-        if ( i < ( size - 1 ) )
-            p = sl_copy_setup( p, glu );
-        i++;
-    }
-    ss[ sl_len( ss ) ] = 0;
+    if ( page == 0 )
+        page = (size_t)sysconf( _SC_PAGESIZE );
 
-    return ss;
+    return ( size + page - 1 ) & ~( page - 1 );
 }
 
 
-char* sl_tokenize( sl_t ss, const char* delim, char** pos )
+/**
+ * Map memory for large Slinky.
+ *
+ * @param size Allocation size.
+ *
+ * @return Allocation.
+ */
+static void* sl_map_alloc( size_t size )
 {
-    if ( *pos == 0 ) {
-        /* First iteration. */
-        int idx;
-        idx = sl_find_index( ss, delim );
-        if ( idx < 0 )
-            return NULL;
-        else {
-            ss[ idx ] = 0;
-            *pos = &( ss[ idx ] );
-            return ss;
-        }
-    } else if ( *pos == sl_end( ss ) ) {
-        /* Passed the last iteration. */
-        return NULL;
-    } else {
-        /* Fix nulled char. */
-        **pos = delim[ 0 ];
-        char* p = *pos;
-        p += strlen( delim );
+    void* ptr;
 
-        if ( *p == 0 ) {
-            /* ss ended with delim, so we are done. */
-            *pos = sl_end( ss );
-            return NULL;
-        }
+    size = sl_map_size( size );
+    ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( ptr == MAP_FAILED )
+        sl_fatal( "mmap failed" );
+#    ifdef MADV_HUGEPAGE
+    madvise( ptr, size, MADV_HUGEPAGE );
+#    endif
 
-        /* Find next delim. */
-        int idx;
-        idx = sl_find_index( p, delim );
-        if ( idx < 0 ) {
-            /* Last token, mark this by: */
-            *pos = sl_end( ss );
-            return p;
-        } else {
-            p[ idx ] = 0;
-            *pos = &( p[ idx ] );
-            return p;
-        }
-    }
+    return ptr;
 }
 
 
-sl_t sl_rm_extension( sl_t ss, const char* ext )
+/**
+ * Resize mapped memory, by remapping pages (no copy) if possible.
+ *
+ * @param ptr  Allocation.
+ * @param old  Allocation size.
+ * @param size New allocation size.
+ *
+ * @return Allocation.
+ */
+static void* sl_map_realloc( void* ptr, size_t old, size_t size )
 {
-    char* pos;
-    char* t;
+    void* ret;
+
+    old = sl_map_size( old );
+    size = sl_map_size( size );
+    if ( old == size )
+        return ptr;
+
+#    ifdef MREMAP_MAYMOVE
+    ret = mremap( ptr, old, size, MREMAP_MAYMOVE );
+    if ( ret == MAP_FAILED )
+        sl_fatal( "mremap failed" );
+#        ifdef MADV_HUGEPAGE
+    if ( size > old )
+        madvise( ret, size, MADV_HUGEPAGE );
+#        endif
+#    else
+    ret = sl_map_alloc( size );
+    memcpy( ret, ptr, ( old < size ) ? old : size );
+    munmap( ptr, old );
+#    endif
 
-    pos = NULL;
-    t = sl_tokenize( ss, ext, &pos );
-    if ( t ) {
-        sl_len( ss ) = pos - ss;
-        return ss;
-    } else
-        return NULL;
+    return ret;
 }
 
 
-sl_t sl_directory_name( sl_t ss )
+/**
+ * Unmap memory of large Slinky.
+ *
+ * @param ptr  Allocation.
+ * @param size Allocation size.
+ */
+static void sl_map_free( void* ptr, size_t size )
 {
-    int i;
-
-    /* Find first "/" from end. */
-    i = sl_len( ss );
-    while ( i > 0 && ss[ i ] != '/' )
-        i--;
+    munmap( ptr, sl_map_size( size ) );
+}
 
-    if ( i == 0 ) {
-        if ( ss[ i ] == '/' ) {
-            ss[ 1 ] = 0;
-            sl_len( ss ) = 1;
-        } else {
-            ss[ 0 ] = '.';
-            ss[ 1 ] = 0;
-            sl_len( ss ) = 1;
-            return ss;
-        }
-    } else {
-        ss[ i ] = 0;
-        sl_len( ss ) = i;
-    }
+#endif
 
-    return ss;
-}
 
+#ifdef SLINKY_USE_POOL
 
-sl_t sl_basename( sl_t ss )
+/**
+ * Return size class for allocation size.
+ *
+ * @param size Allocation size.
+ *
+ * @return Size class (SL_POOL_CLASSES if too big).
+ */
+static uint32_t sl_pool_class( size_t size )
 {
-    int i;
+    uint32_t cls;
 
-    /* Find first "/" from end. */
-    i = sl_len( ss );
-    while ( i > 0 && ss[ i ] != '/' )
-        i--;
+    if ( size <= ( 1 << SL_POOL_MIN_SHIFT ) )
+        return 0;
 
-    if ( i == 0 && ss[ i ] != '/' ) {
-        return ss;
-    } else {
-        i++;
-        sl_len( ss ) = sl_len( ss ) - i;
-        memmove( ss, &( ss[ i ] ), sl_len( ss ) );
-        ss[ sl_len( ss ) ] = 0;
-    }
+    cls = 64 - __builtin_clzll( size - 1 ) - SL_POOL_MIN_SHIFT;
+    if ( cls > SL_POOL_CLASSES )
+        cls = SL_POOL_CLASSES;
 
-    return ss;
+    return cls;
 }
 
 
-sl_t sl_swap_chars( sl_t ss, char f, char t )
+/**
+ * Return allocation size of size class.
+ *
+ * @param cls Size class.
+ *
+ * @return Allocation size.
+ */
+static size_t sl_pool_size( uint32_t cls )
 {
-    sl_size_t i;
-
-    i = 0;
-    while ( i < sl_len( ss ) ) {
-        if ( ss[ i ] == f )
-            ss[ i ] = t;
-        i++;
-    }
-
-    return ss;
+    return (size_t)1 << ( cls + SL_POOL_MIN_SHIFT );
 }
 
 
-sl_t sl_map_str( sl_p sp, const char* f, const char* t )
+/**
+ * Move blocks freed by other threads to free lists.
+ *
+ * @param pool Pool.
+ */
+static void sl_pool_drain( sl_pool_p pool )
 {
-    /*
-     * If "t" is longer than "f", loop and count how many instances of
-     * "f" is found. Increase size of sp by N*t.len - N*f.len.
-     *
-     * Loop and find the next "f" index. Skip upto index and insert "t"
-     * inplace. Continue until "f" is no more found and insert tail of
-     * "sp".
-     */
-
-    sl_size_t f_len = sc_len( f );
-    sl_size_t t_len = sc_len( t );
-
-    int   idx;
-    char *a, *b;
-
-    if ( t_len > f_len ) {
-        /* Calculate number of parts. */
-        sl_size_t cnt = 0;
-
-        /*
-         * Replace XXX with YYYY.
-         *
-         * foooXXXfiiiXXXdiii
-         * foooYYYYfiiiYYYYdiii
-         *
-         * Prepare org before copy as:
-         * --foooXXXfiiiXXXdiii
-         *
-         *   OR
-         *
-         * foooXXXfiiiXXXdiiiXXX
-         * foooYYYYfiiiYYYYdiiiYYYY
-         */
-        a = *sp;
-
-        while ( 1 ) {
-            idx = sl_find_index( a, f );
-            if ( idx >= 0 ) {
-                cnt++;
-                a += ( idx + f_len );
-            } else {
-                break;
-            }
-        }
-
-        sl_size_t nlen;
-        sl_size_t olen = sl_len( *sp );
-        nlen = sl_len( *sp ) - ( cnt * f_len ) + ( cnt * t_len );
-        sl_reserve( sp, nlen + 1 );
-        sl_len( *sp ) = nlen;
+    sl_pool_blk_p b, next;
 
-        /*
-         * Shift original sp content to right in order to enable copying
-         * chars safely from right to left.
-         */
-        b = &( ( *sp )[ nlen - olen ] );
-        memmove( b, *sp, olen + 1 );
-        a = *sp;
-    } else {
-        /*
-         * Replace XXX with YY.
-         *
-         * foooXXXfiiiXXXdiii
-         * foooYYfiiiYYdiii
-         */
-        a = *sp;
-        b = *sp;
-    }
+    if ( atomic_load( &pool->remote ) == NULL )
+        return;
 
-    while ( *b ) {
-        idx = sl_find_index( b, f );
-        if ( idx >= 0 ) {
-            memcpy( a, b, idx );
-            a += idx;
-            a = sl_copy_setup( a, t );
-            b += ( idx + f_len );
-        } else {
-            a = sl_copy_setup( a, b );
-            *a = 0;
-            break;
-        }
+    b = atomic_exchange( &pool->remote, NULL );
+    while ( b ) {
+        next = sl_pool_next( b );
+        sl_pool_next( b ) = pool->free[ b->cls ];
+        pool->free[ b->cls ] = b;
+        b = next;
     }
-
-    if ( *b == 0 )
-        *a = 0;
-
-    return *sp;
 }
 
 
-sl_t sl_map_part( sl_p sp, sl_size_t from_a, sl_size_t from_b, const char* to, sl_size_t to_len )
+/**
+ * Release all free blocks of pool to system.
+ *
+ * Only free lists of the calling thread's own pool may be released,
+ * remote blocks can be released for any pool. Caller must hold a
+ * reference to pool, hence pool is not freed here.
+ *
+ * @param pool Pool.
+ */
+static void sl_pool_release( sl_pool_p pool )
 {
-    int   size_diff;
-    char* start;
-    char* orgtail;
-    char* newtail;
-
-    size_diff = to_len - ( from_b - from_a );
-    if ( size_diff > 0 ) {
-        sl_reserve( sp, sl_len1( *sp ) + size_diff );
+    sl_pool_blk_p b, next;
+    size_t        cnt = 0;
+
+    if ( pool == sl_pool_local ) {
+        sl_pool_drain( pool );
+        for ( int cls = 0; cls < SL_POOL_CLASSES; cls++ ) {
+            b = pool->free[ cls ];
+            while ( b ) {
+                next = sl_pool_next( b );
+                sl_free( b );
+                b = next;
+                cnt++;
+            }
+            pool->free[ cls ] = NULL;
+        }
+    } else {
+        b = atomic_exchange( &pool->remote, NULL );
+        while ( b ) {
+            next = sl_pool_next( b );
+            sl_free( b );
+            b = next;
+            cnt++;
+        }
     }
 
-    start = *sp;
-    orgtail = &start[ from_b ];
-    newtail = &start[ from_a + to_len ];
-
-    memmove( newtail, orgtail, sl_len1( *sp ) - from_b );
-    memcpy( &start[ from_a ], to, to_len );
+    atomic_fetch_sub( &pool->live, cnt );
+}
 
-    sl_len( *sp ) = sl_len( *sp ) + size_diff;
 
-    return *sp;
+/**
+ * Drop reference to pool, and free pool with last reference.
+ *
+ * Each block owned by the pool is a reference, and the owner thread
+ * holds one until exit.
+ *
+ * @param pool Pool.
+ */
+static void sl_pool_unref( sl_pool_p pool )
+{
+    if ( atomic_fetch_sub( &pool->live, 1 ) == 1 )
+        sl_free( pool );
 }
 
 
-sl_t sl_capitalize( sl_t ss )
+/**
+ * Release pool at thread exit.
+ *
+ * Pool is freed, unless other threads still have blocks owned by the
+ * pool. These are returned to system directly, and the last one
+ * frees the pool.
+ *
+ * @param arg Pool.
+ */
+static void sl_pool_exit( void* arg )
 {
-    if ( sl_len( ss ) > 0 )
-        ss[ 0 ] = toupper( ss[ 0 ] );
+    sl_pool_p pool = arg;
 
-    return ss;
+    atomic_store( &pool->orphan, 1 );
+    sl_pool_release( pool );
+    sl_pool_local = NULL;
+    sl_pool_release( pool );
+    sl_pool_unref( pool );
 }
 
 
-sl_t sl_toupper( sl_t ss )
+/**
+ * Create thread exit key for pools.
+ */
+static void sl_pool_init( void )
 {
-    for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
-        ss[ i ] = toupper( ss[ i ] );
-    }
-    return ss;
+    pthread_key_create( &sl_pool_key, sl_pool_exit );
 }
 
 
-sl_t sl_tolower( sl_t ss )
+/**
+ * Return pool of the calling thread, create if missing.
+ *
+ * @return Pool.
+ */
+static sl_pool_p sl_pool_get( void )
 {
-    for ( sl_size_t i = 0; i < sl_len( ss ); i++ ) {
-        ss[ i ] = tolower( ss[ i ] );
+    if ( sl_pool_local == NULL ) {
+        sl_pool_p pool;
+        pthread_once( &sl_pool_once, sl_pool_init );
+        pool = (sl_pool_p)sl_malloc( sizeof( sl_pool_s ) );
+        memset( pool->free, 0, sizeof( pool->free ) );
+        atomic_init( &pool->remote, NULL );
+        atomic_init( &pool->orphan, 0 );
+        atomic_init( &pool->live, 1 );
+        pthread_setspecific( sl_pool_key, pool );
+        sl_pool_local = pool;
     }
-    return ss;
+
+    return sl_pool_local;
 }
 
+#endif
 
-sl_t sl_read_file( const char* filename )
+
+#ifdef SLINKY_USE_TRACE
+
+/**
+ * Record promotion of local Slinky.
+ *
+ * @param ss   Local Slinky.
+ * @param size Needed storage size.
+ */
+static void sl_trace_promotion( sl_t ss, sl_size_t size )
 {
-    sl_t ss;
+    sl_trace_local_s* r = &sl_trace_local[ ( (uintptr_t)ss >> 3 ) & ( SL_TRACE_LOCALS - 1 ) ];
+    const char*       file = "?";
+    int               line = 0;
+    sl_trace_t*       t = NULL;
+
+    if ( r->ss == ss ) {
+        file = r->file;
+        line = r->line;
+        /* Promoted once. */
+        r->ss = NULL;
+    }
 
-    off_t size = sl_file_size( filename );
-    if ( size < 0 )
-        return NULL; // GCOV_EXCL_LINE
+    pthread_mutex_lock( &sl_trace_lock );
 
-    ss = sl_new( size + 1 );
+    for ( int i = 0; i < sl_trace_sites; i++ ) {
+        if ( sl_trace_site[ i ].line == line && !strcmp( sl_trace_site[ i ].file, file ) ) {
+            t = &sl_trace_site[ i ];
+            break;
+        }
+    }
 
-    int fd;
+    if ( t == NULL && sl_trace_sites < SL_TRACE_SITES ) {
+        t = &sl_trace_site[ sl_trace_sites++ ];
+        t->file = file;
+        t->line = line;
+        t->size = 0;
+        t->needed = 0;
+        t->count = 0;
+    }
 
-    fd = open( filename, O_RDONLY );
-    if ( fd == -1 )
-        return NULL; // GCOV_EXCL_LINE
-    read( fd, ss, size );
-    ss[ size ] = 0;
-    sl_len( ss ) = size;
-    close( fd );
+    if ( t ) {
+        t->count++;
+        if ( sl_res( ss ) > t->size )
+            t->size = sl_res( ss );
+        if ( size > t->needed )
+            t->needed = size;
+    }
 
-    return ss;
+    pthread_mutex_unlock( &sl_trace_lock );
 }
 
 
-sl_t sl_read_file_with_pad( const char* filename, sl_size_t left, sl_size_t right )
+/**
+ * Compare callsites by promotion count (descending).
+ */
+static int sl_trace_compare( const void* t1, const void* t2 )
 {
-    sl_t ss;
+    const sl_trace_t* a = (const sl_trace_t*)t1;
+    const sl_trace_t* b = (const sl_trace_t*)t2;
 
-    off_t size = sl_file_size( filename );
-    if ( size < 0 )
-        return NULL; // GCOV_EXCL_LINE
+    if ( a->count != b->count )
+        return ( a->count < b->count ) ? 1 : -1;
+    else if ( a->needed != b->needed )
+        return ( a->needed < b->needed ) ? 1 : -1;
+    else
+        return 0;
+}
 
-    ss = sl_new( size + left + right + 1 );
+#endif
 
-    int fd;
 
-    fd = open( filename, O_RDONLY );
-    if ( fd == -1 )
-        return NULL; // GCOV_EXCL_LINE
-    read( fd, &ss[ left ], size );
-    /* Zero the tail. */
-    memset( &ss[ size + left ], 0, right + 1 );
-    sl_len( ss ) = size + left;
-    close( fd );
+#ifdef SLINKY_USE_STATS
 
-    return ss;
+/**
+ * Release counter block of exiting thread for reuse.
+ *
+ * @param arg Counter block.
+ */
+static void sl_stats_exit( void* arg )
+{
+    sl_stats_blk_p b = (sl_stats_blk_p)arg;
+    atomic_store( &b->used, 0 );
 }
 
 
-sl_t sl_write_file( sl_t ss, const char* filename )
+/**
+ * Create thread exit key for counter blocks.
+ */
+static void sl_stats_init( void )
 {
-    int fd;
-
-    fd = creat( filename, S_IWUSR | S_IRUSR );
-    if ( fd == -1 )
-        return NULL; // GCOV_EXCL_LINE
-    write( fd, ss, sl_len( ss ) );
-    close( fd );
-
-    return ss;
+    pthread_key_create( &sl_stats_key, sl_stats_exit );
 }
 
 
-void sl_print( const char* fmt, ... )
+/**
+ * Return counters of the calling thread.
+ *
+ * @return Counters.
+ */
+static sl_stats_t* sl_stats_get( void )
 {
-    char mem[ 2048 ];
-    sl_t sl;
+    sl_stats_blk_p b;
 
-    sl = sl_use( mem, 2048 );
+    if ( sl_stats_local )
+        return &sl_stats_local->st;
 
-    va_list ap;
+    pthread_once( &sl_stats_once, sl_stats_init );
 
-    va_start( ap, fmt );
-    sl_va_format_quick( &sl, fmt, ap );
-    va_end( ap );
+    /* Reuse block of exited thread. */
+    for ( b = atomic_load( &sl_stats_list ); b; b = b->next ) {
+        int unused = 0;
+        if ( atomic_compare_exchange_strong( &b->used, &unused, 1 ) )
+            break;
+    }
 
-    printf( "%s", sl );
-}
+    if ( b == NULL ) {
+        b = (sl_stats_blk_p)sl_malloc( sizeof( sl_stats_blk_s ) );
+        memset( &b->st, 0, sizeof( sl_stats_t ) );
+        atomic_init( &b->used, 1 );
+        b->next = atomic_load( &sl_stats_list );
+        while ( !atomic_compare_exchange_weak( &sl_stats_list, &b->next, b ) )
+            ;
+    }
 
+    sl_stats_local = b;
+    pthread_setspecific( sl_stats_key, b );
 
-void sl_write( const int fd, const char* fmt, ... )
-{
-    char mem[ 2048 ];
-    sl_t sl;
+    return &b->st;
+}
 
-    sl = sl_use( mem, 2048 );
 
-    va_list ap;
+/**
+ * Return histogram bin of allocation size (log2).
+ *
+ * @param size Allocation size.
+ *
+ * @return Bin index.
+ */
+static int sl_stats_bin( uint64_t size )
+{
+    int bin;
 
-    va_start( ap, fmt );
-    sl_va_format_quick( &sl, fmt, ap );
-    va_end( ap );
+    if ( size < 2 )
+        return 0;
+    bin = 63 - __builtin_clzll( size );
+    if ( bin >= SL_STATS_HIST )
+        bin = SL_STATS_HIST - 1;
 
-    write( fd, sl, sl_length( sl ) );
+    return bin;
 }
 
+#endif
 
-void sl_dump( sl_t ss )
-{
-    printf( "%s\n", ss );
-    printf( "  len: %d\n", sl_len( ss ) );
-    printf( "  res: %d\n", sl_res( ss ) );
-}
 
+#ifdef SLINKY_USE_INTERN
 
-void sl_set_local( sl_t ss, int val )
+/**
+ * Initialize intern table shard locks.
+ */
+static void sl_intern_init( void )
 {
-    sl_base_p s = sl_base( ss );
-    if ( val != 0 )
-        s->res = s->res | 0x1;
-    else
-        s->res = s->res & sl_smsk;
+    for ( int i = 0; i < SL_INTERN_SHARDS; i++ )
+        pthread_mutex_init( &sl_intern_shard[ i ].lock, NULL );
 }
 
 
-int sl_get_local( sl_t ss )
+/**
+ * Rebuild shard slots with given slot count.
+ *
+ * @param sh   Shard (locked).
+ * @param size New slot count (power of two).
+ */
+static void sl_intern_rehash( sl_intern_shard_s* sh, size_t size )
 {
-    return sl_local( ss );
+    sl_intern_slot_s* slot;
+    size_t            mask = size - 1;
+
+    slot = (sl_intern_slot_s*)sl_malloc( size * sizeof( sl_intern_slot_s ) );
+    memset( slot, 0, size * sizeof( sl_intern_slot_s ) );
+
+    for ( size_t i = 0; i < sh->size; i++ ) {
+        if ( sh->slot[ i ].str ) {
+            size_t j = sh->slot[ i ].hash & mask;
+            while ( slot[ j ].str )
+                j = ( j + 1 ) & mask;
+            slot[ j ] = sh->slot[ i ];
+        }
+    }
+
+    if ( sh->slot )
+        sl_free( sh->slot );
+    sh->slot = slot;
+    sh->size = size;
 }
 
 
-sr_s sr_new( const char* str, sl_size_t len )
+/**
+ * Return interned Slinky for string, intern if missing.
+ *
+ * @param cs  String.
+ * @param len String length.
+ *
+ * @return Interned Slinky (new reference).
+ */
+static sl_t sl_intern_base( const char* cs, sl_size_t len )
 {
-    sr_s ret;
-    ret.str = str;
-    ret.len = len;
-    return ret;
-}
+    sl_intern_shard_s* sh;
+    uint64_t           hash;
+    size_t             mask;
+    size_t             i;
+    sl_t               s;
 
+    sl_check( (uint64_t)len + 1 );
 
-sr_s sr_new_c( const char* str )
-{
-    sr_s ret;
-    ret.str = str;
-    ret.len = strlen( str );
-    return ret;
-}
+    pthread_once( &sl_intern_once, sl_intern_init );
 
-const char* sr_text( sr_s sr )
-{
-    return sr.str;
-}
+    hash = sl_hash_base( cs, len );
+    sh = &sl_intern_shard[ hash >> ( 64 - SL_INTERN_SHIFT ) ];
 
-sl_size_t sr_length( sr_s sr )
-{
-    return sr.len;
-}
+    pthread_mutex_lock( &sh->lock );
 
-int sr_compare( sr_s s1, sr_s s2 )
-{
-    if ( s1.len != s2.len ) {
-        return 1;
-    } else {
-        return memcmp( s1.str, s2.str, s1.len );
-    }
-}
+    sh->lookups++;
 
-int sr_compare_full( sr_s s1, sr_s s2 )
-{
-    if ( s1.len != s2.len ) {
-        size_t len;
-        if ( s1.len < s2.len ) {
-            len = s1.len;
-        } else {
-            len = s2.len;
+    /* Keep load below 3/4. */
+    if ( ( sh->count + 1 ) * 4 > sh->size * 3 )
+        sl_intern_rehash( sh, sh->size ? sh->size * 2 : SL_INTERN_MIN );
+
+    mask = sh->size - 1;
+    for ( i = hash & mask; sh->slot[ i ].str; i = ( i + 1 ) & mask ) {
+        s = sh->slot[ i ].str;
+        if ( sh->slot[ i ].hash == hash && sl_len( s ) == len && !memcmp( s, cs, len ) ) {
+            sh->hits++;
+            sl_x_retain( sl_xptr( s ) );
+            pthread_mutex_unlock( &sh->lock );
+            return s;
         }
-        return strncmp( s1.str, s2.str, len );
-    } else {
-        return strncmp( s1.str, s2.str, s1.len );
     }
-}
 
+    s = sl_new_ext( sl_snor( len + 1 ), SL_X_SHARED | SL_X_ATOMIC | SL_X_INTERN | SL_X_HASH );
+    sl_xptr( s )->hash = hash;
+    memcpy( s, cs, len );
+    s[ len ] = 0;
+    sl_set_len( s, len );
 
+    /* Table and caller references. */
+    sl_xptr( s )->ref = 2;
 
+    sh->slot[ i ].hash = hash;
+    sh->slot[ i ].str = s;
+    sh->count++;
+    sh->bytes += sizeof( sl_x_s ) + sl_malsize( sl_cls( s ), sl_res( s ) );
 
-/* ------------------------------------------------------------
- * Utility functions.
- * ------------------------------------------------------------ */
+    pthread_mutex_unlock( &sh->lock );
+
+    return s;
+}
+
+#endif
 
 
 /**
- * Copy "src" to "dst" and return pointer to end of "dst".
+ * Calculate new storage size according to growth policy.
  *
- * @param dst Destination str.
- * @param src Source str.
+ * @param res  Current storage size.
+ * @param size Required storage size.
  *
- * @return Pointer to dst end.
+ * @return New storage size (at least size).
  */
-static char* sl_copy_setup( char* dst, const char* src )
+static sl_size_t sl_growth_size( sl_size_t res, sl_size_t size )
 {
-    int i = 0;
-    while ( src[ i ] ) {
-        dst[ i ] = src[ i ];
-        i++;
-    }
-    return &( dst[ i ] );
+    uint64_t grown;
+
+    sl_check( size );
+
+    grown = __atomic_load_n( &slinky_growth_fn, __ATOMIC_ACQUIRE )( res, size );
+    if ( grown > SL_STORAGE_MAX )
+        grown = SL_STORAGE_MAX;
+    if ( grown < size )
+        grown = size;
+
+    return grown;
 }
 
 
 /**
- * Return file size or (-1 on error).
+ * Exact growth policy, i.e. required storage size.
  *
- * @param filename Name of file.
+ * @param res  Current storage size.
+ * @param size Required storage size.
  *
- * @return File size.
+ * @return New storage size.
  */
-static off_t sl_file_size( const char* filename )
+static sl_size_t sl_growth_exact( sl_size_t res, sl_size_t size )
 {
-    struct stat st;
-
-    if ( stat( filename, &st ) == 0 )
-        return st.st_size;
-
-    return -1; // GCOV_EXCL_LINE
+    (void)res;
+    return size;
 }
 
 
 /**
- * Normalize (possibly negative) SL index. Positive index is saturated
- * to SL length, and negative index is normalized.
- *
- * -1 means last char in SL, -2 second to last, etc. Index after last
- * char can only be expressed by positive indeces. E.g. for SL with
- * length of 4 the indeces are:
- *
- * Chars:     a  b  c  d  \0
- * Positive:  0  1  2  3  4
- * Negative: -4 -3 -2 -1
+ * Geometric growth policy, see sl_set_growth().
  *
- * @param ss  SL.
- * @param idx Index to SL.
+ * @param res  Current storage size.
+ * @param size Required storage size.
  *
- * @return Unsigned (positive) index to SL.
+ * @return New storage size (may be below size).
  */
-static sl_size_t sl_norm_idx( sl_t ss, int idx )
+static sl_size_t sl_growth_geometric( sl_size_t res, sl_size_t size )
 {
-    sl_size_t ret;
-
-    if ( idx < 0 ) {
-        ret = sl_len( ss ) + idx;
-    } else if ( (sl_size_t)idx > sl_len( ss ) ) {
-        ret = sl_len( ss );
-    } else {
-        ret = idx;
-    }
-
-    return ret;
+    (void)size;
+    if ( res > SL_STORAGE_MAX / 2 )
+        return SL_STORAGE_MAX;
+    if ( res < SLINKY_GROWTH_LIMIT )
+        res *= 2;
+    else
+        res += res / 2;
+    if ( res < SLINKY_GROWTH_MIN )
+        res = SLINKY_GROWTH_MIN;
+    return res;
 }
 
 
@@ -1664,7 +6888,7 @@ static sl_t sl_copy_base( sl_p s1, const char* s2, sl_size_t len1 )
 {
     sl_reserve( s1, len1 );
     memcpy( *s1, s2, len1 );
-    sl_len( *s1 ) = len1 - 1;
+    sl_set_len( *s1, len1 - 1 );
     return *s1;
 }
 
@@ -1694,9 +6918,17 @@ static int sl_compare_base( const void* s1, const void* s2 )
  */
 static sl_t sl_concatenate_base( sl_p s1, const char* s2, sl_size_t len1 )
 {
-    sl_reserve( s1, sl_len( *s1 ) + len1 );
-    memcpy( sl_end( *s1 ), s2, len1 );
-    sl_len( *s1 ) += len1 - 1;
+    if ( s2 >= *s1 && s2 <= sl_end( *s1 ) ) {
+        /* Self concatenation, s2 must follow s1 if storage moves. */
+        sl_size_t off = s2 - *s1;
+        sl_grow( s1, sl_len( *s1 ) + len1 );
+        s2 = *s1 + off;
+        memmove( sl_end( *s1 ), s2, len1 );
+    } else {
+        sl_grow( s1, sl_len( *s1 ) + len1 );
+        memcpy( sl_end( *s1 ), s2, len1 );
+    }
+    sl_add_len( *s1, len1 - 1 );
     return *s1;
 }
 
@@ -1711,10 +6943,10 @@ static sl_t sl_concatenate_base( sl_p s1, const char* s2, sl_size_t len1 )
  *
  * @return SL.
  */
-static sl_t sl_insert_base( sl_p s1, int pos, const char* s2, sl_size_t len1 )
+static sl_t sl_insert_base( sl_p s1, sl_pos_t pos, const char* s2, sl_size_t len1 )
 {
     sl_size_t len = sl_len( *s1 ) + len1;
-    sl_reserve( s1, len );
+    sl_grow( s1, len );
 
     len1--;
 
@@ -1730,11 +6962,10 @@ static sl_t sl_insert_base( sl_p s1, int pos, const char* s2, sl_size_t len1 )
 
     memmove( ( *s1 ) + tail, ( *s1 ) + posn, ( sl_len( *s1 ) - posn ) );
     memcpy( ( *s1 ) + posn, s2, len1 );
-    sl_len( *s1 ) += len1;
+    sl_add_len( *s1, len1 );
 
     /* Terminate change SL. */
-    sl_base_p s = sl_base( *s1 );
-    s->str[ s->len ] = 0;
+    ( *s1 )[ sl_len( *s1 ) ] = 0;
 
 
     return *s1;
@@ -1754,10 +6985,10 @@ static sl_t sl_insert_base( sl_p s1, int pos, const char* s2, sl_size_t len1 )
  *
  * @return Number of segments.
  */
-static int sl_divide_base( sl_t ss, char c, int size, char** div )
+static sl_pos_t sl_divide_base( sl_t ss, char c, sl_pos_t size, char** div )
 {
-    int   divcnt = 0;
-    char *a, *b;
+    sl_pos_t divcnt = 0;
+    char *   a, *b;
 
     a = ss;
     b = ss;
@@ -1768,8 +6999,7 @@ static int sl_divide_base( sl_t ss, char c, int size, char** div )
                 *b = 0;
             if ( divcnt < size ) {
                 div[ divcnt ] = a;
-                b += 1;
-                a = b;
+                a = b + 1;
             }
             divcnt++;
         }
@@ -1784,31 +7014,31 @@ static int sl_divide_base( sl_t ss, char c, int size, char** div )
 
 
 /**
- * Segment SL by replacing "sc" with 0. Count the number of segments
+ * Segment SL by replacing needle with 0. Count the number of segments
  * and assign "div" to point to start of each segment.
  *
  * If size is less than 0, count only the number of segments.
  *
  * @param ss   SL.
- * @param c    Division char.
+ * @param nd   Division needle.
  * @param size Segment limit (size of div).
  * @param div  Storage for segments.
  *
  * @return Number of segments.
  */
-static int sl_segment_base( sl_t ss, const char* sc, int size, char** div )
+static sl_pos_t sl_segment_base( sl_t ss, sl_needle_t nd, sl_pos_t size, char** div )
 {
-    int   divcnt = 0;
-    int   idx;
-    int   len = strlen( sc );
-    char *a, *b;
+    sl_pos_t  divcnt = 0;
+    size_t    idx;
+    sl_size_t len = nd->len;
+    char *    a, *b;
 
     a = ss;
     b = ss;
 
     while ( *a ) {
-        idx = sl_find_index( a, sc );
-        if ( idx >= 0 ) {
+        idx = sl_needle_find( nd, a, sl_end( ss ) - a, 0 );
+        if ( idx != SIZE_MAX ) {
             b = a + idx;
             if ( size >= 0 )
                 *b = 0;
@@ -2159,7 +7389,7 @@ static sl_size_t sl_va_format_quick_size( const char* fmt, va_list ap )
 
                     case 'p': {
                         i64 = va_arg( ap, int );
-                        if ( i64 > size )
+                        if ( i64 > (int64_t)size )
                             size = i64;
                         break;
                     }
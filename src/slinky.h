@@ -18,8 +18,48 @@
 
 #ifdef SLINKY_USE_MEMTUN
 #include <memtun.h>
+/*
+ * sl_set_memtun() sets the global allocator. Each thread may push
+ * own allocator contexts, which override the global one for the
+ * calling thread. sl_get_memtun() returns the current allocator of
+ * the calling thread. Blocks remember their allocator, hence Slinky
+ * may be deleted in any context. Re-allocation moves the block to the
+ * current allocator. Context stack is 16 deep, and overflow or
+ * underflow aborts the program.
+ */
 void sl_set_memtun( mt_t mt );
 mt_t sl_get_memtun( void );
+void sl_push_memtun( mt_t mt );
+mt_t sl_pop_memtun( void );
+#endif
+
+#ifdef SLINKY_USE_POOL
+/*
+ * SLINKY_USE_POOL enables per-thread size class pools for Slinky
+ * allocations. sl_pool_trim() releases the free blocks of the calling
+ * thread to the system.
+ */
+void sl_pool_trim( void );
+#endif
+
+/*
+ * SLINKY_USE_MMAP maps allocations of SLINKY_MMAP_MIN (default 1 MiB)
+ * or more directly from the kernel. Growth of large strings uses
+ * mremap (no copy), transparent huge pages are requested, and the
+ * memory is unmapped on sl_del. Descriptor layout is unchanged.
+ */
+/*
+ * SLINKY_ALIGN (e.g. 32 or 64) aligns the content of heap allocated
+ * Slinky (also batch and arena) to SLINKY_ALIGN bytes, and pads the
+ * allocation to a multiple of SLINKY_ALIGN after storage. Vector
+ * kernels may then load whole aligned vectors up to the storage size
+ * rounded up to SLINKY_ALIGN. Descriptor is then 8 bytes at least.
+ */
+
+#ifdef SLINKY_USE_MMAP
+#    ifndef SLINKY_MMAP_MIN
+#        define SLINKY_MMAP_MIN ( 1024 * 1024 )
+#    endif
 #endif
 
 /** Slinky library version. */
@@ -30,16 +70,61 @@ extern const char* slinky_version;
  * Type definitions:
  * ------------------------------------------------------------ */
 
+/*
+ * Descriptor (header) of Slinky has storage size and length fields.
+ * The field width is selected per allocation from the storage size,
+ * i.e. descriptor class:
+ *
+ *     Class  Field    Descriptor  Max storage
+ *     ----------------------------------------
+ *       0    1 byte    2 bytes    62
+ *       1    2 bytes   4 bytes    16382
+ *       2    4 bytes   8 bytes    2^30-2
+ *       3    8 bytes  16 bytes    SL_STORAGE_MAX
+ *
+ * The class is stored to the top two bits of the storage field, which
+ * is the last byte before content. Short strings use 2 or 4 byte
+ * descriptor, and sl_use() uses class 2 (or 3 for huge storage).
+ * Allocation or growth beyond SL_STORAGE_MAX aborts the program.
+ *
+ * SLINKY_SIZE_BITS=64 makes the size (sl_size_t) and position
+ * (sl_pos_t) types 64 bits wide, for multi-gigabyte strings. Default
+ * is 32. Library must be compiled with the same size as the user
+ * code.
+ */
+
+#ifndef SLINKY_SIZE_BITS
+#    define SLINKY_SIZE_BITS 32
+#endif
+
+#if SLINKY_SIZE_BITS == 64
+
+/** Size type. */
+typedef uint64_t sl_size_t;
+
+/** Position type (signed). */
+typedef int64_t sl_pos_t;
+
+/** Maximum storage size of Slinky. */
+#    define SL_STORAGE_MAX ( ( (sl_size_t)1 << 62 ) - 2 )
+
+#elif SLINKY_SIZE_BITS == 32
+
 /** Size type. */
 typedef uint32_t sl_size_t;
 
-/** Slinky structure. */
-typedef struct
-{
-    sl_size_t res;      /**< String storage size. */
-    sl_size_t len;      /**< Length (used). */
-    char      str[ 0 ]; /**< String content. */
-} sl_s;
+/** Position type (signed). */
+typedef int sl_pos_t;
+
+/** Maximum storage size of Slinky. */
+#    define SL_STORAGE_MAX ( (sl_size_t)~1 )
+
+#else
+#    error "SLINKY_SIZE_BITS must be 32 or 64."
+#endif
+
+/** Slinky structure (descriptor size depends on class). */
+typedef struct sl_s sl_s;
 
 /** Slinky reference. */
 typedef struct
@@ -70,6 +155,123 @@ typedef sl_v      sla;
 /** @} */
 
 
+/** Arena for Slinky allocations (opaque). */
+typedef struct sl_arena_s sl_arena_s;
+
+/** Handle for Slinky arena. */
+typedef sl_arena_s* sl_arena_t;
+
+
+/** Hash map with Slinky keys (opaque). */
+typedef struct sl_hmap_s sl_hmap_s;
+
+/** Handle for Slinky hash map. */
+typedef sl_hmap_s* sl_hmap_t;
+
+
+/** Compiled search string (opaque). */
+typedef struct sl_needle_s sl_needle_s;
+
+/** Handle for compiled search string. */
+typedef sl_needle_s* sl_needle_t;
+
+
+/** Compiled multi-pattern search (opaque). */
+typedef struct sl_multi_s sl_multi_s;
+
+/** Handle for multi-pattern search. */
+typedef sl_multi_s* sl_multi_t;
+
+/** Compiled glob patterns (opaque). */
+typedef struct sl_glob_s sl_glob_s;
+
+/** Handle for compiled glob patterns. */
+typedef sl_glob_s* sl_glob_t;
+
+/** Multi-pattern search match. */
+typedef struct
+{
+    sr_s      sr; /**< Match in searched string. */
+    sl_size_t id; /**< Pattern index. */
+} sl_match_s;
+
+/** Find iterator state, see sl_find_iter(). */
+typedef struct
+{
+    const char* hay;  /**< Searched string. */
+    sl_size_t   hlen; /**< Searched string length. */
+    const char* ndl;  /**< Needle string. */
+    sl_size_t   nlen; /**< Needle length. */
+    sl_needle_t nd;   /**< Compiled needle (or NULL). */
+    sl_size_t   pos;  /**< Next search pos. */
+} sl_find_iter_s;
+
+
+/** Storage growth policy for growing Slinky operations. */
+typedef enum
+{
+    SL_GROWTH_EXACT = 0,  /**< Grow to the requested size (default). */
+    SL_GROWTH_GEOMETRIC,  /**< Grow geometrically, amortized O(1) appends. */
+    SL_GROWTH_CUSTOM      /**< Grow with user provided function. */
+} sl_growth_t;
+
+/**
+ * Custom growth function. Return new storage size for Slinky with
+ * storage "res" that requires at least "size" storage.
+ */
+typedef sl_size_t ( *sl_growth_fn_t )( sl_size_t res, sl_size_t size );
+
+
+#ifdef SLINKY_USE_STATS
+/** Number of allocation size histogram bins. */
+#    define SL_STATS_HIST 32
+
+/**
+ * Allocation statistics. Histogram bin "i" counts allocations of
+ * [2^i, 2^(i+1)) bytes (bin 0 also sizes 0-1).
+ */
+typedef struct
+{
+    uint64_t allocs;                 /**< Storage allocations. */
+    uint64_t frees;                  /**< Storage frees. */
+    uint64_t reallocs;               /**< Storage re-allocations. */
+    uint64_t promotions;             /**< Local storage moved to heap. */
+    uint64_t compacts;               /**< Storage shrinks. */
+    uint64_t compact_bytes;          /**< Bytes released by shrinks. */
+    int64_t  res_live;               /**< Storage of live heap Slinky strings. */
+    uint64_t res_freed;              /**< Storage of freed Slinky strings. */
+    uint64_t len_freed;              /**< Length of freed Slinky strings. */
+    uint64_t hist[ SL_STATS_HIST ]; /**< Allocation size histogram. */
+} sl_stats_t;
+#endif
+
+
+#ifdef SLINKY_USE_TRACE
+/** Promotion record of sl_use() callsite. */
+typedef struct
+{
+    const char* file;   /**< Callsite file. */
+    int         line;   /**< Callsite line. */
+    sl_size_t   size;   /**< Local storage size (largest). */
+    sl_size_t   needed; /**< Needed storage size (largest). */
+    uint64_t    count;  /**< Number of promotions. */
+} sl_trace_t;
+#endif
+
+
+#ifdef SLINKY_USE_INTERN
+/** Intern table statistics. */
+typedef struct
+{
+    size_t count;   /**< Interned strings. */
+    size_t bytes;   /**< Memory used by interned strings. */
+    size_t table;   /**< Memory used by table. */
+    size_t lookups; /**< Intern requests. */
+    size_t hits;    /**< Requests served with existing string. */
+} sl_intern_stats_t;
+#endif
+
+
 #define SR_NULL \
     {           \
         NULL, 0 \
@@ -98,6 +300,14 @@ extern void* sl_malloc( size_t size );
 extern void  sl_free( void* ptr );
 extern void* sl_realloc( void* ptr, size_t size );
 
+#    ifdef SLINKY_USE_MEM_USABLE
+/*
+ * With SLINKY_USE_MEM_USABLE the user provides also the usable size
+ * of allocation (as malloc_usable_size) for sl_set_harvest().
+ */
+extern size_t sl_usable_size( void* ptr );
+#    endif
+
 #else /* SLINKY_USE_MEM_API */
 
 
@@ -134,6 +344,11 @@ extern void* sl_realloc( void* ptr, size_t size );
 #define slde2     sl_del2
 #define slres     sl_reserve
 #define slcom     sl_compact
+#define slgrw     sl_grow
+#define slshr     sl_share
+#define slsha     sl_share_atomic
+#define slush     sl_unshare
+#define slhsh     sl_hash
 #define slcpy     sl_copy
 #define slcpy_c   sl_copy_c
 #define slach     sl_append_char
@@ -159,6 +374,7 @@ extern void* sl_realloc( void* ptr, size_t size );
 #define slcmp     sl_compare
 #define slsme     sl_is_same
 #define sldff     sl_is_different
+#define slcmi     sl_compare_icase
 #define slsrt     sl_sort
 #define slcat     sl_concatenate
 #define slcat_c   sl_concatenate_c
@@ -176,9 +392,19 @@ extern void* sl_realloc( void* ptr, size_t size );
 #define slinv     sl_invert_pos
 #define slfcr     sl_find_char_right
 #define slfcl     sl_find_char_left
+#define slcch     sl_count_char
+#define slfac     sl_find_any_char
 #define slidx     sl_find_index
+#define slidi     sl_find_index_icase
+#define slidr     sl_find_index_right
+#define slfal     sl_find_all
+#define slfla     sl_find_last
+#define slfnd     sl_find_needle
+#define slfnr     sl_find_needle_right
+#define slfmp     sl_find_multi
 #define sldiv     sl_divide_with_char
 #define slseg     sl_segment_with_str
+#define slsgn     sl_segment_with_needle
 #define slglu     sl_glue_array
 #define sltok     sl_tokenize
 #define slext     sl_rm_extension
@@ -186,6 +412,9 @@ extern void* sl_realloc( void* ptr, size_t size );
 #define slbas     sl_basename
 #define slswp     sl_swap_chars
 #define slmap     sl_map_str
+#define slmpn     sl_map_needle
+#define slmpm     sl_map_many
+#define slgbm     sl_glob_match
 #define slcap     sl_capitalize
 #define sltou     sl_toupper
 #define sltol     sl_tolower
@@ -221,8 +450,9 @@ sl_t sl_new( sl_size_t size );
  * Use existing memory allocation for Slinky.
  *
  * "size" is for the whole Slinky, including descriptor and string
- * storage. Hence string storage is 8 bytes smaller that "size". Also
- * size must be an even value.
+ * storage. Hence string storage is sl_body_size() (8 bytes) smaller
+ * that "size", or 16 bytes for storage beyond 2^30. Also size must be
+ * an even value. Storage beyond SL_STORAGE_MAX is not used.
  *
  * @param mem   Allocation for Slinky.
  * @param size  Allocation size (even number).
@@ -232,309 +462,780 @@ sl_t sl_new( sl_size_t size );
 sl_t sl_use( void* mem, sl_size_t size );
 
 
+#ifdef SLINKY_USE_TRACE
+
 /**
- * Delete Slinky using reference.
+ * Tracing version of sl_use().
  *
- * @param sp Pointer to Slinky.
+ * With SLINKY_USE_TRACE, sl_use() is a macro that records the
+ * callsite. When the local Slinky is moved to heap (promoted), the
+ * callsite, original storage size and needed size are recorded for
+ * sl_trace_report().
  *
- * @return NULL
+ * @param mem   Allocation for Slinky.
+ * @param size  Allocation size (even number).
+ * @param file  Callsite file.
+ * @param line  Callsite line.
+ *
+ * @return Slinky.
  */
-sl_t sl_del( sl_p sp );
+sl_t sl_use_at( void* mem, sl_size_t size, const char* file, int line );
+#    define sl_use( mem, size ) sl_use_at( mem, size, __FILE__, __LINE__ )
 
 
 /**
- * Delete Slinky.
+ * Collect worst promotion callsites, i.e. callsites with most
+ * promotions.
  *
- * @param ss Slinky.
+ * @param trace Callsite array (output).
+ * @param cnt   Array size.
  *
- * @return NA
+ * @return Number of callsites returned.
  */
-void sl_del2( sl_t ss );
+int sl_trace_worst( sl_trace_t* trace, int cnt );
 
 
 /**
- * Update Slinky storage to size.
- *
- * If current storage is bigger, do nothing.
- *
- * @param sp   Pointer to Slinky.
- * @param size Storage size.
+ * Print worst promotion callsites to stdout.
  *
- * @return Slinky.
+ * @param cnt Number of callsites to print.
  */
-sl_t sl_reserve( sl_p sp, sl_size_t size );
+void sl_trace_report( int cnt );
 
 
 /**
- * Compact storage to minimum size.
- *
- * Minimum is string length + 1.
+ * Clear promotion records.
+ */
+void sl_trace_reset( void );
+
+#endif
+
+
+/**
+ * Delete Slinky using reference.
  *
  * @param sp Pointer to Slinky.
  *
- * @return Slinky.
+ * @return NULL
  */
-sl_t sl_compact( sl_p sp );
+sl_t sl_del( sl_p sp );
 
 
 /**
- * Copy Slinky content from another Slinky.
+ * Delete Slinky.
  *
- * @param s1 Pointer to Slinky.
- * @param s2 Slinky.
+ * @param ss Slinky.
  *
- * @return Slinky.
+ * @return NA
  */
-sl_t sl_copy( sl_p s1, sl_t s2 );
+void sl_del2( sl_t ss );
 
 
 /**
- * Copy Slinky content from CSTR.
+ * Create many empty Slinky strings in one allocation.
  *
- * @param s1 Pointer to Slinky.
- * @param s2 Slinky.
+ * Slinky strings are "local" (see sl_use()), i.e. sl_del() does not
+ * free them, and they are moved to own allocation if resized. The
+ * array is NULL terminated and all strings are released with
+ * sl_del_many().
  *
- * @return Slinky.
+ * @param cnt  Number of Slinky strings.
+ * @param size Storage size of each Slinky.
+ *
+ * @return Slinky array.
  */
-sl_t sl_copy_c( sl_p s1, const char* s2 );
+sl_v sl_new_many( sl_size_t cnt, sl_size_t size );
 
 
 /**
- * Append Slinky with character.
+ * Create Slinky strings from CSTR array in one allocation.
  *
- * @param sp  Pointer to Slinky.
- * @param c   Char to append.
+ * Storage of each Slinky is fitted to CSTR. See sl_new_many().
  *
- * @return Slinky.
+ * @param cs  CSTR array.
+ * @param cnt Number of CSTRs.
+ *
+ * @return Slinky array.
  */
-sl_t sl_append_char( sl_p sp, char c );
+sl_v sl_from_array_c( const char** cs, sl_size_t cnt );
 
 
 /**
- * Append Slinky with character n times.
+ * Delete Slinky array created with sl_new_many() or
+ * sl_from_array_c().
  *
- * @param sp  Pointer to Slinky.
- * @param c   Char to append.
- * @param n   Append count.
+ * Slinky strings moved to own allocation are deleted as well.
  *
- * @return Slinky.
+ * @param sa Pointer to Slinky array.
  */
-sl_t sl_append_n_char( sl_p sp, char c, sl_size_t n );
+void sl_del_many( sl_v* sa );
 
 
 /**
- * Append characters from string taking "cnt" chars.
+ * Update Slinky storage to size.
+ *
+ * If current storage is bigger, do nothing.
  *
  * @param sp   Pointer to Slinky.
- * @param cs   CSTR for appending.
- * @param clen Sub-string length.
+ * @param size Storage size.
  *
  * @return Slinky.
  */
-sl_t sl_append_substr( sl_p sp, const char* cs, sl_size_t clen );
+sl_t sl_reserve( sl_p sp, sl_size_t size );
 
 
+#ifdef SLINKY_USE_MEMTUN
+
 /**
- * Append string to Slinky.
+ * Create Slinky using allocator "mt" (see sl_new()).
  *
- * @param sp Pointer to Slinky.
- * @param cs CSTR.
+ * @param mt   Allocator.
+ * @param size Storage size.
  *
  * @return Slinky.
  */
-sl_t sl_append_str( sl_p sp, const char* cs );
+sl_t sl_new_with( mt_t mt, sl_size_t size );
 
 
 /**
- * Append string to Slinky n times.
+ * Reserve Slinky storage using allocator "mt" (see sl_reserve()).
  *
- * @param sp Pointer to Slinky.
- * @param cs CSTR.
- * @param n  Append count.
+ * Storage keeps its allocator, if no re-allocation is needed.
+ * Otherwise storage is moved to "mt".
+ *
+ * @param mt   Allocator.
+ * @param sp   Pointer to Slinky.
+ * @param size Storage size.
  *
  * @return Slinky.
  */
-sl_t sl_append_n_str( sl_p sp, const char* cs, sl_size_t n );
+sl_t sl_reserve_with( mt_t mt, sl_p sp, sl_size_t size );
+
+#endif
 
 
 /**
- * Append Pointer to Slinky to Slinky.
+ * Compact storage to minimum size.
+ *
+ * Minimum is string length + 1.
  *
  * @param sp Pointer to Slinky.
- * @param cs CSTR.
- * @param n  Append count.
  *
  * @return Slinky.
  */
-sl_t sl_append_sr( sl_p sp, sr_s sr );
+sl_t sl_compact( sl_p sp );
 
 
 /**
- * Append many strings to Slinky.
+ * Update Slinky storage to at least size, using the growth policy.
  *
- * Variable amount of strings are appended. The argument list must be
- * terminated with NULL.
+ * sl_grow() is used by all growing Slinky operations (append,
+ * concatenate, insert, format, map etc.). With exact growth policy
+ * sl_grow() is same as sl_reserve().
  *
- * @param sp Pointer to Slinky.
- * @param cs First CSTR.
+ * @param sp   Pointer to Slinky.
+ * @param size Minimum storage size.
  *
  * @return Slinky.
  */
-sl_t sl_append_va_str( sl_p sp, const char* cs, ... );
+sl_t sl_grow( sl_p sp, sl_size_t size );
 
 
 /**
- * Duplicate Slinky, using same storage as original.
+ * Set process wide growth policy.
  *
- * @param ss Slinky.
+ * Geometric growth doubles the storage, and above
+ * SLINKY_GROWTH_LIMIT the storage is grown by half. Custom growth
+ * uses "fn" to calculate the new storage size ("fn" is ignored for
+ * other policies). Policy is set atomically, hence it may be changed
+ * while other threads use Slinky.
  *
- * @return Slinky.
+ * @param growth Growth policy.
+ * @param fn     Custom growth function (or NULL).
  */
-sl_t sl_duplicate( sl_t ss );
+void sl_set_growth( sl_growth_t growth, sl_growth_fn_t fn );
 
 
 /**
- * Duplicate Slinky as CSTR.
- *
- * @param ss Slinky.
+ * Return process wide growth policy.
  *
- * @return CSTR.
+ * @return Growth policy.
  */
-char* sl_duplicate_c( sl_t ss );
+sl_growth_t sl_get_growth( void );
 
 
 /**
- * Replicate (duplicate) Slinky, using mininum storage.
+ * Set process wide harvesting of allocator slack.
  *
- * @param ss Slinky.
+ * Allocators usually return more memory than requested. When
+ * harvesting is enabled, heap allocating functions (sl_new(),
+ * sl_reserve(), sl_compact() etc.) store the actual usable storage
+ * (even) to Slinky, hence later growth may not need re-allocation.
  *
- * @return Slinky.
+ * Usable size is provided by malloc_usable_size() (glibc), size
+ * classes of SLINKY_USE_POOL, or sl_usable_size() with
+ * SLINKY_USE_MEM_API and SLINKY_USE_MEM_USABLE. Otherwise storage is
+ * as requested.
+ *
+ * @param val Enable harvesting if non-zero (default: disabled).
  */
-sl_t sl_replicate( sl_t ss );
+void sl_set_harvest( int val );
 
 
 /**
- * Change Slinky into normal CSTR.
- *
- * Memory allocation remains the same. Slinky content is moved to
- * base.
- *
- * The returned CSTR should be freed as any heap allocated string.
- *
- * @param ss Slinky.
+ * Return process wide harvesting of allocator slack.
  *
- * @return CSTR.
+ * @return 1 if enabled, else 0.
  */
-char* sl_drop( sl_t ss );
+int sl_get_harvest( void );
 
 
 /**
- * Clear content of Slinky.
+ * Create arena for Slinky allocations.
  *
- * Set string length to 0. No change to storage.
+ * Arena is a bump allocator for Slinky strings with shared lifetime.
+ * Arena memory is allocated in chunks of "size" bytes. Bigger strings
+ * get own chunks.
  *
- * @param ss Slinky.
+ * @param size Chunk size.
  *
- * @return Slinky.
+ * @return Arena.
  */
-sl_t sl_clear( sl_t ss );
+sl_arena_t sl_arena_new( size_t size );
 
 
 /**
- * Create Slinky based on CSTR with size from CSTR.
+ * Delete arena and all Slinky strings in it.
  *
- * @param cs CSTR.
- *
- * @return Slinky.
+ * @param arena Arena.
  */
-sl_t sl_from_str_c( const char* cs );
+void sl_arena_del( sl_arena_t arena );
 
 
 /**
- * Create Slinky based on CSTR with given len.
+ * Reset arena, i.e. release all Slinky strings in it.
  *
- * @param cs  CSTR.
- * @param len CSTR length.
+ * Arena chunks are kept for reuse.
  *
- * @return Slinky.
+ * @param arena Arena.
  */
-sl_t sl_from_len_c( const char* cs, sl_size_t clen );
+void sl_arena_reset( sl_arena_t arena );
 
 
 /**
- * Create Slinky based on variable number of CSTR.
+ * Set the current arena of the calling thread.
  *
- * @param cs First CSTR.
+ * When arena is set, all Slinky strings are created in the arena
+ * (sl_new() and all functions creating Slinky). Arena Slinky is
+ * "local", i.e. sl_del() does not free it. If arena Slinky is resized
+ * while arena is current, it is extended in place (last allocation)
+ * or moved within the arena. Otherwise it is moved to heap, as any
+ * "local" Slinky.
  *
- * @return Slinky.
+ * @param arena Arena (or NULL for heap).
+ *
+ * @return Previous arena.
  */
-sl_t sl_from_va_str_c( const char* cs, ... );
+sl_arena_t sl_set_arena( sl_arena_t arena );
 
 
 /**
- * Create Slinky based on CSTR with given size.
- *
- * Size is enlarged if CSTR is longer than given size.
- *
- * @param cs    CSTR.
- * @param size  Storage size.
+ * Return the current arena of the calling thread.
  *
- * @return Slinky.
+ * @return Arena (or NULL).
  */
-sl_t sl_from_str_with_size_c( const char* cs, sl_size_t size );
+sl_arena_t sl_get_arena( void );
 
 
 /**
- * Refresh Slinky length.
+ * Make Slinky shared (copy-on-write) and return a new reference.
  *
- * Useful when some function has filled string content and it should
- * be in sync with the Slinky itself.
+ * Shared Slinky has a reference count in extended descriptor (in
+ * front of descriptor). sl_duplicate() and sl_replicate() of shared
+ * Slinky return a new reference and sl_del() removes a reference. The
+ * storage is freed with the last reference.
  *
- * @param sp Slinky.
+ * Functions that take Slinky pointer (sl_p) break sharing, i.e. copy
+ * the content to private storage, before modification. Functions that
+ * modify sl_t in place require private storage (see sl_unshare()), and
+ * abort if it is shared. sl_divide_with_char(), sl_segment_with_str()
+ * and sl_tokenize() fail instead.
  *
- * @return Slinky.
+ * Local (and arena) Slinky is copied to heap, i.e. "*sp" is updated.
+ *
+ * Reference count is not thread safe, see sl_share_atomic().
+ *
+ * @param sp Pointer to Slinky.
+ *
+ * @return New reference.
  */
-sl_t sl_refresh( sl_t ss );
+sl_t sl_share( sl_p sp );
 
 
 /**
- * Return Slinky length.
+ * Make Slinky shared with atomic reference count.
  *
- * @param ss Slinky.
+ * As sl_share(), but references can be used (and deleted) in multiple
+ * threads. Content must not be modified in place while shared.
  *
- * @return Length.
+ * @param sp Pointer to Slinky.
+ *
+ * @return New reference.
  */
-sl_size_t sl_length( sl_t ss );
+sl_t sl_share_atomic( sl_p sp );
 
 
 /**
- * Set Slinky length.
+ * Break sharing, i.e. copy content to private storage, if shared.
  *
- * @param ss  Slinky.
- * @param len New length.
+ * @param sp Pointer to Slinky.
  *
  * @return Slinky.
  */
-sl_t sl_set_length( sl_t ss, sl_size_t len );
+sl_t sl_unshare( sl_p sp );
 
 
 /**
- * Return Slinky storage size.
- *
- * Storage size is the string content storage.
+ * Return true if Slinky storage is shared by multiple references.
  *
  * @param ss Slinky.
  *
- * @return Storage size.
+ * @return 1 if shared, else 0.
  */
-sl_size_t sl_reservation_size( sl_t ss );
+int sl_is_shared( sl_t ss );
+
+
+/**
+ * Return 64-bit hash of Slinky content.
+ *
+ * Fast non-cryptographic hash (wyhash). Hash is cached, if Slinky
+ * has an extended descriptor (shared, interned or sl_cache_hash()),
+ * and the cache is invalidated by functions that modify Slinky. If
+ * Slinky content is modified directly, use sl_refresh() afterwards.
+ *
+ * Hash depends on byte order of the platform.
+ *
+ * @param ss Slinky.
+ *
+ * @return Hash.
+ */
+uint64_t sl_hash( sl_t ss );
+
+
+/**
+ * Return 64-bit hash of CSTR (see sl_hash()).
+ *
+ * @param cs CSTR.
+ *
+ * @return Hash.
+ */
+uint64_t sl_hash_c( const char* cs );
+
+
+/**
+ * Return 64-bit hash of Slinky reference (see sl_hash()).
+ *
+ * @param sr Slinky reference.
+ *
+ * @return Hash.
+ */
+uint64_t sl_hash_sr( sr_s sr );
+
+
+/**
+ * Return ASCII case-insensitive 64-bit hash of Slinky.
+ *
+ * Hash equals sl_hash() of the string converted to lowercase, but
+ * case is folded during hashing, i.e. no copy is made. Hash is not
+ * cached.
+ *
+ * @param ss Slinky.
+ *
+ * @return Hash.
+ */
+uint64_t sl_hash_icase( sl_t ss );
+
+
+/**
+ * Return ASCII case-insensitive 64-bit hash of Slinky reference (see
+ * sl_hash_icase()).
+ *
+ * @param sr Slinky reference.
+ *
+ * @return Hash.
+ */
+uint64_t sl_hash_sr_icase( sr_s sr );
+
+
+/**
+ * Enable hash caching for Slinky.
+ *
+ * Slinky gets an extended descriptor, which stores the hash. Local
+ * Slinky is copied to heap, i.e. "*sp" is updated.
+ *
+ * @param sp Pointer to Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_cache_hash( sl_p sp );
+
+
+#ifdef SLINKY_USE_INTERN
+
+/**
+ * Return canonical (interned) Slinky with same content as Slinky.
+ *
+ * Interned Slinky is shared (see sl_share_atomic()) and immutable,
+ * i.e. modification through sl_p copies the content first. Interned
+ * Slinky strings with same content are the same pointer, which makes
+ * sl_is_same() and sl_compare() O(1) for them.
+ *
+ * Intern table is global and thread safe. The returned reference
+ * must be deleted with sl_del().
+ *
+ * @param ss Slinky.
+ *
+ * @return Interned Slinky.
+ */
+sl_t sl_intern( sl_t ss );
+
+
+/**
+ * Return interned Slinky for CSTR (see sl_intern()).
+ *
+ * @param cs CSTR.
+ *
+ * @return Interned Slinky.
+ */
+sl_t sl_intern_c( const char* cs );
+
+
+/**
+ * Return interned Slinky for Slinky reference (see sl_intern()).
+ *
+ * @param sr Slinky reference.
+ *
+ * @return Interned Slinky.
+ */
+sl_t sl_intern_sr( sr_s sr );
+
+
+/**
+ * Return true if Slinky is interned.
+ *
+ * @param ss Slinky.
+ *
+ * @return 1 if interned, else 0.
+ */
+int sl_is_interned( sl_t ss );
+
+
+/**
+ * Evict interned Slinky strings that are not referenced outside the
+ * intern table (weak eviction).
+ *
+ * @return Number of evicted strings.
+ */
+size_t sl_intern_sweep( void );
+
+
+/**
+ * Collect intern table statistics.
+ *
+ * @param stats Statistics (output).
+ */
+void sl_intern_stats( sl_intern_stats_t* stats );
+
+#endif
+
+
+#ifdef SLINKY_USE_STATS
+
+/**
+ * Collect allocation statistics.
+ *
+ * Counters are kept per thread, without locks, and snapshot sums the
+ * counters of all threads (also exited ones). Use differences of
+ * snapshots to measure a period.
+ *
+ * @param stats Statistics (output).
+ */
+void sl_stats_snapshot( sl_stats_t* stats );
+
+
+/**
+ * Print allocation statistics to stdout.
+ *
+ * @param stats Statistics.
+ */
+void sl_stats_dump( const sl_stats_t* stats );
+
+#endif
+
+
+/**
+ * Copy Slinky content from another Slinky.
+ *
+ * @param s1 Pointer to Slinky.
+ * @param s2 Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_copy( sl_p s1, sl_t s2 );
+
+
+/**
+ * Copy Slinky content from CSTR.
+ *
+ * @param s1 Pointer to Slinky.
+ * @param s2 Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_copy_c( sl_p s1, const char* s2 );
+
+
+/**
+ * Append Slinky with character.
+ *
+ * @param sp  Pointer to Slinky.
+ * @param c   Char to append.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_char( sl_p sp, char c );
+
+
+/**
+ * Append Slinky with character n times.
+ *
+ * @param sp  Pointer to Slinky.
+ * @param c   Char to append.
+ * @param n   Append count.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_n_char( sl_p sp, char c, sl_size_t n );
+
+
+/**
+ * Append characters from string taking "cnt" chars.
+ *
+ * @param sp   Pointer to Slinky.
+ * @param cs   CSTR for appending.
+ * @param clen Sub-string length.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_substr( sl_p sp, const char* cs, sl_size_t clen );
+
+
+/**
+ * Append string to Slinky.
+ *
+ * @param sp Pointer to Slinky.
+ * @param cs CSTR.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_str( sl_p sp, const char* cs );
+
+
+/**
+ * Append string to Slinky n times.
+ *
+ * @param sp Pointer to Slinky.
+ * @param cs CSTR.
+ * @param n  Append count.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_n_str( sl_p sp, const char* cs, sl_size_t n );
+
+
+/**
+ * Append Pointer to Slinky to Slinky.
+ *
+ * @param sp Pointer to Slinky.
+ * @param cs CSTR.
+ * @param n  Append count.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_sr( sl_p sp, sr_s sr );
+
+
+/**
+ * Append many strings to Slinky.
+ *
+ * Variable amount of strings are appended. The argument list must be
+ * terminated with NULL.
+ *
+ * @param sp Pointer to Slinky.
+ * @param cs First CSTR.
+ *
+ * @return Slinky.
+ */
+sl_t sl_append_va_str( sl_p sp, const char* cs, ... );
+
+
+/**
+ * Duplicate Slinky, using same storage as original.
+ *
+ * Shared Slinky returns new reference (see sl_share()).
+ *
+ * @param ss Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_duplicate( sl_t ss );
+
+
+/**
+ * Duplicate Slinky as CSTR.
+ *
+ * @param ss Slinky.
+ *
+ * @return CSTR.
+ */
+char* sl_duplicate_c( sl_t ss );
+
+
+/**
+ * Replicate (duplicate) Slinky, using mininum storage.
+ *
+ * Shared Slinky returns new reference (see sl_share()).
+ *
+ * @param ss Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_replicate( sl_t ss );
+
+
+/**
+ * Change Slinky into normal CSTR.
+ *
+ * Memory allocation remains the same. Slinky content is moved to
+ * base.
+ *
+ * The returned CSTR should be freed as any heap allocated string.
+ *
+ * @param ss Slinky.
+ *
+ * @return CSTR.
+ */
+char* sl_drop( sl_t ss );
+
+
+/**
+ * Clear content of Slinky.
+ *
+ * Set string length to 0. No change to storage.
+ *
+ * @param ss Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_clear( sl_t ss );
+
+
+/**
+ * Create Slinky based on CSTR with size from CSTR.
+ *
+ * @param cs CSTR.
+ *
+ * @return Slinky.
+ */
+sl_t sl_from_str_c( const char* cs );
+
+
+/**
+ * Create Slinky based on CSTR with given len.
+ *
+ * @param cs  CSTR.
+ * @param len CSTR length.
+ *
+ * @return Slinky.
+ */
+sl_t sl_from_len_c( const char* cs, sl_size_t clen );
+
+
+/**
+ * Create Slinky based on variable number of CSTR.
+ *
+ * @param cs First CSTR.
+ *
+ * @return Slinky.
+ */
+sl_t sl_from_va_str_c( const char* cs, ... );
+
+
+/**
+ * Create Slinky based on CSTR with given size.
+ *
+ * Size is enlarged if CSTR is longer than given size.
+ *
+ * @param cs    CSTR.
+ * @param size  Storage size.
+ *
+ * @return Slinky.
+ */
+sl_t sl_from_str_with_size_c( const char* cs, sl_size_t size );
+
+
+/**
+ * Refresh Slinky length.
+ *
+ * Useful when some function has filled string content and it should
+ * be in sync with the Slinky itself.
+ *
+ * @param sp Slinky.
+ *
+ * @return Slinky.
+ */
+sl_t sl_refresh( sl_t ss );
+
+
+/**
+ * Return Slinky length.
+ *
+ * @param ss Slinky.
+ *
+ * @return Length.
+ */
+sl_size_t sl_length( sl_t ss );
+
+
+/**
+ * Set Slinky length.
+ *
+ * @param ss  Slinky.
+ * @param len New length.
+ *
+ * @return Slinky.
+ */
+sl_t sl_set_length( sl_t ss, sl_size_t len );
+
+
+/**
+ * Return Slinky storage size.
+ *
+ * Storage size is the string content storage.
+ *
+ * @param ss Slinky.
+ *
+ * @return Storage size.
+ */
+sl_size_t sl_reservation_size( sl_t ss );
 
 
 /**
  * Return Slinky body size.
  *
  * Body size is the size of the Slinky non-string content storage,
- * i.e. the bookkeeping part.
+ * i.e. the bookkeeping part, of sl_use() Slinky. Heap Slinky with
+ * short storage has a smaller descriptor.
  *
  * @return Body size.
  */
@@ -555,7 +1256,8 @@ sl_size_t sl_normalize_size( sl_size_t size );
 
 
 /**
- * Return Slinky base type.
+ * Return Slinky base type, i.e. start of descriptor. Descriptor size
+ * is the distance from base to "ss".
  *
  * @param ss Slinky.
  *
@@ -607,6 +1309,31 @@ int sl_is_same( sl_t s1, sl_t s2 );
 int sl_is_different( sl_t s1, sl_t s2 );
 
 
+/**
+ * Compare two Slinky ignoring ASCII case.
+ *
+ * Letters are compared as lowercase, as in strcasecmp() for "C"
+ * locale.
+ *
+ * @param s1 Reference Slinky.
+ * @param s2 Compared Slinky.
+ *
+ * @return -1,0,1 (see strcmp).
+ */
+int sl_compare_icase( sl_t s1, sl_t s2 );
+
+
+/**
+ * Are two Slinky strings same ignoring ASCII case?
+ *
+ * @param s1 Reference Slinky.
+ * @param s2 Compared Slinky.
+ *
+ * @return 1 if same.
+ */
+int sl_is_same_icase( sl_t s1, sl_t s2 );
+
+
 /**
  * Sort Slinky array to alphabetical order.
  *
@@ -649,7 +1376,7 @@ sl_t sl_concatenate_c( sl_p s1, const char* s2 );
  *
  * @return Slinky.
  */
-sl_t sl_push_char_to( sl_p sp, int pos, char c );
+sl_t sl_push_char_to( sl_p sp, sl_pos_t pos, char c );
 
 
 /**
@@ -662,7 +1389,7 @@ sl_t sl_push_char_to( sl_p sp, int pos, char c );
  *
  * @return Slinky.
  */
-sl_t sl_pop_char_from( sl_t ss, int pos );
+sl_t sl_pop_char_from( sl_t ss, sl_pos_t pos );
 
 
 /**
@@ -675,7 +1402,7 @@ sl_t sl_pop_char_from( sl_t ss, int pos );
  *
  * @return Slinky.
  */
-sl_t sl_limit_to_pos( sl_t ss, int pos );
+sl_t sl_limit_to_pos( sl_t ss, sl_pos_t pos );
 
 
 /**
@@ -689,7 +1416,7 @@ sl_t sl_limit_to_pos( sl_t ss, int pos );
  *
  * @return Slinky.
  */
-sl_t sl_cut( sl_t ss, int cnt );
+sl_t sl_cut( sl_t ss, sl_pos_t cnt );
 
 
 /**
@@ -705,7 +1432,7 @@ sl_t sl_cut( sl_t ss, int cnt );
  *
  * @return Slinky.
  */
-sl_t sl_select_slice( sl_t ss, int a, int b );
+sl_t sl_select_slice( sl_t ss, sl_pos_t a, sl_pos_t b );
 
 
 /**
@@ -717,7 +1444,7 @@ sl_t sl_select_slice( sl_t ss, int a, int b );
  *
  * @return Target.
  */
-sl_t sl_insert_to( sl_p s1, int pos, sl_t s2 );
+sl_t sl_insert_to( sl_p s1, sl_pos_t pos, sl_t s2 );
 
 
 /**
@@ -729,7 +1456,7 @@ sl_t sl_insert_to( sl_p s1, int pos, sl_t s2 );
  *
  * @return Target.
  */
-sl_t sl_insert_to_c( sl_p s1, int pos, const char* s2 );
+sl_t sl_insert_to_c( sl_p s1, sl_pos_t pos, const char* s2 );
 
 
 /**
@@ -828,7 +1555,7 @@ sl_t sl_va_format_quick( sl_p sp, const char* fmt, va_list ap );
  *
  * @return Inverted pos.
  */
-int sl_invert_pos( sl_t ss, int pos );
+sl_pos_t sl_invert_pos( sl_t ss, sl_pos_t pos );
 
 
 /**
@@ -840,19 +1567,44 @@ int sl_invert_pos( sl_t ss, int pos );
  *
  * @return Pos (or -1 if not found).
  */
-int sl_find_char_right( sl_t ss, char c, sl_size_t pos );
+sl_pos_t sl_find_char_right( sl_t ss, char c, sl_size_t pos );
 
 
 /**
  * Find char towards left.
  *
+ * Search starts from last char, if "pos" is beyond Slinky end.
+ *
  * @param ss  Slinky.
  * @param c   Char to find.
  * @param pos Search start pos.
  *
  * @return Pos (or -1 if not found).
  */
-int sl_find_char_left( sl_t ss, char c, sl_size_t pos );
+sl_pos_t sl_find_char_left( sl_t ss, char c, sl_size_t pos );
+
+
+/**
+ * Count occurrences of char.
+ *
+ * @param ss Slinky.
+ * @param c  Char to count.
+ *
+ * @return Count.
+ */
+sl_size_t sl_count_char( sl_t ss, char c );
+
+
+/**
+ * Find any char of "set" towards right.
+ *
+ * @param ss  Slinky.
+ * @param set Chars to find (CSTR).
+ * @param pos Search start pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_any_char( sl_t ss, const char* set, sl_size_t pos );
 
 
 /**
@@ -865,7 +1617,119 @@ int sl_find_char_left( sl_t ss, char c, sl_size_t pos );
  *
  * @return Pos (or -1 if not found).
  */
-int sl_find_index( sl_t s1, const char* s2 );
+sl_pos_t sl_find_index( sl_t s1, const char* s2 );
+
+
+/**
+ * Find "s2" from "s1" ignoring ASCII case. Return position or -1 if
+ * not found.
+ *
+ * "s2" can be Slinky or CSTR.
+ *
+ * @param s1  Base.
+ * @param s2  Find.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_index_icase( sl_t s1, const char* s2 );
+
+
+/**
+ * Find last "s2" from "s1". Return position or -1 if not found.
+ *
+ * Search proceeds from the end, hence finding a suffix does not scan
+ * the whole string.
+ *
+ * "s2" can be Slinky or CSTR.
+ *
+ * @param s1  Base.
+ * @param s2  Find.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_index_right( sl_t s1, const char* s2 );
+
+
+/**
+ * Find all (non-overlapping) "s2" from "s1".
+ *
+ * First "size" occurrences are stored to "match" as references to
+ * "s1". Return value is the total count, hence "size" 0 is count
+ * only. "s1" is scanned once, and it is not modified.
+ *
+ * @param s1    Base.
+ * @param s2    Find.
+ * @param match Storage for occurrences.
+ * @param size  Size of match.
+ *
+ * @return Number of occurrences.
+ */
+sl_size_t sl_find_all( sl_t s1, const char* s2, sr_s* match, sl_size_t size );
+
+
+/**
+ * Find last (non-overlapping) "s2" occurrences from "s1".
+ *
+ * Upto "size" matches are stored to "match", starting from the last
+ * one. Search stops when "match" is full, hence only the tail of "s1"
+ * is scanned. Overlapping matches are resolved from the end.
+ *
+ * @param s1    Base.
+ * @param s2    Find.
+ * @param match Storage for matches.
+ * @param size  Size of match.
+ *
+ * @return Number of stored matches.
+ */
+sl_size_t sl_find_last( sl_t s1, const char* s2, sr_s* match, sl_size_t size );
+
+
+/**
+ * Initialize find iterator for all (non-overlapping) "s2" in "s1".
+ *
+ * Iterator keeps the scan position, and occurrences are retrieved
+ * with sl_find_next() or in chunks with sl_find_fill(). Iterator
+ * refers to "s1" and "s2", hence they must not be changed during
+ * iteration. No allocations are made.
+ *
+ * @param it Iterator.
+ * @param s1 Base.
+ * @param s2 Find.
+ */
+void sl_find_iter( sl_find_iter_s* it, sl_t s1, const char* s2 );
+
+
+/**
+ * Initialize find iterator for compiled needle "nd" in "ss".
+ *
+ * @param it Iterator.
+ * @param ss Slinky.
+ * @param nd Needle.
+ */
+void sl_find_iter_needle( sl_find_iter_s* it, sl_t ss, sl_needle_t nd );
+
+
+/**
+ * Get next occurrence from find iterator.
+ *
+ * @param it    Iterator.
+ * @param match Occurrence (output).
+ *
+ * @return 1 if occurrence was returned, 0 at end.
+ */
+int sl_find_next( sl_find_iter_s* it, sr_s* match );
+
+
+/**
+ * Get next chunk of occurrences from find iterator.
+ *
+ * @param it    Iterator.
+ * @param match Storage for occurrences.
+ * @param size  Size of match.
+ *
+ * @return Number of occurrences stored (0 at end).
+ */
+sl_size_t sl_find_fill( sl_find_iter_s* it, sr_s* match, sl_size_t size );
 
 
 /**
@@ -879,6 +1743,9 @@ int sl_find_index( sl_t s1, const char* s2 );
  * cancelled with sl_swap_chars() or user can use a duplicate Slinky,
  * which does not require fixing.
  *
+ * Shared or interned Slinky is not modified, and -1 is returned. Use
+ * sl_unshare() first to get a private copy.
+ *
  * If called with "size" < 0, return only the number of parts. No
  * modification is done to Slinky.
  *
@@ -893,9 +1760,9 @@ int sl_find_index( sl_t s1, const char* s2 );
  * @param size Size of div storage (-1 for na).
  * @param div  Address of div storage.
  *
- * @return Number of pieces.
+ * @return Number of pieces (-1 if shared).
  */
-int sl_divide_with_char( sl_t ss, char c, int size, char*** div );
+sl_pos_t sl_divide_with_char( sl_t ss, char c, sl_pos_t size, char*** div );
 
 
 /**
@@ -910,9 +1777,23 @@ int sl_divide_with_char( sl_t ss, char c, int size, char*** div );
  * @param size Size of div storage (-1 for na).
  * @param div  Address of div storage.
  *
- * @return Number of pieces.
+ * @return Number of pieces (-1 if shared).
  */
-int sl_segment_with_str( sl_t ss, const char* sc, int size, char*** div );
+sl_pos_t sl_segment_with_str( sl_t ss, const char* sc, sl_pos_t size, char*** div );
+
+
+/**
+ * Same as sl_segment_with_str() except segmentation is done using
+ * compiled needle.
+ *
+ * @param ss   Slinky.
+ * @param nd   Needle to split with.
+ * @param size Size of div storage (-1 for na).
+ * @param div  Address of div storage.
+ *
+ * @return Number of pieces (-1 if shared).
+ */
+sl_pos_t sl_segment_with_needle( sl_t ss, sl_needle_t nd, sl_pos_t size, char*** div );
 
 
 /**
@@ -938,6 +1819,8 @@ sl_t sl_glue_array( sl_v sa, sl_size_t size, const char* glu );
  *
  * After last token, "*pos" will be set to "ss".
  *
+ * Shared or interned Slinky is not tokenized (NULL is returned).
+ *
  * Example:
  *   char* t, *pos, *delim = "XY";
  *   s = sl_ttr_c( "abXYabcXYc" );
@@ -956,7 +1839,7 @@ char* sl_tokenize( sl_t ss, const char* delim, char** pos );
 
 
 /**
- * Drop the extension "ext" from "ss".
+ * Drop the extension "ext" from "ss", i.e. cut at the last "ext".
  *
  * @param ss  Slinky.
  * @param ext Extension (i.e. file suffix).
@@ -996,23 +1879,68 @@ sl_t sl_basename( sl_t ss );
  * @param f  From char.
  * @param t  To char.
  *
- * @return Slinky.
+ * @return Slinky.
+ */
+sl_t sl_swap_chars( sl_t ss, char f, char t );
+
+
+/**
+ * Map (replace) string "f" to "t" in "ss".
+ *
+ * "f" and "t" can be either Slinky or CSTR.
+ *
+ * @param sp Pointer to Slinky.
+ * @param f  From string.
+ * @param t  To string.
+ *
+ * @return Slinky
+ */
+sl_t sl_map_str( sl_p sp, const char* f, const char* t );
+
+
+/**
+ * Map (replace) compiled needle "nd" to "t" in "ss".
+ *
+ * @param sp Pointer to Slinky.
+ * @param nd From needle.
+ * @param t  To string.
+ *
+ * @return Slinky
+ */
+sl_t sl_map_needle( sl_p sp, sl_needle_t nd, const char* t );
+
+
+/**
+ * Map (replace) many strings in "ss" in one pass.
+ *
+ * "pairs" has "n" from/to pairs as CSTR: from0, to0, from1, to1,
+ * ... Strings are matched leftmost-longest, and replacements are not
+ * searched again, e.g. "a"->"b" and "b"->"a" swaps the chars. Result
+ * is written with a single storage reservation.
+ *
+ * @param sp    Pointer to Slinky.
+ * @param pairs From/to strings.
+ * @param n     Number of pairs.
+ *
+ * @return Slinky
  */
-sl_t sl_swap_chars( sl_t ss, char f, char t );
+sl_t sl_map_many( sl_p sp, const char** pairs, sl_size_t n );
 
 
 /**
- * Map (replace) string "f" to "t" in "ss".
+ * Map (replace) patterns of multi-pattern search "mp" in "ss".
  *
- * "f" and "t" can be either Slinky or CSTR.
+ * Match of pattern "i" is replaced with "to[i]". Same as
+ * sl_map_many(), but patterns are compiled only once. "to" must not
+ * refer to "ss".
  *
  * @param sp Pointer to Slinky.
- * @param f  From string.
- * @param t  To string.
+ * @param mp Multi-pattern search.
+ * @param to Replacements (pattern count).
  *
  * @return Slinky
  */
-sl_t sl_map_str( sl_p sp, const char* f, const char* t );
+sl_t sl_map_multi( sl_p sp, sl_multi_t mp, const sr_s* to );
 
 
 /**
@@ -1062,9 +1990,12 @@ sl_t sl_tolower( sl_t ss );
 /**
  * Read complete file and return Slinky containing the file content.
  *
+ * Return NULL if file can't be read or it does not fit to Slinky
+ * (see SL_STORAGE_MAX).
+ *
  * @param filename Name of file.
  *
- * @return Slinky.
+ * @return Slinky (or NULL).
  */
 sl_t sl_read_file( const char* filename );
 
@@ -1213,4 +2144,451 @@ int sr_compare( sr_s s1, sr_s s2 );
 int sr_compare_full( sr_s s1, sr_s s2 );
 
 
+/**
+ * Compare two Slinky References ignoring ASCII case.
+ *
+ * @param s1  One.
+ * @param s2  The other.
+ *
+ * @return 0 for match, and non-zero for mismatch.
+ */
+int sr_compare_icase( sr_s s1, sr_s s2 );
+
+
+/**
+ * Compare two Slinky References upto shared lenght ignoring ASCII
+ * case.
+ *
+ * @param s1  One.
+ * @param s2  The other.
+ *
+ * @return 0 for match, and non-zero for mismatch.
+ */
+int sr_compare_full_icase( sr_s s1, sr_s s2 );
+
+
+/**
+ * Create hash map with Slinky keys.
+ *
+ * Open addressing map with control bytes (Swiss table), probed in
+ * groups of 16 (SSE2 when available). Map owns its keys. Keys can be
+ * queried with Slinky references, i.e. without allocation.
+ *
+ * @param size Initial capacity (entries).
+ *
+ * @return Map.
+ */
+sl_hmap_t sl_hmap_new( size_t size );
+
+
+/**
+ * Delete hash map and its keys.
+ *
+ * @param map Map.
+ */
+void sl_hmap_del( sl_hmap_t map );
+
+
+/**
+ * Insert or update entry.
+ *
+ * Map stores a replica of key (a reference for shared Slinky).
+ *
+ * @param map   Map.
+ * @param key   Key.
+ * @param value Value.
+ *
+ * @return 1 if new entry was inserted, 0 if value was updated.
+ */
+int sl_hmap_put( sl_hmap_t map, sl_t key, void* value );
+
+
+/**
+ * Insert or update entry with Slinky reference as key.
+ *
+ * @param map   Map.
+ * @param key   Key.
+ * @param value Value.
+ *
+ * @return 1 if new entry was inserted, 0 if value was updated.
+ */
+int sl_hmap_put_sr( sl_hmap_t map, sr_s key, void* value );
+
+
+/**
+ * Find entry.
+ *
+ * @param map Map.
+ * @param key Key.
+ *
+ * @return Pointer to value (or NULL if not found).
+ */
+void** sl_hmap_find( sl_hmap_t map, sr_s key );
+
+
+/**
+ * Find entry with Slinky key (uses cached hash, see sl_hash()).
+ *
+ * @param map Map.
+ * @param key Key.
+ *
+ * @return Pointer to value (or NULL if not found).
+ */
+void** sl_hmap_find_sl( sl_hmap_t map, sl_t key );
+
+
+/**
+ * Erase entry.
+ *
+ * @param map Map.
+ * @param key Key.
+ *
+ * @return 1 if erased, 0 if not found.
+ */
+int sl_hmap_erase( sl_hmap_t map, sr_s key );
+
+
+/**
+ * Return number of entries.
+ *
+ * @param map Map.
+ *
+ * @return Entry count.
+ */
+size_t sl_hmap_count( sl_hmap_t map );
+
+
+/**
+ * Iterate entries.
+ *
+ * Iterator is initialized to 0 before first call. Map must not be
+ * modified during iteration, except for updating values.
+ *
+ * @param map   Map.
+ * @param iter  Iterator.
+ * @param key   Entry key (output).
+ * @param value Entry value (output, or NULL).
+ *
+ * @return 1 if entry was returned, 0 at end.
+ */
+int sl_hmap_next( sl_hmap_t map, size_t* iter, sl_t* key, void** value );
+
+
+/**
+ * Create compiled needle (search string).
+ *
+ * Needle is analysed once: two rarest bytes are selected for the
+ * vectorized candidate filter, and Two-Way tables are prepared for
+ * long needles. Needle owns a copy of the string, and it is not
+ * modified by searches, i.e. it can be shared between threads.
+ *
+ * Empty needle is never found.
+ *
+ * @param cs Search string (CSTR).
+ *
+ * @return Needle.
+ */
+sl_needle_t sl_needle_new( const char* cs );
+
+
+/**
+ * Create compiled needle from Slinky Reference.
+ *
+ * @param sr Search string.
+ *
+ * @return Needle.
+ */
+sl_needle_t sl_needle_new_sr( sr_s sr );
+
+
+/**
+ * Create ASCII case-insensitive compiled needle.
+ *
+ * Needle can be used with all needle functions, and matches are
+ * found regardless of case.
+ *
+ * @param cs Search string (CSTR).
+ *
+ * @return Needle.
+ */
+sl_needle_t sl_needle_new_icase( const char* cs );
+
+
+/**
+ * Delete compiled needle.
+ *
+ * @param nd Needle.
+ */
+void sl_needle_del( sl_needle_t nd );
+
+
+/**
+ * Find needle from Slinky starting at "pos".
+ *
+ * @param ss  Slinky.
+ * @param nd  Needle.
+ * @param pos Search start pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_needle( sl_t ss, sl_needle_t nd, sl_size_t pos );
+
+
+/**
+ * Find needle from Slinky Reference starting at "pos".
+ *
+ * @param sr  Slinky Reference.
+ * @param nd  Needle.
+ * @param pos Search start pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sr_find_needle( sr_s sr, sl_needle_t nd, sl_size_t pos );
+
+
+/**
+ * Find last needle from Slinky, ending at or before "pos".
+ *
+ * Use sl_length() as "pos" for the whole Slinky, and the previous
+ * match position for the next (non-overlapping) match.
+ *
+ * @param ss  Slinky.
+ * @param nd  Needle.
+ * @param pos Search end pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_needle_right( sl_t ss, sl_needle_t nd, sl_size_t pos );
+
+
+/**
+ * Find last needle from Slinky Reference, ending at or before "pos".
+ *
+ * @param sr  Slinky Reference.
+ * @param nd  Needle.
+ * @param pos Search end pos.
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sr_find_needle_right( sr_s sr, sl_needle_t nd, sl_size_t pos );
+
+
+/**
+ * Find all (non-overlapping) needle positions from Slinky.
+ *
+ * First "size" positions are stored to "offs". Return value is the
+ * total count, hence "size" 0 is count only.
+ *
+ * @param ss   Slinky.
+ * @param nd   Needle.
+ * @param offs Storage for positions.
+ * @param size Size of offs.
+ *
+ * @return Number of occurrences.
+ */
+sl_size_t sl_find_all_needle( sl_t ss, sl_needle_t nd, sl_size_t* offs, sl_size_t size );
+
+
+/**
+ * Create multi-pattern search from patterns.
+ *
+ * Small pattern set (upto 8 patterns) is searched with a vectorized
+ * fingerprint filter (first two pattern bytes, as in Teddy), and
+ * larger sets with Aho-Corasick automaton. Automaton transitions are
+ * indexed by byte class, i.e. bytes not in patterns share a column.
+ *
+ * Matches are leftmost-longest and non-overlapping: from all matches
+ * the one starting first is selected, and the longest if many start
+ * at the same position. Duplicate pattern matches with the smallest
+ * index. Empty patterns are never found.
+ *
+ * Multi-pattern search is read-only after creation, i.e. it can be
+ * shared between threads.
+ *
+ * @param pats Patterns (CSTR).
+ * @param cnt  Pattern count.
+ *
+ * @return Multi-pattern search.
+ */
+sl_multi_t sl_multi_new( const char** pats, sl_size_t cnt );
+
+
+/**
+ * Create multi-pattern search from Slinky References.
+ *
+ * @param pats Patterns.
+ * @param cnt  Pattern count.
+ *
+ * @return Multi-pattern search.
+ */
+sl_multi_t sl_multi_new_sr( const sr_s* pats, sl_size_t cnt );
+
+
+/**
+ * Delete multi-pattern search.
+ *
+ * @param mp Multi-pattern search.
+ */
+void sl_multi_del( sl_multi_t mp );
+
+
+/**
+ * Find first pattern match from Slinky starting at "pos".
+ *
+ * @param ss  Slinky.
+ * @param mp  Multi-pattern search.
+ * @param pos Search start pos.
+ * @param id  Index of matching pattern (output, or NULL).
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sl_find_multi( sl_t ss, sl_multi_t mp, sl_size_t pos, sl_size_t* id );
+
+
+/**
+ * Find first pattern match from Slinky Reference starting at "pos".
+ *
+ * @param sr  Slinky Reference.
+ * @param mp  Multi-pattern search.
+ * @param pos Search start pos.
+ * @param id  Index of matching pattern (output, or NULL).
+ *
+ * @return Pos (or -1 if not found).
+ */
+sl_pos_t sr_find_multi( sr_s sr, sl_multi_t mp, sl_size_t pos, sl_size_t* id );
+
+
+/**
+ * Find all pattern matches from Slinky.
+ *
+ * First "size" matches are stored to "match". Return value is the
+ * total count.
+ *
+ * @param ss    Slinky.
+ * @param mp    Multi-pattern search.
+ * @param match Storage for matches.
+ * @param size  Size of match.
+ *
+ * @return Number of matches.
+ */
+sl_size_t sl_find_all_multi( sl_t ss, sl_multi_t mp, sl_match_s* match, sl_size_t size );
+
+
+/**
+ * Find all pattern matches from Slinky Reference.
+ *
+ * @param sr    Slinky Reference.
+ * @param mp    Multi-pattern search.
+ * @param match Storage for matches.
+ * @param size  Size of match.
+ *
+ * @return Number of matches.
+ */
+sl_size_t sr_find_all_multi( sr_s sr, sl_multi_t mp, sl_match_s* match, sl_size_t size );
+
+
+/**
+ * Count pattern matches in Slinky.
+ *
+ * @param ss Slinky.
+ * @param mp Multi-pattern search.
+ *
+ * @return Number of matches.
+ */
+sl_size_t sl_count_multi( sl_t ss, sl_multi_t mp );
+
+
+/**
+ * Count pattern matches in Slinky Reference.
+ *
+ * @param sr Slinky Reference.
+ * @param mp Multi-pattern search.
+ *
+ * @return Number of matches.
+ */
+sl_size_t sr_count_multi( sr_s sr, sl_multi_t mp );
+
+
+/**
+ * Create compiled glob (wildcard) pattern for path matching.
+ *
+ * Pattern syntax:
+ * - "*" matches any bytes except "/".
+ * - "?" matches any byte except "/".
+ * - "[...]" matches byte in set, "[!...]" or "[^...]" not in set. Set
+ *   may have ranges (a-z). Set never matches "/".
+ * - "**" as a full path component matches also "/", and "**" followed
+ *   by "/" matches zero or more directories, e.g. "**" + "/" + "*.log"
+ *   matches "a.log" and "x/y/a.log".
+ * - "\" escapes the next byte.
+ *
+ * Without "**" patterns, match is as with fnmatch() and FNM_PATHNAME.
+ * Character classes ("[:alpha:]") are not supported.
+ *
+ * Pattern is compiled to a bit-parallel NFA, hence match time is
+ * linear in string length and there is no backtracking. Glob is
+ * read-only after creation, and it can be shared between threads.
+ *
+ * @param pat Pattern (CSTR).
+ *
+ * @return Glob.
+ */
+sl_glob_t sl_glob_new( const char* pat );
+
+
+/**
+ * Create compiled glob from many patterns (see sl_glob_new()).
+ *
+ * All patterns are matched in one pass, hence matching a set of
+ * patterns is much faster than matching each pattern.
+ *
+ * @param pats Patterns (CSTR).
+ * @param cnt  Pattern count.
+ *
+ * @return Glob.
+ */
+sl_glob_t sl_glob_new_many( const char** pats, sl_size_t cnt );
+
+
+/**
+ * Create compiled glob from Slinky Reference patterns.
+ *
+ * @param pats Patterns.
+ * @param cnt  Pattern count.
+ *
+ * @return Glob.
+ */
+sl_glob_t sl_glob_new_sr( const sr_s* pats, sl_size_t cnt );
+
+
+/**
+ * Delete compiled glob.
+ *
+ * @param gp Glob.
+ */
+void sl_glob_del( sl_glob_t gp );
+
+
+/**
+ * Match Slinky against glob. Whole Slinky must match.
+ *
+ * @param ss Slinky.
+ * @param gp Glob.
+ *
+ * @return Index of first matching pattern (or -1 if no match).
+ */
+sl_pos_t sl_glob_match( sl_t ss, sl_glob_t gp );
+
+
+/**
+ * Match Slinky Reference against glob. Whole reference must match.
+ *
+ * @param sr Slinky Reference.
+ * @param gp Glob.
+ *
+ * @return Index of first matching pattern (or -1 if no match).
+ */
+sl_pos_t sr_glob_match( sr_s sr, sl_glob_t gp );
+
+
 #endif
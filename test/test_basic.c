@@ -6,6 +6,25 @@
 #include "slinky.h"
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+
+#if defined( SLINKY_USE_POOL ) || defined( SLINKY_USE_INTERN ) || defined( SLINKY_USE_MEMTUN )
+# include <pthread.h>
+#endif
+
+
+/** Descriptor size of Slinky. */
+static size_t test_dsize( sl_t s )
+{
+    return s - (char*)slptr( s );
+}
+
+#ifdef SLINKY_ALIGN
+/* Aligned content uses 8 byte descriptor at least. */
+#    define TEST_DSIZE( n ) ( ( n ) < 8 ? 8 : ( n ) )
+#else
+#    define TEST_DSIZE( n ) ( n )
+#endif
 
 
 void test_basics( void )
@@ -90,9 +109,10 @@ void test_basics( void )
     TEST_ASSERT( sllen( s2 ) == 5 );
     sl_base_p s2sl;
     s2sl = slptr( s2 );
-    TEST_ASSERT( !strcmp( s2sl->str, "text1" ) );
-    TEST_ASSERT( s2sl->res == 6 );
-    TEST_ASSERT( s2sl->len == 5 );
+    /* Length and storage fields (little endian). */
+    TEST_ASSERT( (char*)s2sl + TEST_DSIZE( 2 ) == s2 );
+    TEST_ASSERT( ( (uint8_t*)s2sl )[ TEST_DSIZE( 2 ) / 2 ] == 6 );
+    TEST_ASSERT( ( (uint8_t*)s2sl )[ 0 ] == 5 );
     sldel( &s2 );
 
     char buf[ 24 ];
@@ -480,7 +500,7 @@ void test_pieces( void )
         slswp( s, 0, 'a' );
     }
 
-    sl_free( pcs );
+    sldel( &s );
 }
 
 
@@ -675,3 +695,1562 @@ void test_path( void )
 
     sldel( &s );
 }
+
+
+static sl_size_t test_growth_fn( sl_size_t res, sl_size_t size )
+{
+    (void)res;
+    return size + 100;
+}
+
+
+void test_growth( void )
+{
+    sl_t s;
+
+    TEST_ASSERT( sl_get_growth() == SL_GROWTH_EXACT );
+
+    s = slnew( 0 );
+    slach( &s, 'a' );
+    TEST_ASSERT( slrss( s ) == 2 );
+    sldel( &s );
+
+    sl_set_growth( SL_GROWTH_GEOMETRIC, NULL );
+    TEST_ASSERT( sl_get_growth() == SL_GROWTH_GEOMETRIC );
+
+    s = slnew( 0 );
+    slast( &s, "aa" );
+    TEST_ASSERT( slrss( s ) == 16 );
+    for ( int i = 0; i < 15; i++ )
+        slach( &s, 'a' );
+    TEST_ASSERT( slrss( s ) == 32 );
+    TEST_ASSERT( sllen( s ) == 17 );
+
+    /* Explicit reserve is always exact. */
+    slres( &s, 33 );
+    TEST_ASSERT( slrss( s ) == 34 );
+
+    slcat_c( &s, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb" );
+    TEST_ASSERT( slrss( s ) == 106 );
+    TEST_ASSERT( sllen( s ) == 105 );
+
+    slpsh( &s, 0, 'c' );
+    TEST_ASSERT( slrss( s ) == 212 );
+    TEST_ASSERT( s[ 0 ] == 'c' );
+    sldel( &s );
+
+    sl_set_growth( SL_GROWTH_CUSTOM, test_growth_fn );
+    TEST_ASSERT( sl_get_growth() == SL_GROWTH_CUSTOM );
+    s = slnew( 0 );
+    slast( &s, "abc" );
+    TEST_ASSERT( slrss( s ) == 104 );
+    sldel( &s );
+
+    /* Custom without function falls back to exact. */
+    sl_set_growth( SL_GROWTH_CUSTOM, NULL );
+    TEST_ASSERT( sl_get_growth() == SL_GROWTH_EXACT );
+}
+
+
+#ifdef SLINKY_USE_POOL
+
+static void* test_pool_thread( void* arg )
+{
+    sl_t s = arg;
+    sldel( &s );
+    s = slstr_c( "thread" );
+    sldel( &s );
+    sl_pool_trim();
+    return NULL;
+}
+
+
+void test_pool( void )
+{
+    sl_t  s, s2;
+    char* p;
+
+    /* Freed block is reused for same size class. */
+    s = slnew( 24 );
+    p = s;
+    sldel( &s );
+    s = slnew( 20 );
+    TEST_ASSERT( s == p );
+
+    /* Reserve within size class keeps storage. */
+    slcpy_c( &s, "text1" );
+    slres( &s, 24 );
+    TEST_ASSERT( s == p );
+    TEST_ASSERT( slrss( s ) == 24 );
+
+    /* Move to bigger class and back. */
+    slres( &s, 200 );
+    TEST_ASSERT( !strcmp( s, "text1" ) );
+    TEST_ASSERT( slrss( s ) == 200 );
+    slcom( &s );
+    TEST_ASSERT( !strcmp( s, "text1" ) );
+    TEST_ASSERT( slrss( s ) == 6 );
+
+    /* Large allocations. */
+    slres( &s, 100000 );
+    slres( &s, 200000 );
+    TEST_ASSERT( !strcmp( s, "text1" ) );
+    slcom( &s );
+    TEST_ASSERT( !strcmp( s, "text1" ) );
+
+    /* Remote free. */
+    pthread_t th;
+    s2 = slstr_c( "remote" );
+    p = s2;
+    pthread_create( &th, NULL, test_pool_thread, s2 );
+    pthread_join( th, NULL );
+    s2 = slstr_c( "remote" );
+    TEST_ASSERT( s2 == p );
+    sldel( &s2 );
+
+    p = sldrp( s );
+    TEST_ASSERT( !strcmp( p, "text1" ) );
+    sl_free( p );
+
+    sl_pool_trim();
+}
+
+#endif
+
+
+void test_arena( void )
+{
+    sl_arena_t arena;
+    sl_t       s, s2, s3;
+    char*      pcs[ 2 ] = { "foo", "bar" };
+
+    arena = sl_arena_new( 256 );
+    TEST_ASSERT( sl_set_arena( arena ) == NULL );
+    TEST_ASSERT( sl_get_arena() == arena );
+
+    s = slstr_c( "text1" );
+    TEST_ASSERT_TRUE( sl_get_local( s ) );
+    TEST_ASSERT( slrss( s ) == 6 );
+
+    /* Last allocation is extended in place. */
+    s2 = s;
+    slcat_c( &s, "text1" );
+    TEST_ASSERT( s == s2 );
+    TEST_ASSERT_TRUE( !strcmp( s, "text1text1" ) );
+
+    s2 = sldup( s );
+    TEST_ASSERT_TRUE( sl_get_local( s2 ) );
+    TEST_ASSERT_TRUE( !strcmp( s2, "text1text1" ) );
+
+    /* Not last, so moved within arena. */
+    s3 = s;
+    slcat_c( &s, "text1" );
+    TEST_ASSERT( s != s3 );
+    TEST_ASSERT_TRUE( sl_get_local( s ) );
+    TEST_ASSERT_TRUE( !strcmp( s, "text1text1text1" ) );
+
+    s3 = slglu( pcs, 2, "/" );
+    TEST_ASSERT_TRUE( !strcmp( s3, "foo/bar" ) );
+    TEST_ASSERT_TRUE( sl_get_local( s3 ) );
+
+    /* Bigger than chunk. */
+    slres( &s3, 1000 );
+    TEST_ASSERT_TRUE( !strcmp( s3, "foo/bar" ) );
+    sldel( &s3 );
+    sldel( &s2 );
+
+    /* Moved to heap without arena. */
+    TEST_ASSERT( sl_set_arena( NULL ) == arena );
+    slcat_c( &s, "text1" );
+    TEST_ASSERT_FALSE( sl_get_local( s ) );
+    TEST_ASSERT_TRUE( !strcmp( s, "text1text1text1text1" ) );
+    sldel( &s );
+
+    sl_arena_reset( arena );
+    sl_set_arena( arena );
+    s = slnew( 16 );
+    TEST_ASSERT_TRUE( sl_get_local( s ) );
+    sl_arena_del( arena );
+    TEST_ASSERT( sl_get_arena() == NULL );
+}
+
+
+void test_descriptor( void )
+{
+    sl_t s, s2;
+    sl_v sa;
+    char buf[ 512 ];
+
+    TEST_ASSERT( sl_body_size() == 8 );
+
+    /* Short string has 2 byte descriptor. */
+    s = slstr_c( "identifier" );
+    TEST_ASSERT( sllen( s ) == 10 );
+    TEST_ASSERT( slrss( s ) == 12 );
+    TEST_ASSERT( test_dsize( s ) == TEST_DSIZE( 2 ) );
+
+    /* Class changes with storage size. */
+    slacn( &s, 'a', 100 );
+    TEST_ASSERT( test_dsize( s ) == TEST_DSIZE( 4 ) );
+    TEST_ASSERT( sllen( s ) == 110 );
+    slacn( &s, 'b', 20000 );
+    TEST_ASSERT( test_dsize( s ) == TEST_DSIZE( 8 ) );
+    TEST_ASSERT( sllen( s ) == 20110 );
+    TEST_ASSERT( s[ 109 ] == 'a' && s[ 20109 ] == 'b' );
+    slcut( s, 20100 );
+    slcom( &s );
+    TEST_ASSERT( test_dsize( s ) == TEST_DSIZE( 2 ) );
+    TEST_ASSERT_EQUAL_STRING( "identifier", s );
+    sldel( &s );
+
+    /* Extended descriptor is kept over class change. */
+    s = slstr_c( "id" );
+    s2 = slshr( &s );
+    sldel( &s2 );
+    slacn( &s, 'c', 100 );
+    TEST_ASSERT( test_dsize( s ) == TEST_DSIZE( 4 ) );
+    TEST_ASSERT( sllen( s ) == 102 );
+    TEST_ASSERT( sl_hash( s ) == sl_hash_sr( sr_new( s, 102 ) ) );
+    s2 = sldup( s );
+    TEST_ASSERT( s2 == s );
+    sldel( &s2 );
+    sldel( &s );
+
+    /* Harvested storage fits to class. */
+    sl_set_harvest( 1 );
+    s = slnew( 40 );
+    TEST_ASSERT( slrss( s ) >= 40 );
+    TEST_ASSERT( slrss( s ) <= 62 || test_dsize( s ) > 2 );
+    TEST_ASSERT( test_dsize( s ) == TEST_DSIZE( 2 ) );
+    sldel( &s );
+    sl_set_harvest( 0 );
+
+    /* Batch strings use compact classes. */
+    sa = sl_new_many( 4, 16 );
+    TEST_ASSERT( test_dsize( sa[ 0 ] ) == TEST_DSIZE( 2 ) );
+    slcpy_c( &sa[ 1 ], "batch" );
+    TEST_ASSERT_EQUAL_STRING( "batch", sa[ 1 ] );
+    sl_del_many( &sa );
+
+    /* Local storage uses 8 byte descriptor. */
+    s = sluse( buf, 512 );
+    TEST_ASSERT( slrss( s ) == 512 - sl_body_size() );
+    TEST_ASSERT( (char*)slptr( s ) + sl_body_size() == s );
+    slacn( &s, 'a', 200 );
+    TEST_ASSERT_TRUE( sl_get_local( s ) );
+    TEST_ASSERT( sllen( s ) == 200 );
+    sldel( &s );
+}
+
+
+void test_quote( void )
+{
+    sl_t s;
+
+    s = slstr_c( "a\"b\\c\nd" );
+    sl_quote( &s );
+    TEST_ASSERT_TRUE( !strcmp( s, "\"a\\\"b\\\\c\\nd\"" ) );
+    TEST_ASSERT( sllen( s ) == 12 );
+    sl_unquote( s );
+    TEST_ASSERT_TRUE( !strcmp( s, "a\"b\\c\nd" ) );
+    TEST_ASSERT( sllen( s ) == 7 );
+    sldel( &s );
+}
+
+
+#if SLINKY_SIZE_BITS != 64 || defined( SLINKY_TEST_HUGE )
+/** Create sparse file of "size" bytes, ending with "end". */
+static void test_sparse_file( const char* name, uint64_t size )
+{
+    int fd;
+
+    fd = open( name, O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR );
+    TEST_ASSERT( fd >= 0 );
+    TEST_ASSERT( ftruncate( fd, size - 3 ) == 0 );
+    TEST_ASSERT( pwrite( fd, "end", 3, size - 3 ) == 3 );
+    close( fd );
+}
+#endif
+
+
+void test_huge_file( void )
+{
+#if SLINKY_SIZE_BITS == 64 && defined( SLINKY_TEST_HUGE )
+    const char* name = "test/test_huge_file.bin";
+    uint64_t    size = 5ULL * 1024 * 1024 * 1024;
+
+    /* Sparse file over 4 GiB. */
+    test_sparse_file( name, size );
+    sl_t s = slrdf( name );
+    TEST_ASSERT( s != NULL );
+    TEST_ASSERT( sllen( s ) == size );
+    TEST_ASSERT_TRUE( !strcmp( &s[ size - 3 ], "end" ) );
+    TEST_ASSERT( slfcl( s, 'e', size - 1 ) == (sl_pos_t)( size - 3 ) );
+    sldel( &s );
+    unlink( name );
+#elif SLINKY_SIZE_BITS != 64
+    const char* name = "test/test_huge_file.bin";
+
+    /* Too big, no truncation. */
+    test_sparse_file( name, (uint64_t)SL_STORAGE_MAX + 1 );
+    sl_t s = slrdf( name );
+    TEST_ASSERT( s == NULL );
+    unlink( name );
+#endif
+}
+
+
+void test_share( void )
+{
+    sl_t s1, s2, s3;
+    char buf[ 32 ];
+
+    s1 = slstr_c( "shared" );
+    TEST_ASSERT_FALSE( sl_is_shared( s1 ) );
+
+    /* Share and duplicate. */
+    s2 = slshr( &s1 );
+    TEST_ASSERT( s1 == s2 );
+    TEST_ASSERT_TRUE( sl_is_shared( s1 ) );
+    s3 = sldup( s2 );
+    TEST_ASSERT( s3 == s1 );
+    TEST_ASSERT( sllen( s3 ) == 6 );
+    TEST_ASSERT( slrss( s3 ) == 8 );
+
+    /* Modification breaks sharing. */
+    slach( &s3, '!' );
+    TEST_ASSERT( s3 != s1 );
+    TEST_ASSERT_EQUAL_STRING( "shared!", s3 );
+    TEST_ASSERT_EQUAL_STRING( "shared", s1 );
+    TEST_ASSERT_FALSE( sl_is_shared( s3 ) );
+    TEST_ASSERT_TRUE( sl_is_shared( s1 ) );
+
+    slmap( &s2, "ared", "ort" );
+    TEST_ASSERT_EQUAL_STRING( "short", s2 );
+    TEST_ASSERT_EQUAL_STRING( "shared", s1 );
+    TEST_ASSERT_FALSE( sl_is_shared( s1 ) );
+
+    /* Last reference is private. */
+    slach( &s1, '?' );
+    TEST_ASSERT_EQUAL_STRING( "shared?", s1 );
+    sltou( s1 );
+    TEST_ASSERT_EQUAL_STRING( "SHARED?", s1 );
+    slcom( &s1 );
+    TEST_ASSERT( slrss( s1 ) == 8 );
+    sldel( &s1 );
+    sldel( &s2 );
+    sldel( &s3 );
+
+    /* Local Slinky is moved to heap. */
+    s1 = sluse( buf, 32 );
+    slcpy_c( &s1, "local" );
+    s2 = slsha( &s1 );
+    TEST_ASSERT_FALSE( sl_get_local( s1 ) );
+    TEST_ASSERT( s1 == s2 );
+    s3 = slrep( s1 );
+    TEST_ASSERT( s3 == s1 );
+    sldel( &s1 );
+    sldel( &s2 );
+    TEST_ASSERT_EQUAL_STRING( "local", s3 );
+    TEST_ASSERT_FALSE( sl_is_shared( s3 ) );
+    sldel( &s3 );
+
+    /* Drop of shared Slinky. */
+    s1 = slstr_c( "drop" );
+    s2 = slshr( &s1 );
+    char* cs = sldrp( s2 );
+    TEST_ASSERT_EQUAL_STRING( "drop", cs );
+    TEST_ASSERT_EQUAL_STRING( "drop", s1 );
+    sl_free( cs );
+    sldel( &s1 );
+
+    /* Shared Slinky is not divided nor tokenized. */
+    {
+        char** pcs = NULL;
+        char*  pos = NULL;
+        s1 = slstr_c( "a,b,c" );
+        s2 = slshr( &s1 );
+        TEST_ASSERT( sldiv( s2, ',', -1, NULL ) == 3 );
+        TEST_ASSERT( sldiv( s2, ',', 0, &pcs ) == -1 );
+        TEST_ASSERT( pcs == NULL );
+        TEST_ASSERT( slseg( s2, ",", 0, &pcs ) == -1 );
+        TEST_ASSERT( sltok( s2, ",", &pos ) == NULL );
+        TEST_ASSERT_EQUAL_STRING( "a,b,c", s1 );
+        TEST_ASSERT( sllen( s1 ) == 5 );
+
+        /* Private copy may be divided, and cached hash follows. */
+        slush( &s2 );
+        s3 = slshr( &s2 );
+        sldel( &s3 );
+        TEST_ASSERT( sl_hash( s2 ) == sl_hash_c( "a,b,c" ) );
+        TEST_ASSERT( sldiv( s2, ',', 0, &pcs ) == 3 );
+        TEST_ASSERT_EQUAL_STRING( "c", pcs[ 2 ] );
+        TEST_ASSERT_EQUAL_STRING( "a,b,c", s1 );
+        TEST_ASSERT( sl_hash( s2 ) != sl_hash_c( "a,b,c" ) );
+        sl_free( pcs );
+        pos = NULL;
+        slcpy_c( &s2, "x-y" );
+        TEST_ASSERT( sl_hash( s2 ) == sl_hash_c( "x-y" ) );
+        TEST_ASSERT_EQUAL_STRING( "x", sltok( s2, "-", &pos ) );
+        TEST_ASSERT( sl_hash( s2 ) != sl_hash_c( "x-y" ) );
+        sldel( &s1 );
+        sldel( &s2 );
+    }
+}
+
+
+#ifdef SLINKY_USE_INTERN
+
+static sl_t test_intern_keys[ 256 ];
+
+static void* test_intern_thread( void* arg )
+{
+    char buf[ 32 ];
+    int  fail = 0;
+
+    (void)arg;
+    for ( int i = 0; i < 256; i++ ) {
+        sprintf( buf, "key%d", i );
+        sl_t s = sl_intern_c( buf );
+        if ( s != test_intern_keys[ i ] )
+            fail = 1;
+        sldel( &s );
+    }
+
+    return fail ? test_intern_keys : NULL;
+}
+
+
+void test_intern( void )
+{
+    sl_t              s1, s2, s3, s4;
+    sl_intern_stats_t st;
+    char              buf[ 32 ];
+    pthread_t         th[ 4 ];
+
+    s1 = sl_intern_c( "hostname" );
+    TEST_ASSERT_TRUE( sl_is_interned( s1 ) );
+    TEST_ASSERT_EQUAL_STRING( "hostname", s1 );
+
+    s2 = slstr_c( "hostname" );
+    TEST_ASSERT_FALSE( sl_is_interned( s2 ) );
+    s3 = sl_intern( s2 );
+    TEST_ASSERT( s3 == s1 );
+    s4 = sl_intern_sr( sr_new( "hostnames", 8 ) );
+    TEST_ASSERT( s4 == s1 );
+    TEST_ASSERT_TRUE( slsme( s1, s3 ) );
+    TEST_ASSERT( slcmp( s1, s4 ) == 0 );
+    sldel( &s4 );
+
+    /* Interned Slinky is immutable. */
+    slach( &s3, 's' );
+    TEST_ASSERT_EQUAL_STRING( "hostnames", s3 );
+    TEST_ASSERT_EQUAL_STRING( "hostname", s1 );
+    TEST_ASSERT_FALSE( sl_is_interned( s3 ) );
+    s4 = sl_intern( s3 );
+    TEST_ASSERT_FALSE( slsme( s1, s4 ) );
+    TEST_ASSERT_TRUE( sldff( s1, s4 ) );
+    sldel( &s3 );
+    sldel( &s4 );
+
+    /* Concurrent lookup and insert. */
+    for ( int i = 0; i < 256; i++ ) {
+        sprintf( buf, "key%d", i );
+        test_intern_keys[ i ] = sl_intern_c( buf );
+    }
+    for ( int i = 0; i < 4; i++ )
+        pthread_create( &th[ i ], NULL, test_intern_thread, NULL );
+    for ( int i = 0; i < 4; i++ ) {
+        void* ret;
+        pthread_join( th[ i ], &ret );
+        TEST_ASSERT_NULL( ret );
+    }
+
+    sl_intern_stats( &st );
+    TEST_ASSERT( st.count == 258 );
+    TEST_ASSERT( st.hits >= 1024 + 2 );
+    TEST_ASSERT( st.bytes > 0 && st.table > 0 );
+
+    /* Weak eviction of unreferenced strings. */
+    for ( int i = 0; i < 256; i++ )
+        sldel( &test_intern_keys[ i ] );
+    TEST_ASSERT( sl_intern_sweep() == 257 );
+    TEST_ASSERT_EQUAL_STRING( "hostname", s1 );
+    s3 = sl_intern_c( "hostname" );
+    TEST_ASSERT( s3 == s1 );
+    sldel( &s3 );
+    sldel( &s1 );
+    TEST_ASSERT( sl_intern_sweep() == 1 );
+    sl_intern_stats( &st );
+    TEST_ASSERT( st.count == 0 && st.bytes == 0 );
+    sldel( &s2 );
+}
+
+#endif
+
+
+void test_hash( void )
+{
+    sl_t     s1, s2;
+    uint64_t h[ 100 ];
+    char     buf[ 128 ];
+
+    /* All lengths (and code paths) produce different hashes. */
+    s1 = slnew( 128 );
+    for ( int i = 0; i < 100; i++ ) {
+        h[ i ] = slhsh( s1 );
+        TEST_ASSERT( h[ i ] == sl_hash_c( s1 ) );
+        for ( int j = 0; j < i; j++ )
+            TEST_ASSERT( h[ i ] != h[ j ] );
+        slach( &s1, 'a' + i % 26 );
+    }
+    sldel( &s1 );
+    TEST_ASSERT( sl_hash_c( "hash" ) == sl_hash_sr( sr_new( "hashes", 4 ) ) );
+    TEST_ASSERT( sl_hash_c( "hash" ) != sl_hash_c( "hasH" ) );
+
+    /* Cached hash is invalidated by modification. */
+    s1 = sluse( buf, 128 );
+    slcpy_c( &s1, "cached" );
+    sl_cache_hash( &s1 );
+    TEST_ASSERT_FALSE( sl_get_local( s1 ) );
+    TEST_ASSERT( slhsh( s1 ) == sl_hash_c( "cached" ) );
+    TEST_ASSERT( slhsh( s1 ) == sl_hash_c( "cached" ) );
+    slach( &s1, '!' );
+    TEST_ASSERT( slhsh( s1 ) == sl_hash_c( "cached!" ) );
+    sltou( s1 );
+    TEST_ASSERT( slhsh( s1 ) == sl_hash_c( "CACHED!" ) );
+    s1[ 0 ] = 'X';
+    slref( s1 );
+    TEST_ASSERT( slhsh( s1 ) == sl_hash_c( "XACHED!" ) );
+
+    /* Cached hashes separate different strings. */
+    s2 = slstr_c( "XACHED?" );
+    sl_cache_hash( &s2 );
+    slhsh( s2 );
+    TEST_ASSERT_FALSE( slsme( s1, s2 ) );
+    TEST_ASSERT_TRUE( sldff( s1, s2 ) );
+    slcpy_c( &s2, "XACHED!" );
+    slhsh( s2 );
+    TEST_ASSERT_TRUE( slsme( s1, s2 ) );
+
+    /* Shared Slinky keeps cache. */
+    sl_t s3 = slshr( &s2 );
+    TEST_ASSERT( slhsh( s3 ) == slhsh( s1 ) );
+    slach( &s3, '!' );
+    TEST_ASSERT( slhsh( s3 ) == sl_hash_c( "XACHED!!" ) );
+    TEST_ASSERT( slhsh( s2 ) == sl_hash_c( "XACHED!" ) );
+    sldel( &s1 );
+    sldel( &s2 );
+    sldel( &s3 );
+}
+
+
+void test_hmap( void )
+{
+    sl_hmap_t map;
+    sl_t      key;
+    void*     val;
+    void**    vp;
+    size_t    iter;
+    size_t    cnt;
+    char      buf[ 64 ];
+
+    map = sl_hmap_new( 0 );
+    key = slnew( 16 );
+    for ( intptr_t i = 0; i < 1000; i++ ) {
+        slclr( key );
+        slfmq( &key, "key%i", (int)i );
+        TEST_ASSERT( sl_hmap_put( map, key, (void*)i ) == 1 );
+    }
+    TEST_ASSERT( sl_hmap_count( map ) == 1000 );
+
+    /* Update. */
+    slcpy_c( &key, "key10" );
+    TEST_ASSERT( sl_hmap_put( map, key, (void*)10000 ) == 0 );
+    TEST_ASSERT( sl_hmap_count( map ) == 1000 );
+    vp = sl_hmap_find_sl( map, key );
+    TEST_ASSERT( vp && *vp == (void*)10000 );
+    sldel( &key );
+
+    /* Find with reference (not terminated). */
+    strcpy( buf, "key999key" );
+    vp = sl_hmap_find( map, sr_new( buf, 6 ) );
+    TEST_ASSERT( vp && *vp == (void*)999 );
+    vp = sl_hmap_find( map, sr_new( buf, 4 ) );
+    TEST_ASSERT( vp && *vp == (void*)9 );
+    TEST_ASSERT_NULL( sl_hmap_find( map, sr_new( buf, 7 ) ) );
+    TEST_ASSERT_NULL( sl_hmap_find( map, sr_new( buf, 0 ) ) );
+
+    /* Erase even keys. */
+    for ( int i = 0; i < 1000; i += 2 ) {
+        sprintf( buf, "key%d", i );
+        TEST_ASSERT( sl_hmap_erase( map, sr_new_c( buf ) ) == 1 );
+        TEST_ASSERT( sl_hmap_erase( map, sr_new_c( buf ) ) == 0 );
+    }
+    TEST_ASSERT( sl_hmap_count( map ) == 500 );
+
+    iter = 0;
+    cnt = 0;
+    while ( sl_hmap_next( map, &iter, &key, &val ) ) {
+        TEST_ASSERT( ( atoi( key + 3 ) % 2 ) == 1 );
+        TEST_ASSERT( (intptr_t)val == atoi( key + 3 ) );
+        cnt++;
+    }
+    TEST_ASSERT( cnt == 500 );
+
+    /* Reuse erased slots. */
+    for ( int n = 0; n < 10; n++ ) {
+        for ( intptr_t i = 0; i < 1000; i += 2 ) {
+            sprintf( buf, "key%d", (int)i );
+            TEST_ASSERT( sl_hmap_put_sr( map, sr_new_c( buf ), (void*)i ) == 1 );
+        }
+        for ( int i = 0; i < 1000; i += 2 ) {
+            sprintf( buf, "key%d", i );
+            TEST_ASSERT( sl_hmap_erase( map, sr_new_c( buf ) ) == 1 );
+        }
+    }
+    for ( int i = 0; i < 1000; i++ ) {
+        sprintf( buf, "key%d", i );
+        vp = sl_hmap_find( map, sr_new_c( buf ) );
+        if ( i % 2 )
+            TEST_ASSERT( vp && (intptr_t)*vp == ( i == 10 ? 10000 : i ) );
+        else
+            TEST_ASSERT_NULL( vp );
+    }
+
+    /* Shared key is stored as reference. */
+    key = slstr_c( "shared" );
+    sl_t ref = slshr( &key );
+    sl_hmap_put( map, key, NULL );
+    TEST_ASSERT_TRUE( sl_is_shared( key ) );
+    sldel( &ref );
+    sldel( &key );
+    TEST_ASSERT_NOT_NULL( sl_hmap_find( map, sr_new_c( "shared" ) ) );
+
+    sl_hmap_del( map );
+}
+
+
+#ifdef SLINKY_USE_STATS
+
+void test_stats( void )
+{
+    sl_stats_t st1, st2;
+    sl_t       s;
+    char       buf[ 32 ];
+
+    sl_stats_snapshot( &st1 );
+
+    s = slnew( 100 );
+    slcpy_c( &s, "stats" );
+    slcom( &s );
+    slres( &s, 200 );
+    sldel( &s );
+
+    s = sluse( buf, 32 );
+    slacn( &s, 'a', 40 );
+    sldel( &s );
+
+    sl_stats_snapshot( &st2 );
+    TEST_ASSERT( st2.allocs - st1.allocs == 2 );
+    TEST_ASSERT( st2.frees - st1.frees == 2 );
+    TEST_ASSERT( st2.reallocs - st1.reallocs == 2 );
+    TEST_ASSERT( st2.promotions - st1.promotions == 1 );
+    TEST_ASSERT( st2.compacts - st1.compacts == 1 );
+    TEST_ASSERT( st2.compact_bytes - st1.compact_bytes == 94 );
+    TEST_ASSERT( st2.res_live == st1.res_live );
+    TEST_ASSERT( st2.res_freed - st1.res_freed == 200 + 42 );
+    TEST_ASSERT( st2.len_freed - st1.len_freed == 5 + 40 );
+    TEST_ASSERT( st2.hist[ 6 ] - st1.hist[ 6 ] == 1 );
+    TEST_ASSERT( st2.hist[ 5 ] - st1.hist[ 5 ] == 1 );
+
+    sl_stats_dump( &st2 );
+}
+
+#endif
+
+
+#ifdef SLINKY_USE_TRACE
+
+void test_trace( void )
+{
+    sl_trace_t trace[ 4 ];
+    char       buf[ 32 ];
+    char       big[ 3000 ];
+    sl_t       s;
+    int        line;
+    int        fd;
+
+    sl_trace_reset();
+
+    for ( int i = 0; i < 3; i++ ) {
+        line = __LINE__ + 1;
+        s = sluse( buf, 32 );
+        slacn( &s, 'a', 40 + i );
+        sldel( &s );
+    }
+
+    /* Output over the sl_write buffer. */
+    memset( big, 'b', 2999 );
+    big[ 2999 ] = 0;
+    fd = open( "/dev/null", O_WRONLY );
+    sl_write( fd, "%s", big );
+    close( fd );
+
+    TEST_ASSERT( sl_trace_worst( trace, 4 ) == 2 );
+    TEST_ASSERT( trace[ 0 ].line == line );
+    TEST_ASSERT( trace[ 0 ].count == 3 );
+    TEST_ASSERT( trace[ 0 ].size == 32 - sl_body_size() );
+    TEST_ASSERT( trace[ 0 ].needed == 44 );
+    TEST_ASSERT( strstr( trace[ 1 ].file, "slinky.c" ) != NULL );
+    TEST_ASSERT( trace[ 1 ].count == 1 );
+    TEST_ASSERT( trace[ 1 ].needed >= 3000 );
+
+    sl_trace_report( 4 );
+    sl_trace_reset();
+    TEST_ASSERT( sl_trace_worst( trace, 4 ) == 0 );
+}
+
+#endif
+
+
+void test_many( void )
+{
+    const char* words[] = { "alpha", "", "gamma", "delta-epsilon" };
+    sl_v        sa;
+
+    sa = sl_from_array_c( words, 4 );
+    TEST_ASSERT_NULL( sa[ 4 ] );
+    for ( int i = 0; i < 4; i++ ) {
+        TEST_ASSERT_EQUAL_STRING( words[ i ], sa[ i ] );
+        TEST_ASSERT( sllen( sa[ i ] ) == strlen( words[ i ] ) );
+        TEST_ASSERT_TRUE( sl_get_local( sa[ i ] ) );
+    }
+    TEST_ASSERT( slrss( sa[ 0 ] ) == 6 );
+    TEST_ASSERT( sa[ 1 ] < sa[ 2 ] && sa[ 2 ] < sa[ 3 ] );
+
+    /* Growing moves out of the block. */
+    slcat_c( &sa[ 0 ], "-beta" );
+    TEST_ASSERT_FALSE( sl_get_local( sa[ 0 ] ) );
+    TEST_ASSERT_EQUAL_STRING( "alpha-beta", sa[ 0 ] );
+    TEST_ASSERT_EQUAL_STRING( "gamma", sa[ 2 ] );
+    sltou( sa[ 2 ] );
+    TEST_ASSERT_EQUAL_STRING( "GAMMA", sa[ 2 ] );
+    sldel( &sa[ 3 ] );
+    sl_del_many( &sa );
+    TEST_ASSERT_NULL( sa );
+
+    sa = sl_new_many( 100, 10 );
+    for ( int i = 0; i < 100; i++ ) {
+        TEST_ASSERT( slrss( sa[ i ] ) == 10 );
+        slfmq( &sa[ i ], "item%i", i );
+    }
+    for ( int i = 0; i < 100; i++ )
+        TEST_ASSERT_TRUE( sl_get_local( sa[ i ] ) );
+    slacn( &sa[ 99 ], 'x', 10 );
+    TEST_ASSERT_FALSE( sl_get_local( sa[ 99 ] ) );
+    TEST_ASSERT_EQUAL_STRING( "item50", sa[ 50 ] );
+    sl_del_many( &sa );
+}
+
+
+void test_harvest( void )
+{
+    sl_t  s;
+    char* ptr;
+
+    TEST_ASSERT_FALSE( sl_get_harvest() );
+    sl_set_harvest( 1 );
+
+    s = slnew( 10 );
+    TEST_ASSERT( slrss( s ) >= 10 );
+    TEST_ASSERT( ( slrss( s ) % 2 ) == 0 );
+
+    /* Storage is used without re-allocation. */
+    ptr = s;
+    slacn( &s, 'a', slrss( s ) - 1 );
+    TEST_ASSERT( s == ptr );
+
+    slres( &s, 200 );
+    TEST_ASSERT( slrss( s ) >= 200 );
+    slcom( &s );
+    TEST_ASSERT( slrss( s ) >= sllen( s ) + 1 );
+    TEST_ASSERT( ( slrss( s ) % 2 ) == 0 );
+    sldel( &s );
+
+    sl_set_harvest( 0 );
+    s = slnew( 10 );
+    TEST_ASSERT( slrss( s ) == 10 );
+    sldel( &s );
+}
+
+
+#ifdef SLINKY_USE_MMAP
+
+void test_mmap( void )
+{
+    sl_t       s;
+    sl_size_t  i;
+    sl_size_t  size;
+    char*      cs;
+
+    size = 4 * SLINKY_MMAP_MIN;
+    /* Grow through the mapping threshold with appends. */
+    sl_set_growth( SL_GROWTH_GEOMETRIC, NULL );
+    s = slnew( 64 );
+    for ( i = 0; i < size; i++ ) {
+        slach( &s, 'a' + ( i % 26 ) );
+    }
+    TEST_ASSERT( sllen( s ) == size );
+    TEST_ASSERT( slrss( s ) >= size + 1 );
+    for ( i = 0; i < size; i++ ) {
+        if ( s[ i ] != (char)( 'a' + ( i % 26 ) ) )
+            break;
+    }
+    TEST_ASSERT( i == size );
+    sl_set_growth( SL_GROWTH_EXACT, NULL );
+
+    /* Shrink back to backend memory. */
+    sl_limit_to_pos( s, 100 );
+    slcom( &s );
+    TEST_ASSERT( slrss( s ) < SLINKY_MMAP_MIN );
+    TEST_ASSERT( s[ 99 ] == 'a' + ( 99 % 26 ) );
+
+    /* Directly mapped and dropped. */
+    slres( &s, SLINKY_MMAP_MIN );
+    TEST_ASSERT( strlen( s ) == 100 );
+    cs = sldrp( s );
+    TEST_ASSERT( strlen( cs ) == 100 );
+    free( cs );
+
+    /* Harvest keeps page slack. */
+    sl_set_harvest( 1 );
+    s = slnew( SLINKY_MMAP_MIN + 1 );
+    TEST_ASSERT( slrss( s ) >= SLINKY_MMAP_MIN + 1 );
+    memset( s, 'x', slrss( s ) - 1 );
+    s[ slrss( s ) - 1 ] = 0;
+    slcom( &s );
+    sldel( &s );
+    sl_set_harvest( 0 );
+}
+
+#endif
+
+
+#ifdef SLINKY_ALIGN
+
+void test_align( void )
+{
+    sl_t        s;
+    sl_t        d;
+    sl_v        sa;
+    sl_arena_t  arena;
+    sl_size_t   i;
+    const char* words[] = { "a", "longer word", "", "abc" };
+
+    for ( i = 0; i < 100; i += 7 ) {
+        s = slnew( i );
+        TEST_ASSERT( ( (uintptr_t)s % SLINKY_ALIGN ) == 0 );
+        sldel( &s );
+    }
+
+    /* Growth and extended descriptor keep alignment. */
+    s = slstr_c( "abc" );
+    for ( i = 0; i < 20; i++ ) {
+        slacn( &s, 'x', 5 );
+        TEST_ASSERT( ( (uintptr_t)s % SLINKY_ALIGN ) == 0 );
+    }
+    d = sl_share( &s );
+    TEST_ASSERT( ( (uintptr_t)s % SLINKY_ALIGN ) == 0 );
+    TEST_ASSERT( sllen( s ) == 103 );
+    TEST_ASSERT( !strncmp( s, "abcxxxxx", 8 ) );
+    sldel( &d );
+    d = sldup( s );
+    slush( &d );
+    TEST_ASSERT( d != s );
+    TEST_ASSERT( ( (uintptr_t)d % SLINKY_ALIGN ) == 0 );
+    sldel( &d );
+    sldel( &s );
+
+    /* Harvest keeps storage size in vector multiples. */
+    sl_set_harvest( 1 );
+    s = slnew( 10 );
+    TEST_ASSERT( ( slrss( s ) % SLINKY_ALIGN ) == 0 );
+    sldel( &s );
+    sl_set_harvest( 0 );
+
+    /* Batch and arena strings are aligned. */
+    sa = sl_new_many( 5, 10 );
+    for ( i = 0; i < 5; i++ )
+        TEST_ASSERT( ( (uintptr_t)sa[ i ] % SLINKY_ALIGN ) == 0 );
+    sl_del_many( &sa );
+    sa = sl_from_array_c( words, 4 );
+    for ( i = 0; i < 4; i++ ) {
+        TEST_ASSERT( ( (uintptr_t)sa[ i ] % SLINKY_ALIGN ) == 0 );
+        TEST_ASSERT( !strcmp( sa[ i ], words[ i ] ) );
+    }
+    sl_del_many( &sa );
+    arena = sl_arena_new( 256 );
+    sl_set_arena( arena );
+    for ( i = 0; i < 40; i += 3 ) {
+        s = slnew( i );
+        TEST_ASSERT( ( (uintptr_t)s % SLINKY_ALIGN ) == 0 );
+    }
+    slacn( &s, 'x', 300 );
+    TEST_ASSERT( ( (uintptr_t)s % SLINKY_ALIGN ) == 0 );
+    sl_set_arena( NULL );
+    sl_arena_del( arena );
+}
+
+#endif
+
+
+#ifdef SLINKY_USE_MEMTUN
+
+static void* test_memtun_worker( void* arg )
+{
+    mt_t mt = mt_new_std();
+    sl_t s;
+
+    (void)arg;
+    sl_push_memtun( mt );
+    TEST_ASSERT( sl_get_memtun() == mt );
+    s = slnew( 8 );
+    for ( int i = 0; i < 30; i++ )
+        slast( &s, "abc" );
+    TEST_ASSERT( sllen( s ) == 90 );
+    sldel( &s );
+    TEST_ASSERT( sl_pop_memtun() == mt );
+    mt_del( mt );
+    return NULL;
+}
+
+
+void test_memtun( void )
+{
+    mt_t      glob = sl_get_memtun();
+    mt_t      mt1 = mt_new_std();
+    mt_t      mt2 = mt_new_std();
+    pthread_t th[ 4 ];
+    sl_t      s1;
+    sl_t      s2;
+
+    /* Scoped context. */
+    sl_push_memtun( mt1 );
+    TEST_ASSERT( sl_get_memtun() == mt1 );
+    s1 = slstr_c( "context" );
+    sl_push_memtun( mt2 );
+    TEST_ASSERT( sl_get_memtun() == mt2 );
+    TEST_ASSERT( sl_pop_memtun() == mt2 );
+    TEST_ASSERT( sl_pop_memtun() == mt1 );
+    TEST_ASSERT( sl_get_memtun() == glob );
+
+    /* Explicit allocator. */
+    s2 = sl_new_with( mt2, 16 );
+    slast( &s2, "explicit" );
+    sl_reserve_with( mt1, &s2, 100 );
+    TEST_ASSERT( slrss( s2 ) >= 100 );
+    TEST_ASSERT( !strcmp( s2, "explicit" ) );
+
+    /* Deleted in other context. */
+    slast( &s1, s2 );
+    TEST_ASSERT( !strcmp( s1, "contextexplicit" ) );
+    sldel( &s1 );
+    sldel( &s2 );
+
+    for ( int i = 0; i < 4; i++ )
+        pthread_create( &th[ i ], NULL, test_memtun_worker, NULL );
+    for ( int i = 0; i < 4; i++ )
+        pthread_join( th[ i ], NULL );
+    TEST_ASSERT( sl_get_memtun() == glob );
+
+    mt_del( mt1 );
+    mt_del( mt2 );
+}
+
+#endif
+
+
+void test_scan( void )
+{
+    sl_t      s;
+    sl_size_t i;
+    sl_size_t len;
+    sl_size_t cnt;
+    sl_pos_t  exp;
+
+    /* Lengths around vector widths and unroll. */
+    for ( len = 0; len < 120; len += 13 ) {
+        s = slnew( len + 1 );
+        for ( i = 0; i < len; i++ )
+            slach( &s, ( i % 7 ) == 3 ? ',' : 'a' + ( i % 5 ) );
+
+        cnt = 0;
+        for ( i = 0; i < len; i++ )
+            cnt += ( s[ i ] == ',' );
+        TEST_ASSERT( slcch( s, ',' ) == cnt );
+
+        for ( i = 0; i <= len; i++ ) {
+            exp = i + 6 - ( ( i + 3 ) % 7 );
+            if ( exp >= (sl_pos_t)len )
+                exp = -1;
+            TEST_ASSERT( slfcr( s, ',', i ) == exp );
+            TEST_ASSERT( slfac( s, ",", i ) == exp );
+            TEST_ASSERT( slfac( s, ";,:", i ) == exp );
+            TEST_ASSERT( slfac( s, "0123456789,", i ) == exp );
+        }
+
+        for ( i = 0; i < len; i++ ) {
+            exp = (sl_pos_t)i - ( ( i + 4 ) % 7 );
+            if ( exp < 0 )
+                exp = -1;
+            TEST_ASSERT( slfcl( s, ',', i ) == exp );
+        }
+
+        sldel( &s );
+    }
+
+    s = slstr_c( "abc,def" );
+    TEST_ASSERT( slfcl( s, ',', 100 ) == 3 );
+    TEST_ASSERT( slfcl( s, 'f', 100 ) == 6 );
+    TEST_ASSERT( slfcr( s, 'a', 100 ) == -1 );
+    TEST_ASSERT( slfac( s, "", 0 ) == -1 );
+    TEST_ASSERT( slcch( s, 'x' ) == 0 );
+    slclr( s );
+    TEST_ASSERT( slfcl( s, 'a', 0 ) == -1 );
+    sldel( &s );
+}
+
+
+/* Reference search for test_search. */
+static sl_pos_t test_naive_find( const char* hay, sl_size_t hlen, const char* ndl, sl_size_t nlen )
+{
+    for ( sl_size_t i = 0; i + nlen <= hlen; i++ ) {
+        if ( !memcmp( hay + i, ndl, nlen ) )
+            return i;
+    }
+    return -1;
+}
+
+
+void test_search( void )
+{
+    sl_t         s;
+    char         ndl[ 80 ];
+    unsigned int seed = 1;
+
+    /* Partial match followed by match. */
+    s = slstr_c( "aab" );
+    TEST_ASSERT( slidx( s, "ab" ) == 1 );
+    slcpy_c( &s, "abcabd" );
+    TEST_ASSERT( slidx( s, "abd" ) == 3 );
+    TEST_ASSERT( slidx( s, "" ) == -1 );
+    TEST_ASSERT( slidx( s, "abdx" ) == -1 );
+    slmap( &s, "", "x" );
+    TEST_ASSERT( !strcmp( s, "abcabd" ) );
+    sldel( &s );
+
+    /* Random haystacks over small alphabets, short and long needles. */
+    for ( int round = 0; round < 300; round++ ) {
+        sl_size_t hlen = 1 + ( round * 37 ) % 2000;
+        int       abc = 2 + round % 3;
+        sl_size_t nlen;
+        sl_pos_t  exp;
+
+        s = slnew( hlen + 1 );
+        for ( sl_size_t i = 0; i < hlen; i++ ) {
+            seed = seed * 1103515245 + 12345;
+            slach( &s, 'a' + ( seed >> 16 ) % abc );
+        }
+
+        nlen = 2 + round % 70;
+        if ( nlen > hlen )
+            nlen = hlen;
+        if ( round % 2 ) {
+            /* Needle from haystack. */
+            memcpy( ndl, s + ( hlen - nlen ) / 2, nlen );
+        } else {
+            for ( sl_size_t i = 0; i < nlen; i++ ) {
+                seed = seed * 1103515245 + 12345;
+                ndl[ i ] = 'a' + ( seed >> 16 ) % abc;
+            }
+        }
+        ndl[ nlen ] = 0;
+
+        exp = test_naive_find( s, hlen, ndl, nlen );
+        TEST_ASSERT( slidx( s, ndl ) == exp );
+        sldel( &s );
+    }
+
+    /* Periodic needle and haystack. */
+    s = slnew( 2048 );
+    slacn( &s, 'a', 2000 );
+    slach( &s, 'b' );
+    memset( ndl, 'a', 60 );
+    strcpy( &ndl[ 60 ], "b" );
+    TEST_ASSERT( slidx( s, ndl ) == 2000 - 60 );
+    strcpy( &ndl[ 20 ], "b" );
+    TEST_ASSERT( slidx( s, ndl ) == 2000 - 20 );
+    strcpy( &ndl[ 20 ], "ba" );
+    TEST_ASSERT( slidx( s, ndl ) == -1 );
+    sldel( &s );
+
+    /* Frequent candidates for long needle. */
+    s = slnew( 16 );
+    for ( int i = 0; i < 6000; i++ )
+        slast( &s, "ab" );
+    for ( int i = 0; i < 20; i++ )
+        memcpy( &ndl[ 2 * i ], "ab", 2 );
+    strcpy( &ndl[ 40 ], "bab" );
+    TEST_ASSERT( slidx( s, ndl ) == -1 );
+    slast( &s, ndl );
+    TEST_ASSERT( slidx( s, ndl ) == 12000 );
+    sldel( &s );
+}
+
+
+void test_needle( void )
+{
+    sl_t        s;
+    sl_needle_t nd;
+    sl_size_t   offs[ 4 ];
+    char**      div = NULL;
+    char        ndl[ 64 ];
+
+    s = slstr_c( "key=1, key=22, Key=3, key=" );
+    nd = sl_needle_new( "key=" );
+    TEST_ASSERT( slfnd( s, nd, 0 ) == 0 );
+    TEST_ASSERT( slfnd( s, nd, 1 ) == 7 );
+    TEST_ASSERT( slfnd( s, nd, 23 ) == -1 );
+    TEST_ASSERT( slfnd( s, nd, 100 ) == -1 );
+    TEST_ASSERT( sr_find_needle( sr_new( s + 1, 9 ), nd, 0 ) == -1 );
+    TEST_ASSERT( sr_find_needle( sr_new( s + 1, 10 ), nd, 0 ) == 6 );
+    TEST_ASSERT( sl_find_all_needle( s, nd, offs, 2 ) == 3 );
+    TEST_ASSERT( offs[ 0 ] == 0 && offs[ 1 ] == 7 );
+    TEST_ASSERT( sl_find_all_needle( s, nd, NULL, 0 ) == 3 );
+    slmpn( &s, nd, "k:" );
+    TEST_ASSERT( !strcmp( s, "k:1, k:22, Key=3, k:" ) );
+    sl_needle_del( nd );
+
+    /* Split. */
+    nd = sl_needle_new( ", " );
+    TEST_ASSERT( slsgn( s, nd, -1, NULL ) == 4 );
+    TEST_ASSERT( slsgn( s, nd, 0, &div ) == 4 );
+    TEST_ASSERT( !strcmp( div[ 1 ], "k:22" ) );
+    TEST_ASSERT( !strcmp( div[ 3 ], "k:" ) );
+    sl_free( div );
+    sl_needle_del( nd );
+    sldel( &s );
+
+    /* Overlapping matches are skipped, single char and empty needle. */
+    s = slstr_c( "aaaaa" );
+    nd = sl_needle_new_sr( sr_new( "aaa", 2 ) );
+    TEST_ASSERT( sl_find_all_needle( s, nd, offs, 4 ) == 2 );
+    TEST_ASSERT( offs[ 1 ] == 2 );
+    sl_needle_del( nd );
+    nd = sl_needle_new( "a" );
+    TEST_ASSERT( sl_find_all_needle( s, nd, NULL, 0 ) == 5 );
+    TEST_ASSERT( slfnd( s, nd, 4 ) == 4 );
+    sl_needle_del( nd );
+    nd = sl_needle_new( "" );
+    TEST_ASSERT( slfnd( s, nd, 0 ) == -1 );
+    TEST_ASSERT( sl_find_all_needle( s, nd, NULL, 0 ) == 0 );
+    sl_needle_del( nd );
+    sldel( &s );
+
+    /* Long periodic needle uses Two-Way tables. */
+    s = slnew( 16 );
+    slacn( &s, 'a', 200 );
+    slach( &s, 'b' );
+    memset( ndl, 'a', 50 );
+    strcpy( &ndl[ 50 ], "b" );
+    nd = sl_needle_new( ndl );
+    TEST_ASSERT( slfnd( s, nd, 0 ) == 150 );
+    TEST_ASSERT( slfnd( s, nd, 151 ) == -1 );
+    sl_needle_del( nd );
+    sldel( &s );
+}
+
+
+void test_multi( void )
+{
+    const char* small[] = { "he", "she", "his", "hers" };
+    const char* large[] = { "he", "she", "his", "hers", "", "a", "b", "c", "d", "e", "she" };
+    sl_multi_t  mp;
+    sl_match_s  m[ 4 ];
+    sl_size_t   id;
+    sl_t        s;
+
+    s = slstr_c( "ushers and his hershey" );
+
+    /* Small set (fingerprint) and large set (automaton) agree. */
+    for ( int round = 0; round < 2; round++ ) {
+        if ( round == 0 )
+            mp = sl_multi_new( small, 4 );
+        else
+            mp = sl_multi_new( large, 11 );
+
+        /* "she" and "hers" overlap, leftmost wins. */
+        TEST_ASSERT( slfmp( s, mp, 0, &id ) == 1 );
+        TEST_ASSERT( id == 1 );
+        TEST_ASSERT( slfmp( s, mp, 2, &id ) == 2 );
+        TEST_ASSERT( id == 3 );
+        TEST_ASSERT( slfmp( s, mp, 22, NULL ) == -1 );
+
+        if ( round == 0 ) {
+            TEST_ASSERT( sl_count_multi( s, mp ) == 4 );
+            TEST_ASSERT( sl_find_all_multi( s, mp, m, 4 ) == 4 );
+            TEST_ASSERT( m[ 0 ].sr.str == s + 1 && m[ 0 ].sr.len == 3 && m[ 0 ].id == 1 );
+            TEST_ASSERT( m[ 1 ].sr.str == s + 11 && m[ 1 ].id == 2 );
+            TEST_ASSERT( m[ 2 ].sr.str == s + 15 && m[ 2 ].sr.len == 4 && m[ 2 ].id == 3 );
+            TEST_ASSERT( m[ 3 ].sr.str == s + 19 && m[ 3 ].id == 0 );
+        } else {
+            /* Single chars match too, duplicate "she" is never found. */
+            TEST_ASSERT( sl_count_multi( s, mp ) == 6 );
+            TEST_ASSERT( sl_find_all_multi( s, mp, m, 4 ) == 6 );
+            TEST_ASSERT( m[ 0 ].sr.str == s + 1 && m[ 0 ].id == 1 );
+            TEST_ASSERT( m[ 1 ].sr.str == s + 7 && m[ 1 ].id == 5 );
+            TEST_ASSERT( m[ 2 ].sr.str == s + 9 && m[ 2 ].id == 8 );
+            TEST_ASSERT( m[ 3 ].sr.str == s + 11 && m[ 3 ].id == 2 );
+        }
+
+        /* Reference limits the search. */
+        TEST_ASSERT( sr_find_multi( sr_new( s, 3 ), mp, 0, NULL ) == -1 );
+        TEST_ASSERT( sr_count_multi( sr_new( s + 11, 3 ), mp ) == 1 );
+        TEST_ASSERT( sr_find_all_multi( sr_new( s + 15, 4 ), mp, m, 1 ) == 1 );
+        TEST_ASSERT( m[ 0 ].id == 3 );
+
+        sl_multi_del( mp );
+    }
+    sldel( &s );
+
+    /* No patterns. */
+    s = slstr_c( "abc" );
+    mp = sl_multi_new( NULL, 0 );
+    TEST_ASSERT( slfmp( s, mp, 0, NULL ) == -1 );
+    TEST_ASSERT( sl_count_multi( s, mp ) == 0 );
+    sl_multi_del( mp );
+    sldel( &s );
+}
+
+
+void test_find_all( void )
+{
+    sl_t           s;
+    sr_s           m[ 3 ];
+    sl_find_iter_s it;
+    sl_needle_t    nd;
+    sl_size_t      cnt;
+
+    s = slstr_c( "a--b--c----d" );
+    TEST_ASSERT( slfal( s, "--", m, 3 ) == 4 );
+    TEST_ASSERT( m[ 0 ].str == s + 1 && m[ 0 ].len == 2 );
+    TEST_ASSERT( m[ 1 ].str == s + 4 );
+    TEST_ASSERT( m[ 2 ].str == s + 7 );
+    TEST_ASSERT( slfal( s, "--", NULL, 0 ) == 4 );
+    TEST_ASSERT( slfal( s, "x", m, 3 ) == 0 );
+    TEST_ASSERT( slfal( s, "", m, 3 ) == 0 );
+    TEST_ASSERT( !strcmp( s, "a--b--c----d" ) );
+
+    /* Iterator, one by one and in chunks. */
+    sl_find_iter( &it, s, "--" );
+    TEST_ASSERT( sl_find_next( &it, &m[ 0 ] ) == 1 );
+    TEST_ASSERT( m[ 0 ].str == s + 1 );
+    TEST_ASSERT( sl_find_fill( &it, m, 2 ) == 2 );
+    TEST_ASSERT( m[ 0 ].str == s + 4 && m[ 1 ].str == s + 7 );
+    TEST_ASSERT( sl_find_fill( &it, m, 3 ) == 1 );
+    TEST_ASSERT( m[ 0 ].str == s + 9 );
+    TEST_ASSERT( sl_find_fill( &it, m, 3 ) == 0 );
+    TEST_ASSERT( sl_find_next( &it, &m[ 0 ] ) == 0 );
+
+    nd = sl_needle_new( "-" );
+    sl_find_iter_needle( &it, s, nd );
+    cnt = 0;
+    while ( sl_find_next( &it, &m[ 0 ] ) ) {
+        TEST_ASSERT( *m[ 0 ].str == '-' && m[ 0 ].len == 1 );
+        cnt++;
+    }
+    TEST_ASSERT( cnt == 8 );
+    sl_needle_del( nd );
+    sldel( &s );
+}
+
+
+void test_map_many( void )
+{
+    const char* pairs[] = { "{name}", "Slinky", "{ver}", "1.0", "{}", "", "a", "b", "b", "a" };
+    const char* grow[] = { "x", "xxxx", "yyyy", "y" };
+    const char* keys[] = { "<", ">" };
+    sr_s        to[] = { { "&lt;", 4 }, { "&gt;", 4 } };
+    sl_multi_t  mp;
+    sl_t        s;
+
+    /* Shrink updates length. */
+    s = slstr_c( "aXXbXX" );
+    slmap( &s, "XX", "Y" );
+    TEST_ASSERT( !strcmp( s, "aYbY" ) );
+    TEST_ASSERT( sllen( s ) == 4 );
+    sldel( &s );
+
+    s = slstr_c( "{name} {ver}{}: ab ba" );
+    slmpm( &s, pairs, 5 );
+    TEST_ASSERT( !strcmp( s, "Slinky 1.0: ba ab" ) );
+    TEST_ASSERT( sllen( s ) == 17 );
+    slmpm( &s, pairs, 0 );
+    TEST_ASSERT( !strcmp( s, "Slinky 1.0: ba ab" ) );
+    sldel( &s );
+
+    /* Growth before shrink. */
+    s = slstr_c( "xyyyyxyyyy" );
+    slmpm( &s, grow, 2 );
+    TEST_ASSERT( !strcmp( s, "xxxxyxxxxy" ) );
+    TEST_ASSERT( sllen( s ) == 10 );
+    sldel( &s );
+
+    /* Compiled patterns, reused. */
+    mp = sl_multi_new( keys, 2 );
+    s = slstr_c( "<a><b>" );
+    sl_map_multi( &s, mp, to );
+    TEST_ASSERT( !strcmp( s, "&lt;a&gt;&lt;b&gt;" ) );
+    slcpy_c( &s, "x<y" );
+    sl_map_multi( &s, mp, to );
+    TEST_ASSERT( !strcmp( s, "x&lt;y" ) );
+    sl_multi_del( mp );
+    sldel( &s );
+}
+
+
+void test_icase( void )
+{
+    sl_needle_t nd;
+    sl_t        s, t;
+    char        buf[ 200 ];
+
+    s = slstr_c( "Hello, World! HELLO world." );
+    TEST_ASSERT( slidi( s, "world" ) == 7 );
+    TEST_ASSERT( slidi( s, "hello WORLD" ) == 14 );
+    TEST_ASSERT( slidi( s, "W" ) == 7 );
+    TEST_ASSERT( slidi( s, "!" ) == 12 );
+    TEST_ASSERT( slidi( s, "worlds" ) == -1 );
+    TEST_ASSERT( slidi( s, "" ) == -1 );
+    TEST_ASSERT( slidx( s, "world" ) == 20 );
+
+    /* Non-letters are not folded. */
+    slcpy_c( &s, "a@b[c" );
+    TEST_ASSERT( slidi( s, "A`B" ) == -1 );
+    TEST_ASSERT( slidi( s, "B{C" ) == -1 );
+    TEST_ASSERT( slidi( s, "b[C" ) == 2 );
+
+    /* Long haystack and long, periodic needle. */
+    memset( buf, 'a', 199 );
+    buf[ 199 ] = 0;
+    slcpy_c( &s, buf );
+    slast( &s, "B" );
+    memset( buf, 'A', 80 );
+    strcpy( &buf[ 80 ], "b" );
+    TEST_ASSERT( slidi( s, buf ) == 119 );
+    buf[ 80 ] = 'c';
+    TEST_ASSERT( slidi( s, buf ) == -1 );
+
+    /* Compare. */
+    slcpy_c( &s, "Slinky" );
+    t = slstr_c( "sLINKY" );
+    TEST_ASSERT( slcmi( s, t ) == 0 );
+    TEST_ASSERT( sl_is_same_icase( s, t ) );
+    TEST_ASSERT( slcmp( s, t ) != 0 );
+    slcpy_c( &t, "slinkyz" );
+    TEST_ASSERT( slcmi( s, t ) == -1 );
+    TEST_ASSERT( slcmi( t, s ) == 1 );
+    TEST_ASSERT( !sl_is_same_icase( s, t ) );
+    slcpy_c( &t, "SLIMKY" );
+    TEST_ASSERT( slcmi( s, t ) == 1 );
+    slcpy_c( &t, "[" );
+    TEST_ASSERT( slcmi( s, t ) == 1 );
+    TEST_ASSERT( sr_compare_icase( sr_new_c( "ABc" ), sr_new_c( "abC" ) ) == 0 );
+    TEST_ASSERT( sr_compare_icase( sr_new_c( "ABc" ), sr_new_c( "abCd" ) ) != 0 );
+    TEST_ASSERT( sr_compare_full_icase( sr_new_c( "ABc" ), sr_new_c( "abCd" ) ) == 0 );
+    TEST_ASSERT( sr_compare_full_icase( sr_new_c( "ABx" ), sr_new_c( "abCd" ) ) != 0 );
+
+    /* Hash equals hash of lowercase string. */
+    for ( int len = 0; len < 100; len++ ) {
+        for ( int i = 0; i < len; i++ )
+            buf[ i ] = "aBcDeFgH@[`{09"[ ( i * 7 + len ) % 14 ];
+        buf[ len ] = 0;
+        slcpy_c( &s, buf );
+        for ( int i = 0; i < len; i++ )
+            if ( buf[ i ] >= 'A' && buf[ i ] <= 'Z' )
+                buf[ i ] += 32;
+        slcpy_c( &t, buf );
+        TEST_ASSERT( sl_hash_icase( s ) == slhsh( t ) );
+        TEST_ASSERT( sl_hash_sr_icase( sr_new( s, sllen( s ) ) ) == sl_hash_icase( t ) );
+    }
+
+    /* Needle. */
+    nd = sl_needle_new_icase( "Foo" );
+    slcpy_c( &s, "foo FOO fOo bar" );
+    TEST_ASSERT( sl_find_all_needle( s, nd, NULL, 0 ) == 3 );
+    TEST_ASSERT( slfnd( s, nd, 1 ) == 4 );
+    sl_map_needle( &s, nd, "x" );
+    TEST_ASSERT( !strcmp( s, "x x x bar" ) );
+    sl_needle_del( nd );
+
+    sldel( &s );
+    sldel( &t );
+}
+
+
+void test_find_right( void )
+{
+    sl_needle_t nd;
+    sr_s        match[ 4 ];
+    sl_t        s;
+    char        ndl[ 64 ];
+
+    s = slstr_c( "archive.tar.gz.tar.gz" );
+    TEST_ASSERT( slidr( s, ".tar.gz" ) == 14 );
+    TEST_ASSERT( slidx( s, ".tar.gz" ) == 7 );
+    TEST_ASSERT( slidr( s, "a" ) == 16 );
+    TEST_ASSERT( slidr( s, "archive" ) == 0 );
+    TEST_ASSERT( slidr( s, ".zip" ) == -1 );
+    TEST_ASSERT( slidr( s, "" ) == -1 );
+    TEST_ASSERT( slidr( s, "archive.tar.gz.tar.gz." ) == -1 );
+
+    /* Last matches, from the end. */
+    TEST_ASSERT( slfla( s, ".tar.gz", match, 4 ) == 2 );
+    TEST_ASSERT( match[ 0 ].str == s + 14 && match[ 0 ].len == 7 );
+    TEST_ASSERT( match[ 1 ].str == s + 7 );
+    TEST_ASSERT( slfla( s, "r", match, 1 ) == 1 );
+    TEST_ASSERT( match[ 0 ].str == s + 17 );
+    TEST_ASSERT( slfla( s, "r", match, 0 ) == 0 );
+    slcpy_c( &s, "aaaaa" );
+    TEST_ASSERT( slfla( s, "aa", match, 4 ) == 2 );
+    TEST_ASSERT( match[ 0 ].str == s + 3 );
+    TEST_ASSERT( match[ 1 ].str == s + 1 );
+
+    /* Needle with end pos. */
+    slcpy_c( &s, "x.Tar y.tar z.TAR" );
+    nd = sl_needle_new_icase( ".tar" );
+    TEST_ASSERT( slfnr( s, nd, sllen( s ) ) == 13 );
+    TEST_ASSERT( slfnr( s, nd, 1000 ) == 13 );
+    TEST_ASSERT( slfnr( s, nd, 13 ) == 7 );
+    TEST_ASSERT( slfnr( s, nd, 10 ) == 1 );
+    TEST_ASSERT( slfnr( s, nd, 4 ) == -1 );
+    TEST_ASSERT( sr_find_needle_right( sr_new( s, 11 ), nd, 100 ) == 7 );
+    sl_needle_del( nd );
+
+    /* Extension and path use the last match. */
+    slcpy_c( &s, "dir.txt/file.txt" );
+    slext( s, ".txt" );
+    TEST_ASSERT( !strcmp( s, "dir.txt/file" ) );
+    sldir( s );
+    TEST_ASSERT( !strcmp( s, "dir.txt" ) );
+    slcpy_c( &s, "/a/b" );
+    slbas( s );
+    TEST_ASSERT( !strcmp( s, "b" ) );
+    sldel( &s );
+
+    /* Long needle with many candidates uses Two-Way. */
+    s = slnew( 16 );
+    slacn( &s, 'a', 3000 );
+    slach( &s, 'b' );
+    slacn( &s, 'a', 3000 );
+    memset( ndl, 'a', 20 );
+    ndl[ 20 ] = 'b';
+    memset( &ndl[ 21 ], 'a', 20 );
+    ndl[ 41 ] = 0;
+    TEST_ASSERT( slidr( s, ndl ) == 2980 );
+    ndl[ 20 ] = 'c';
+    TEST_ASSERT( slidr( s, ndl ) == -1 );
+
+    /* Match beyond first Two-Way window. */
+    slacn( &s, 'a', 30000 );
+    ndl[ 20 ] = 'b';
+    TEST_ASSERT( slidr( s, ndl ) == 2980 );
+    sldel( &s );
+}
+
+
+void test_glob( void )
+{
+    const char* pats[] = { "*.c", "src/**/*.h", "**/test_*", "[!.]*/Makefile" };
+    sl_glob_t   gp;
+    sl_t        s;
+
+    gp = sl_glob_new( "*.log" );
+    s = slstr_c( "app.log" );
+    TEST_ASSERT( slgbm( s, gp ) == 0 );
+    slcpy_c( &s, ".log" );
+    TEST_ASSERT( slgbm( s, gp ) == 0 );
+    slcpy_c( &s, "dir/app.log" );
+    TEST_ASSERT( slgbm( s, gp ) == -1 );
+    slcpy_c( &s, "app.log.1" );
+    TEST_ASSERT( slgbm( s, gp ) == -1 );
+    sl_glob_del( gp );
+
+    /* Optional directories. */
+    gp = sl_glob_new( "**/*.log" );
+    slcpy_c( &s, "app.log" );
+    TEST_ASSERT( slgbm( s, gp ) == 0 );
+    slcpy_c( &s, "var/log/app.log" );
+    TEST_ASSERT( slgbm( s, gp ) == 0 );
+    slcpy_c( &s, "var/log/app.txt" );
+    TEST_ASSERT( slgbm( s, gp ) == -1 );
+    sl_glob_del( gp );
+
+    gp = sl_glob_new( "a/**/b" );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "a/b" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "a/x/y/b" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "a/xb" ), gp ) == -1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "ab" ), gp ) == -1 );
+    sl_glob_del( gp );
+
+    gp = sl_glob_new( "a/**" );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "a/x/y" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "b/x" ), gp ) == -1 );
+    sl_glob_del( gp );
+
+    /* Sets, single bytes and escapes. */
+    gp = sl_glob_new( "[a-c]?[!x-z]\\*" );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "b.a*" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "d.a*" ), gp ) == -1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "b.y*" ), gp ) == -1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "b/a*" ), gp ) == -1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "b.ax" ), gp ) == -1 );
+    sl_glob_del( gp );
+
+    /* Unterminated set is literal. */
+    gp = sl_glob_new( "[ab" );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "[ab" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "aab" ), gp ) == -1 );
+    sl_glob_del( gp );
+
+    /* No backtracking blowup. */
+    gp = sl_glob_new( "*a*a*a*a*a*a*a*a*b" );
+    slcpy_c( &s, "" );
+    slacn( &s, 'a', 200 );
+    TEST_ASSERT( slgbm( s, gp ) == -1 );
+    slach( &s, 'b' );
+    TEST_ASSERT( slgbm( s, gp ) == 0 );
+    sl_glob_del( gp );
+
+    /* Too many DFA states, NFA is used. */
+    gp = sl_glob_new( "*a?????????" );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "abbbbbbbbb" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "bbbabababbbbb" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "abbbbbbbbbb" ), gp ) == -1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "abbbb/bbbb" ), gp ) == -1 );
+    sl_glob_del( gp );
+
+    /* Pattern set, first matching index. */
+    gp = sl_glob_new_many( pats, 4 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "main.c" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "src/slinky.h" ), gp ) == 1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "src/a/b/x.h" ), gp ) == 1 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "x/test_basic.c" ), gp ) == 2 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "test_basic.c" ), gp ) == 0 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( "build/Makefile" ), gp ) == 3 );
+    TEST_ASSERT( sr_glob_match( sr_new_c( ".git/Makefile" ), gp ) == -1 );
+    sl_glob_del( gp );
+
+    sldel( &s );
+}